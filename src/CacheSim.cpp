@@ -0,0 +1,73 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#include <algorithm>
+#include "CacheSim.h"
+
+CacheSim::CacheSim(const size_t cacheSize, const int assoc, const int lineSize) :
+  lineSize(lineSize), assoc(assoc) {
+  numSet = std::max(1, (int)(cacheSize/((size_t)assoc*(size_t)lineSize)));
+  tags.resize((size_t)numSet*assoc);
+  stamps.resize((size_t)numSet*assoc);
+  reset();
+}
+
+void CacheSim::reset() {
+  std::fill(tags.begin(), tags.end(), -1LL);
+  std::fill(stamps.begin(), stamps.end(), 0);
+  clock = 0;
+  numAccess = 0;
+  numHit = 0;
+}
+
+bool CacheSim::access(const long long addr) {
+  long long line = addr/lineSize;
+  int set = (int)(line % numSet);
+  long long* setTags = &tags[(size_t)set*assoc];
+  unsigned int* setStamps = &stamps[(size_t)set*assoc];
+  clock++;
+  numAccess++;
+  int lru = 0;
+  for (int i=0;i < assoc;i++) {
+    if (setTags[i] == line) {
+      setStamps[i] = clock;
+      numHit++;
+      return true;
+    }
+    if (setStamps[i] < setStamps[lru]) lru = i;
+  }
+  // Miss: replace least recently used line
+  setTags[lru] = line;
+  setStamps[lru] = clock;
+  return false;
+}
+
+void CacheSim::accessRange(const long long addr0, const long long addr1) {
+  if (addr1 <= addr0) return;
+  long long line0 = addr0/lineSize;
+  long long line1 = (addr1 - 1)/lineSize;
+  for (long long line=line0;line <= line1;line++) {
+    access(line*lineSize);
+  }
+}
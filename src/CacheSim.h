@@ -0,0 +1,77 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#ifndef CACHESIM_H
+#define CACHESIM_H
+
+#include <vector>
+#include <cstddef>
+
+//
+// Set-associative cache simulator with LRU replacement.
+// Addresses are given in bytes, every access touches a single cache line.
+//
+class CacheSim {
+private:
+  // Cache line size in bytes
+  const int lineSize;
+
+  // Number of ways per set
+  const int assoc;
+
+  // Number of sets
+  int numSet;
+
+  // Tags of the cached lines, numSet*assoc entries. -1 = empty
+  std::vector<long long> tags;
+
+  // Time of last access of the cached lines, numSet*assoc entries
+  std::vector<unsigned int> stamps;
+  unsigned int clock;
+
+  long long numAccess;
+  long long numHit;
+
+public:
+
+  CacheSim(const size_t cacheSize, const int assoc, const int lineSize);
+
+  // Accesses the cache line that holds byte address addr. Returns true on hit
+  bool access(const long long addr);
+
+  // Accesses all cache lines in the byte range [addr0, addr1)
+  void accessRange(const long long addr0, const long long addr1);
+
+  // Empties the cache and resets the counters
+  void reset();
+
+  int getLineSize() const {return lineSize;}
+  long long getNumAccess() const {return numAccess;}
+  long long getNumHit() const {return numHit;}
+
+  // Fraction of accesses that hit the cache
+  double hitRate() const {return (numAccess > 0) ? (double)numHit/(double)numAccess : 0.0;}
+};
+
+#endif // CACHESIM_H
@@ -22,83 +22,221 @@ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
 OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 *******************************************************************************/
+#ifndef LRUCACHE_H
+#define LRUCACHE_H
 
-#include <utility>
-#include <list>
-#include <unordered_map>
+#include <cstddef>
+#include <vector>
+#include <functional>
 #include <mutex>
 
-using namespace std;
+// Default number of shards. Keys are spread over the shards by hash, each shard has its own lock
+const int LRUCACHE_NUM_SHARD = 16;
 
 //
-// Simple LRU cache implementation
+// Fixed-capacity cache with approximate LRU (CLOCK) eviction.
+// Keys are spread over shards that each hold an equal share of the capacity in preallocated,
+// contiguous storage, so set() and get() never allocate. Each shard has an open addressing
+// hash index and a clock hand over its entries. get() only sets the referenced bit of the
+// entry, set() evicts by advancing the clock hand: entries referenced since the hand last
+// passed get a second chance, others are evicted.
 //
-template <typename key_type, typename value_type>
+// Entries optionally have a cost (e.g. size in bytes). When maxCost > 0, entries are evicted
+// until the total cost of a shard is within its share of maxCost. Entries costing more than
+// that share are not stored. key_type and value_type must be default constructible.
+//
+template <typename key_type, typename value_type, typename hash_type = std::hash<key_type> >
 class LRUCache {
 private:
 
-  struct ValueIterator {
+  struct Entry {
+    key_type key;
     value_type value;
-    typename list<key_type>::iterator it;
+    size_t hash;
+    size_t cost;
+    bool referenced;
+  };
+
+  struct Shard {
+    std::mutex lock;
+    // Entries, the first numEntry are in use
+    std::vector<Entry> entries;
+    int numEntry;
+    // Hash index: entry + 1, or 0 for an empty bucket
+    std::vector<int> index;
+    size_t indexMask;
+    // Clock hand, index of the next entry to consider for eviction
+    int hand;
+    // Share of the capacity and maximum cost of the cache
+    int capacity;
+    size_t maxCost;
+    size_t totalCost;
+    // Keeps locks of neighbouring shards on different cache lines
+    char padding[64];
   };
 
-  // Size of the cache
   const size_t capacity;
 
   // Value that is returned when the key is not found
   const value_type null_value;
 
-  // Double linked list of keys. Oldest is at the back
-  list<key_type> keys;
+  // Entries are evicted by cost if true
+  const bool costLimit;
+
+  const int numShard;
+  std::vector<Shard> shards;
 
-  // Cache: (hash table)
-  // key = key
-  // value = {value, pointer to linked list}
-  unordered_map<key_type, ValueIterator> cache;
-  
-  // Mutex
-  std::mutex cache_lock;
+  hash_type hasher;
 
 public:
-  
-  LRUCache(const size_t capacity, const value_type null_value) : capacity(capacity), null_value(null_value) {} 
- 
+
+  LRUCache(const size_t capacity, const value_type null_value, const size_t maxCost = 0,
+    const int numShardIn = LRUCACHE_NUM_SHARD) :
+    capacity(capacity), null_value(null_value), costLimit(maxCost > 0),
+    numShard((capacity < (size_t)numShardIn) ? (capacity > 0 ? (int)capacity : 1) : numShardIn),
+    shards(numShard) {
+    for (int i=0;i < numShard;i++) {
+      Shard& s = shards[i];
+      // Shares add up to capacity and maxCost exactly
+      s.capacity = (int)(capacity/numShard + ((size_t)i < capacity % numShard));
+      s.maxCost = maxCost/numShard + ((size_t)i < maxCost % numShard);
+      size_t indexSize = 1;
+      while (indexSize < 2*(size_t)s.capacity) indexSize *= 2;
+      s.entries.resize(s.capacity);
+      s.numEntry = 0;
+      s.index.assign(indexSize, 0);
+      s.indexMask = indexSize - 1;
+      s.hand = 0;
+      s.totalCost = 0;
+    }
+  }
+
   value_type get(key_type key) {
-    std::lock_guard<std::mutex> lock(cache_lock);
-    auto it = cache.find(key);
-    if (it == cache.end()) return null_value;
-    touch(it);
-    return it->second.value;
+    size_t h = hash(key);
+    Shard& s = shards[h % numShard];
+    std::lock_guard<std::mutex> lock(s.lock);
+    int e = find(s, key, h);
+    if (e < 0) return null_value;
+    s.entries[e].referenced = true;
+    return s.entries[e].value;
   }
-  
-  void set(key_type key, value_type value) {
-    std::lock_guard<std::mutex> lock(cache_lock);
-    auto it = cache.find(key);
-    if (it != cache.end()) {
+
+  void set(key_type key, value_type value, const size_t cost = 1) {
+    size_t h = hash(key);
+    Shard& s = shards[h % numShard];
+    std::lock_guard<std::mutex> lock(s.lock);
+    int e = find(s, key, h);
+    if (e >= 0) {
       // key found
-      it->second.value = value;
-      touch(it);
+      s.totalCost -= s.entries[e].cost;
+      s.entries[e].value = value;
+      s.entries[e].cost = cost;
+      s.entries[e].referenced = true;
+      s.totalCost += cost;
+      if (costLimit && cost > s.maxCost) {
+        remove(s, e);
+        return;
+      }
+      evict(s, e);
     } else {
       // key not found
-      if (cache.size() == capacity) {
-        key_type oldest_key = keys.back();
-        keys.pop_back();
-        cache.erase( cache.find(oldest_key) );
+      if (s.capacity == 0 || (costLimit && cost > s.maxCost)) return;
+      while (s.numEntry == s.capacity || (costLimit && s.totalCost + cost > s.maxCost)) {
+        remove(s, victim(s, -1));
       }
-      keys.push_front(key);
-      ValueIterator vi;
-      vi.value = value;
-      vi.it = keys.begin();
-      pair<key_type, ValueIterator> boo(key, vi);
-      cache.insert(boo);
+      e = s.numEntry++;
+      Entry& en = s.entries[e];
+      en.key = key;
+      en.value = value;
+      en.hash = h;
+      en.cost = cost;
+      // New entries are evicted on the first pass of the hand unless they are used
+      en.referenced = false;
+      s.totalCost += cost;
+      size_t b = bucket(s, h);
+      while (s.index[b] != 0) b = (b + 1) & s.indexMask;
+      s.index[b] = e + 1;
     }
   }
 
 private:
 
-  void touch(typename unordered_map<key_type, ValueIterator>::iterator it) {
-    keys.erase(it->second.it);
-    keys.push_front(it->first);
-    it->second.it = keys.begin();
+  // Mixes the bits of the hash, std::hash of integers is the identity
+  size_t hash(const key_type& key) const {
+    unsigned long long h = (unsigned long long)hasher(key);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return (size_t)h;
+  }
+
+  // Home bucket of hash h. The shard is chosen by h % numShard, the bucket by the remaining bits
+  size_t bucket(const Shard& s, const size_t h) const {
+    return (h / numShard) & s.indexMask;
+  }
+
+  // Returns the entry of key, or -1 if there is none
+  int find(const Shard& s, const key_type& key, const size_t h) const {
+    for (size_t b = bucket(s, h);s.index[b] != 0;b = (b + 1) & s.indexMask) {
+      const Entry& en = s.entries[s.index[b] - 1];
+      if (en.hash == h && en.key == key) return s.index[b] - 1;
+    }
+    return -1;
+  }
+
+  // Advances the clock hand to the next entry to evict, skipping entry keep
+  int victim(Shard& s, const int keep) {
+    while (true) {
+      if (s.hand >= s.numEntry) s.hand = 0;
+      int e = s.hand++;
+      if (e == keep) continue;
+      if (!s.entries[e].referenced) return e;
+      s.entries[e].referenced = false;
+    }
+  }
+
+  // Evicts entries other than keep until the shard is within its maximum cost
+  void evict(Shard& s, int keep) {
+    while (costLimit && s.totalCost > s.maxCost) {
+      int e = victim(s, keep);
+      // The last entry moves into e when e is removed
+      if (keep == s.numEntry - 1) keep = e;
+      remove(s, e);
+    }
+  }
+
+  // Removes entry e. The last entry is moved into its place so that entries stay contiguous
+  void remove(Shard& s, const int e) {
+    // Remove from the hash index with backward shift deletion, so that no tombstones are needed
+    size_t i = bucket(s, s.entries[e].hash);
+    while (s.index[i] != e + 1) i = (i + 1) & s.indexMask;
+    size_t j = i;
+    while (true) {
+      j = (j + 1) & s.indexMask;
+      if (s.index[j] == 0) break;
+      size_t k = bucket(s, s.entries[s.index[j] - 1].hash);
+      // Move the entry at j into the hole at i if its home bucket is not in (i, j]
+      bool inRange = (i <= j) ? (i < k && k <= j) : (i < k || k <= j);
+      if (!inRange) {
+        s.index[i] = s.index[j];
+        i = j;
+      }
+    }
+    s.index[i] = 0;
+    s.totalCost -= s.entries[e].cost;
+
+    int last = --s.numEntry;
+    if (e != last) {
+      size_t b = bucket(s, s.entries[last].hash);
+      while (s.index[b] != last + 1) b = (b + 1) & s.indexMask;
+      s.index[b] = e + 1;
+      s.entries[e] = s.entries[last];
+    }
+    // Keep the hand on the same position, the entry moved into e has not been visited
+    if (s.hand > s.numEntry) s.hand = s.numEntry;
   }
 };
+
+#endif // LRUCACHE_H
@@ -0,0 +1,154 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#include <thread>
+#include "PlanStorage.h"
+
+const unsigned int INDEX_MASK = (1u << PLANSTORAGE_INDEX_BITS) - 1;
+const unsigned int GENERATION_MASK = (1u << PLANSTORAGE_GENERATION_BITS) - 1;
+const int CHUNK_SIZE = 1 << PLANSTORAGE_CHUNK_BITS;
+
+// Reader counter slot of the calling thread, assigned round-robin on first use
+static int readerSlot() {
+  static std::atomic<int> nextSlot(0);
+  thread_local int slot = nextSlot.fetch_add(1) % PLANSTORAGE_NUM_READER_SLOT;
+  return slot;
+}
+
+// Returns the generation that follows gen. Generation 0 is never used, so that handle 0 is
+// never valid
+static unsigned int nextGeneration(const unsigned int gen) {
+  unsigned int next = (gen + 1) & GENERATION_MASK;
+  return (next == 0) ? 1 : next;
+}
+
+PlanStorage::ReadGuard::ReadGuard(PlanStorage& storage_in) : storage(storage_in) {
+  int slot = readerSlot();
+  // Register in the current epoch. If a writer flipped the epoch in between, it may already
+  // have checked our counter, so register again in the new epoch
+  while (true) {
+    unsigned int e = storage.epoch.load();
+    count = &storage.readers[e & 1][slot].count;
+    count->fetch_add(1);
+    if (storage.epoch.load() == e) break;
+    count->fetch_sub(1);
+  }
+}
+
+PlanStorage::ReadGuard::~ReadGuard() {
+  count->fetch_sub(1, std::memory_order_release);
+}
+
+PlanStorage::PlanStorage() : epoch(0), numSlot(0) {
+  for (int i=0;i < PLANSTORAGE_NUM_CHUNK;i++) chunks[i].store(NULL);
+  for (int i=0;i < 2;i++) {
+    for (int j=0;j < PLANSTORAGE_NUM_READER_SLOT;j++) readers[i][j].count.store(0);
+  }
+}
+
+PlanStorage::~PlanStorage() {
+  for (int i=0;i < PLANSTORAGE_NUM_CHUNK;i++) delete [] chunks[i].load();
+}
+
+PlanStorage::Slot* PlanStorage::slot(const int index) const {
+  Slot* chunk = chunks[index >> PLANSTORAGE_CHUNK_BITS].load(std::memory_order_acquire);
+  return (chunk == NULL) ? NULL : &chunk[index & (CHUNK_SIZE - 1)];
+}
+
+cuttPlan_t* PlanStorage::find(const cuttHandle handle) const {
+  Slot* s = slot(handle & INDEX_MASK);
+  if (s == NULL) return NULL;
+  // A slot's plan is set before its generation is published, and the generation is changed
+  // before its plan is removed
+  if (s->generation.load(std::memory_order_acquire) != (handle >> PLANSTORAGE_INDEX_BITS)) return NULL;
+  return s->plan.load(std::memory_order_acquire);
+}
+
+bool PlanStorage::insert(cuttPlan_t* plan, cuttHandle& handle) {
+  std::lock_guard<std::mutex> lock(writeMutex);
+  int index;
+  if (!freeSlots.empty()) {
+    index = freeSlots.front();
+    freeSlots.pop_front();
+  } else {
+    if (numSlot > (int)INDEX_MASK) return false;
+    index = numSlot++;
+    if ((index & (CHUNK_SIZE - 1)) == 0) {
+      Slot* chunk = new Slot[CHUNK_SIZE];
+      for (int i=0;i < CHUNK_SIZE;i++) {
+        chunk[i].generation.store(0);
+        chunk[i].plan.store(NULL);
+      }
+      chunks[index >> PLANSTORAGE_CHUNK_BITS].store(chunk, std::memory_order_release);
+    }
+  }
+  Slot* s = slot(index);
+  // Freed slots already hold their next generation, new slots start from generation 1
+  unsigned int gen = s->generation.load();
+  if (gen == 0) gen = 1;
+  s->plan.store(plan, std::memory_order_release);
+  s->generation.store(gen, std::memory_order_release);
+  handle = (gen << PLANSTORAGE_INDEX_BITS) | (unsigned int)index;
+  return true;
+}
+
+cuttPlan_t* PlanStorage::erase(const cuttHandle handle) {
+  std::lock_guard<std::mutex> lock(writeMutex);
+  int index = (int)(handle & INDEX_MASK);
+  if (index >= numSlot) return NULL;
+  Slot* s = slot(index);
+  unsigned int gen = s->generation.load();
+  if (gen != (handle >> PLANSTORAGE_INDEX_BITS)) return NULL;
+  cuttPlan_t* plan = s->plan.load();
+  // Invalidate the handle, the next generation is handed out when the slot is reused
+  s->generation.store(nextGeneration(gen));
+  s->plan.store(NULL);
+  synchronize();
+  freeSlots.push_back(index);
+  return plan;
+}
+
+void PlanStorage::clear(std::vector<cuttPlan_t*>& plans) {
+  std::lock_guard<std::mutex> lock(writeMutex);
+  std::vector<int> indices;
+  for (int index=0;index < numSlot;index++) {
+    Slot* s = slot(index);
+    cuttPlan_t* plan = s->plan.load();
+    if (plan == NULL) continue;
+    s->generation.store(nextGeneration(s->generation.load()));
+    s->plan.store(NULL);
+    plans.push_back(plan);
+    indices.push_back(index);
+  }
+  synchronize();
+  freeSlots.insert(freeSlots.end(), indices.begin(), indices.end());
+}
+
+void PlanStorage::synchronize() {
+  // New readers register in the other epoch and no longer find the removed plan
+  unsigned int e = epoch.fetch_add(1);
+  for (int j=0;j < PLANSTORAGE_NUM_READER_SLOT;j++) {
+    while (readers[e & 1][j].count.load(std::memory_order_acquire) != 0) std::this_thread::yield();
+  }
+}
@@ -0,0 +1,119 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#ifndef PLANSTORAGE_H
+#define PLANSTORAGE_H
+
+#include <atomic>
+#include <mutex>
+#include <deque>
+#include <vector>
+#include "cutt.h"
+
+class cuttPlan_t;
+
+// Number of reader counters per epoch. Readers on different threads use different counters
+// so that concurrent lookups do not contend on one cache line
+const int PLANSTORAGE_NUM_READER_SLOT = 64;
+
+// Handles are (generation << PLANSTORAGE_INDEX_BITS) | slot index
+const int PLANSTORAGE_INDEX_BITS = 18;
+const int PLANSTORAGE_GENERATION_BITS = 32 - PLANSTORAGE_INDEX_BITS;
+// Slots are allocated in chunks that never move, so that readers need no lock
+const int PLANSTORAGE_CHUNK_BITS = 10;
+const int PLANSTORAGE_NUM_CHUNK = 1 << (PLANSTORAGE_INDEX_BITS - PLANSTORAGE_CHUNK_BITS);
+
+//
+// Storage of plans by handle with lookups that take no lock.
+// Plans are kept in a slot map: the handle holds the index of the plan's slot and the
+// generation of the slot when the plan was inserted. Lookup is an array access, and handles
+// of destroyed plans are detected by their generation even after the slot has been reused.
+// Freed slots are reused oldest first, so memory stays at the peak number of live plans.
+// Readers announce themselves in an epoch counter for the duration of a ReadGuard. A writer
+// that removed a plan flips the epoch and waits until every reader that started before the
+// flip has left, before the plan is freed or its slot reused.
+//
+class PlanStorage {
+private:
+  struct Slot {
+    std::atomic<unsigned int> generation;
+    std::atomic<cuttPlan_t*> plan;
+  };
+
+  // Reader counter, padded so that no two counters share a cache line. Padding instead of
+  // alignas keeps PlanStorage allocatable with new in C++11
+  struct ReaderCount {
+    std::atomic<int> count;
+    char padding[64 - sizeof(std::atomic<int>)];
+  };
+
+  std::atomic<Slot*> chunks[PLANSTORAGE_NUM_CHUNK];
+  std::atomic<unsigned int> epoch;
+  ReaderCount readers[2][PLANSTORAGE_NUM_READER_SLOT];
+
+  // Writer state, guarded by writeMutex
+  std::mutex writeMutex;
+  int numSlot;
+  std::deque<int> freeSlots;
+
+  Slot* slot(const int index) const;
+
+  // Waits until readers of the current epoch have left. Caller holds writeMutex
+  void synchronize();
+
+public:
+
+  //
+  // Keeps plans found through the storage alive while in scope. Lookups may only be done
+  // while a ReadGuard exists on the calling thread
+  //
+  class ReadGuard {
+  private:
+    PlanStorage& storage;
+    std::atomic<int>* count;
+  public:
+    ReadGuard(PlanStorage& storage_in);
+    ~ReadGuard();
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+  };
+
+  PlanStorage();
+  ~PlanStorage();
+
+  // Returns the plan of handle, or NULL if there is none. Requires a ReadGuard
+  cuttPlan_t* find(const cuttHandle handle) const;
+
+  // Adds plan and returns its handle. Returns false if the storage is full
+  bool insert(cuttPlan_t* plan, cuttHandle& handle);
+
+  // Removes the plan of handle and returns it, or returns NULL if there is none.
+  // Returns once no reader can still use the plan, so that it can be freed
+  cuttPlan_t* erase(const cuttHandle handle);
+
+  // Removes all plans and appends them to plans. Returns once no reader can still use them
+  void clear(std::vector<cuttPlan_t*>& plans);
+};
+
+#endif // PLANSTORAGE_H
@@ -22,69 +22,69 @@ CALL(7);
 #if MAX_REG_STORAGE >= 8
 CALL(8);
 #endif
-#if MAX_REG_STORAGE >= 9
+#if MAX_REG_STORAGE >= 9 && REG_STORAGE_DENSE >= 9
 CALL(9);
 #endif
 #if MAX_REG_STORAGE >= 10
 CALL(10);
 #endif
 
-#if MAX_REG_STORAGE >= 11
+#if MAX_REG_STORAGE >= 11 && REG_STORAGE_DENSE >= 11
 CALL(11);
 #endif
 #if MAX_REG_STORAGE >= 12
 CALL(12);
 #endif
-#if MAX_REG_STORAGE >= 13
+#if MAX_REG_STORAGE >= 13 && REG_STORAGE_DENSE >= 13
 CALL(13);
 #endif
 #if MAX_REG_STORAGE >= 14
 CALL(14);
 #endif
-#if MAX_REG_STORAGE >= 15
+#if MAX_REG_STORAGE >= 15 && REG_STORAGE_DENSE >= 15
 CALL(15);
 #endif
 #if MAX_REG_STORAGE >= 16
 CALL(16);
 #endif
-#if MAX_REG_STORAGE >= 17
+#if MAX_REG_STORAGE >= 17 && REG_STORAGE_DENSE >= 17
 CALL(17);
 #endif
 #if MAX_REG_STORAGE >= 18
 CALL(18);
 #endif
-#if MAX_REG_STORAGE >= 19
+#if MAX_REG_STORAGE >= 19 && REG_STORAGE_DENSE >= 19
 CALL(19);
 #endif
 #if MAX_REG_STORAGE >= 20
 CALL(20);
 #endif
 
-#if MAX_REG_STORAGE >= 21
+#if MAX_REG_STORAGE >= 21 && REG_STORAGE_DENSE >= 21
 CALL(21);
 #endif
 #if MAX_REG_STORAGE >= 22
 CALL(22);
 #endif
-#if MAX_REG_STORAGE >= 23
+#if MAX_REG_STORAGE >= 23 && REG_STORAGE_DENSE >= 23
 CALL(23);
 #endif
 #if MAX_REG_STORAGE >= 24
 CALL(24);
 #endif
-#if MAX_REG_STORAGE >= 25
+#if MAX_REG_STORAGE >= 25 && REG_STORAGE_DENSE >= 25
 CALL(25);
 #endif
 #if MAX_REG_STORAGE >= 26
 CALL(26);
 #endif
-#if MAX_REG_STORAGE >= 27
+#if MAX_REG_STORAGE >= 27 && REG_STORAGE_DENSE >= 27
 CALL(27);
 #endif
 #if MAX_REG_STORAGE >= 28
 CALL(28);
 #endif
-#if MAX_REG_STORAGE >= 29
+#if MAX_REG_STORAGE >= 29 && REG_STORAGE_DENSE >= 29
 CALL(29);
 #endif
 #if MAX_REG_STORAGE >= 30
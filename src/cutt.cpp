@@ -24,16 +24,24 @@ SOFTWARE.
 *******************************************************************************/
 #include <hip/hip_runtime.h>
 #include <list>
-#include <unordered_map>
 #include "CudaUtils.h"
 #include "CudaMem.h"
 #include "cuttplan.h"
+#include "cuttGpuModel.h"
 #include "cuttkernel.h"
 #include "cuttTimer.h"
+#include "PlanStorage.h"
 #include "cutt.h"
+#include "cuttContextDebug.h"
 #include <atomic>
 #include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <map>
+#include <thread>
+#include <vector>
 #include <cstdlib>
+#include <cstring>
 // #include <chrono>
 
 // global Umpire allocator
@@ -41,34 +49,56 @@ SOFTWARE.
 umpire::Allocator cutt_umpire_allocator;
 #endif
 
-// Hash table to store the plans
-static std::unordered_map<cuttHandle, cuttPlan_t* > planStorage;
-static std::mutex planStorageMutex;
+// Devices with an ID below this have their properties in the lock-free table deviceProps,
+// devices above are queried on every call
+const int CUTT_MAX_DEVICE = 64;
 
-// Current handle
-static std::atomic<cuttHandle> curHandle(0);
-
-// Table of devices that have been initialized
-static std::unordered_map<int, hipDeviceProp_t> deviceProps;
+// Table of devices that have been initialized. An entry is written once under
+// devicePropsMutex and published with ready, after which it is read without locking
+struct DeviceProp {
+  std::atomic<bool> ready;
+  hipDeviceProp_t prop;
+};
+static DeviceProp deviceProps[CUTT_MAX_DEVICE];
 static std::mutex devicePropsMutex;
 
+// Gets properties of the current device deviceID, sets shared memory configuration and
+// stores them in deviceProps
+static void initDeviceProp(const int deviceID, hipDeviceProp_t &prop) {
+  std::lock_guard<std::mutex> lock(devicePropsMutex);
+
+  if (deviceID < CUTT_MAX_DEVICE && deviceProps[deviceID].ready.load(std::memory_order_acquire)) {
+    prop = deviceProps[deviceID].prop;
+    return;
+  }
+
+  hipCheck(hipGetDeviceProperties(&prop, deviceID));
+  cuttKernelSetSharedMemConfig();
+  if (deviceID < CUTT_MAX_DEVICE) {
+    deviceProps[deviceID].prop = prop;
+    deviceProps[deviceID].ready.store(true, std::memory_order_release);
+  }
+}
+
 // Checks prepares device if it's not ready yet and returns device properties
 // Also sets shared memory configuration
 void getDeviceProp(int& deviceID, hipDeviceProp_t &prop) {
   hipCheck(hipGetDevice(&deviceID));
 
-  // need to lock this function	
-  std::lock_guard<std::mutex> lock(devicePropsMutex);
-
-  auto it = deviceProps.find(deviceID);
-  if (it == deviceProps.end()) {
-    // Get device properties and store it for later use
-    hipCheck(hipGetDeviceProperties(&prop, deviceID));
-    cuttKernelSetSharedMemConfig();
-    deviceProps.insert({deviceID, prop});
-  } else {
-    prop = it->second;
+  if (deviceID < CUTT_MAX_DEVICE && deviceProps[deviceID].ready.load(std::memory_order_acquire)) {
+    prop = deviceProps[deviceID].prop;
+    return;
   }
+
+  initDeviceProp(deviceID, prop);
+}
+
+// Initializes device deviceID and queries resource usage of all kernels on it
+static void prewarmDevice(const int deviceID) {
+  hipCheck(hipSetDevice(deviceID));
+  hipDeviceProp_t prop;
+  initDeviceProp(deviceID, prop);
+  cuttKernelResourcePrewarm(deviceID);
 }
 
 cuttResult cuttPlanCheckInput(int rank, int* dim, int* permutation, size_t sizeofType) {
@@ -96,31 +126,10 @@ cuttResult cuttPlanCheckInput(int rank, int* dim, int* permutation, size_t sizeo
   return CUTT_SUCCESS;
 }
 
-cuttResult cuttPlan(cuttHandle* handle, int rank, int* dim, int* permutation, size_t sizeofType,
-  hipStream_t stream) {
-
-#ifdef ENABLE_NVTOOLS
-  gpuRangeStart("init");
-#endif
-
-  // Check that input parameters are valid
-  cuttResult inpCheck = cuttPlanCheckInput(rank, dim, permutation, sizeofType);
-  if (inpCheck != CUTT_SUCCESS) return inpCheck;
-
-  // Create new handle
-  *handle = curHandle;
-  curHandle++;
-
-  // Check that the current handle is available (it better be!)
-  {
-    std::lock_guard<std::mutex> lock(planStorageMutex);
-    if (planStorage.count(*handle) != 0) return CUTT_INTERNAL_ERROR;
-  }
-
-  // Prepare device
-  int deviceID;
-  hipDeviceProp_t prop;
-  getDeviceProp(deviceID, prop);
+// Chooses the plan for a tensor on device deviceID with the model and heuristic.
+// plan gets no device buffers
+static cuttResult choosePlan(int rank, int* dim, int* permutation, size_t sizeofType,
+  const int deviceID, hipDeviceProp_t& prop, const int numPosMbarSample, cuttPlan_t& plan) {
 
   // Reduce ranks
   std::vector<int> redDim;
@@ -161,10 +170,13 @@ cuttResult cuttPlan(cuttHandle* handle, int rank, int* dim, int* permutation, si
   gpuRangeStart("countCycles");
 #endif
 
-  // Count cycles
+  // Count cycles, sharing model sub-results between candidates
+  ModelMemo memo;
   for (auto it=plans.begin();it != plans.end();it++) {
-    if (!it->countCycles(prop, 10)) return CUTT_INTERNAL_ERROR;
+    if (!it->countCycles(prop, numPosMbarSample, &memo)) return CUTT_INTERNAL_ERROR;
   }
+  // Search grid size, threads and register storage with the model
+  if (!cuttPlan_t::searchLaunchConfigs(plans, prop, numPosMbarSample, &memo)) return CUTT_INTERNAL_ERROR;
 
 #ifdef ENABLE_NVTOOLS
   gpuRangeStop();
@@ -177,24 +189,205 @@ cuttResult cuttPlan(cuttHandle* handle, int rank, int* dim, int* permutation, si
 
   // bestPlan->print();
 
-  // Create copy of the plan outside the list
-  cuttPlan_t* plan = new cuttPlan_t();
   // NOTE: No deep copy needed here since device memory hasn't been allocated yet
-  *plan = *bestPlan;
+  plan = *bestPlan;
   // Set device pointers to NULL in the old copy of the plan so
   // that they won't be deallocated later when the object is destroyed
   bestPlan->nullDevicePointers();
 
+  return CUTT_SUCCESS;
+}
+
+//
+// Planning request in flight. The first cuttPlan() for a key plans, concurrent calls with the
+// same key wait for it and copy its plan. Key is (deviceID, sizeofType, rank, dim, permutation)
+//
+struct PlanFlight {
+  std::mutex mutex;
+  std::condition_variable done;
+  bool ready;
+  cuttResult result;
+  // Chosen plan, without device buffers
+  cuttPlan_t plan;
+  PlanFlight() : ready(false), result(CUTT_SUCCESS) {}
+};
+
+// Plan removed from its plan storage, freed once its executions are done
+struct RetiredPlan {
+  cuttPlan_t* plan;
+  // Completion events of the executions, owned by the plan
+  std::vector<hipEvent_t> events;
+};
+
+struct cuttContext_t {
+  cuttContextConfig config;
+
+  // Plans by handle, looked up without locking in cuttExecute
+  PlanStorage planStorage;
+  // Number of plans, including those reserved by plan calls in progress
+  std::atomic<int> numPlan;
+
+  // Planning requests in flight
+  std::map< std::vector<int>, std::shared_ptr<PlanFlight> > planFlights;
+  std::mutex planFlightsMutex;
+  // Number of plan searches run, and of calls waiting for a request in flight
+  std::atomic<int> numPlanningRun;
+  std::atomic<int> numPlanFollower;
+  // Called before each plan search, for the tests
+  void (*planningHook)(cuttContext ctx, void* arg);
+  void* planningHookArg;
+
+  // Number of threads creating plans
+  int numPlanningThread;
+  std::mutex planningMutex;
+  std::condition_variable planningDone;
+
+  // Destroyed plans waiting to be freed
+  std::vector<RetiredPlan> retiredPlans;
+  std::mutex retiredPlansMutex;
+
+  cuttContext_t(const cuttContextConfig& config_in) : config(config_in), numPlan(0),
+    numPlanningRun(0), numPlanFollower(0), planningHook(NULL), planningHookArg(NULL),
+    numPlanningThread(0) {}
+};
+
+static cuttContextConfig defaultContextConfig() {
+  cuttContextConfig config;
+  cuttGetDefaultContextConfig(&config);
+  return config;
+}
+
+// Context of the API functions without a context argument
+static cuttContext_t defaultContext(defaultContextConfig());
+
+//
+// Holds one of the planning threads of a context while in scope, waits if all are taken
+//
+class PlanningThreadGuard {
+private:
+  cuttContext_t& ctx;
+public:
+  PlanningThreadGuard(cuttContext_t& ctx_in) : ctx(ctx_in) {
+    if (ctx.config.maxNumPlanningThread <= 0) return;
+    std::unique_lock<std::mutex> lock(ctx.planningMutex);
+    ctx.planningDone.wait(lock, [this]{return ctx.numPlanningThread < ctx.config.maxNumPlanningThread;});
+    ctx.numPlanningThread++;
+  }
+  ~PlanningThreadGuard() {
+    if (ctx.config.maxNumPlanningThread <= 0) return;
+    {
+      std::lock_guard<std::mutex> lock(ctx.planningMutex);
+      ctx.numPlanningThread--;
+    }
+    ctx.planningDone.notify_one();
+  }
+};
+
+//
+// Publishes the result of a planning request to its followers when going out of scope, also
+// when planning throws. Until result is set the followers see CUTT_INTERNAL_ERROR
+//
+class PlanFlightPublisher {
+private:
+  cuttContext_t& ctx;
+  const std::vector<int>& key;
+  PlanFlight& flight;
+public:
+  cuttResult result;
+  PlanFlightPublisher(cuttContext_t& ctx_in, const std::vector<int>& key_in, PlanFlight& flight_in) :
+    ctx(ctx_in), key(key_in), flight(flight_in), result(CUTT_INTERNAL_ERROR) {}
+  ~PlanFlightPublisher() {
+    if (ctx.config.coalescePlans) {
+      std::lock_guard<std::mutex> lock(ctx.planFlightsMutex);
+      ctx.planFlights.erase(key);
+    }
+    {
+      std::lock_guard<std::mutex> lock(flight.mutex);
+      flight.result = result;
+      flight.ready = true;
+    }
+    flight.done.notify_all();
+  }
+};
+
+// Reserves a plan in ctx. Returns false if the context has reached its plan limit
+static bool reservePlan(cuttContext_t& ctx) {
+  int numPlan = ctx.numPlan.fetch_add(1);
+  if (ctx.config.maxNumPlan > 0 && numPlan >= ctx.config.maxNumPlan) {
+    ctx.numPlan.fetch_sub(1);
+    return false;
+  }
+  return true;
+}
+
+static void reclaimPlans(cuttContext_t& ctx, const bool wait);
+
+static cuttResult createPlan(cuttContext_t& ctx, cuttHandle* handle, int rank, int* dim,
+  int* permutation, size_t sizeofType, hipStream_t stream) {
+
+  // Free destroyed plans that are done, so that their buffers can be reused
+  reclaimPlans(ctx, false);
+
+  // Prepare device
+  int deviceID;
+  hipDeviceProp_t prop;
+  getDeviceProp(deviceID, prop);
+
+  // Join the request in flight for this tensor, or start one
+  std::vector<int> key;
+  key.push_back(deviceID);
+  key.push_back((int)sizeofType);
+  key.push_back(rank);
+  key.insert(key.end(), dim, dim + rank);
+  key.insert(key.end(), permutation, permutation + rank);
+  std::shared_ptr<PlanFlight> flight;
+  bool isLeader = false;
+  if (ctx.config.coalescePlans) {
+    std::lock_guard<std::mutex> lock(ctx.planFlightsMutex);
+    auto it = ctx.planFlights.find(key);
+    if (it != ctx.planFlights.end()) {
+      flight = it->second;
+    } else {
+      flight = std::make_shared<PlanFlight>();
+      ctx.planFlights.insert(std::make_pair(key, flight));
+      isLeader = true;
+    }
+  } else {
+    flight = std::make_shared<PlanFlight>();
+    isLeader = true;
+  }
+
+  if (isLeader) {
+    PlanFlightPublisher publisher(ctx, key, *flight);
+    if (ctx.planningHook != NULL) ctx.planningHook(&ctx, ctx.planningHookArg);
+    PlanningThreadGuard planningThread(ctx);
+    ctx.numPlanningRun++;
+    publisher.result = choosePlan(rank, dim, permutation, sizeofType, deviceID, prop,
+      ctx.config.numPosMbarSample, flight->plan);
+  } else {
+    ctx.numPlanFollower++;
+    std::unique_lock<std::mutex> lock(flight->mutex);
+    flight->done.wait(lock, [&flight]{return flight->ready;});
+    ctx.numPlanFollower--;
+  }
+  if (flight->result != CUTT_SUCCESS) return flight->result;
+
+  // Create copy of the plan with its own device buffers
+  cuttPlan_t* plan = new cuttPlan_t();
+  *plan = flight->plan;
+  plan->requestDim.assign(dim, dim + rank);
+  plan->requestPermutation.assign(permutation, permutation + rank);
+
   // Set stream
   plan->setStream(stream);
 
   // Activate plan
   plan->activate();
 
-  // Insert plan into storage
-  {
-    std::lock_guard<std::mutex> lock(planStorageMutex);
-    planStorage.insert( {*handle, plan} );
+  // Insert plan into storage and create new handle
+  if (!ctx.planStorage.insert(plan, *handle)) {
+    delete plan;
+    return CUTT_INTERNAL_ERROR;
   }
 
 #ifdef ENABLE_NVTOOLS
@@ -204,24 +397,10 @@ cuttResult cuttPlan(cuttHandle* handle, int rank, int* dim, int* permutation, si
   return CUTT_SUCCESS;
 }
 
-cuttResult cuttPlanMeasure(cuttHandle* handle, int rank, int* dim, int* permutation, size_t sizeofType,
-  hipStream_t stream, void* idata, void* odata) {
-
-  // Check that input parameters are valid
-  cuttResult inpCheck = cuttPlanCheckInput(rank, dim, permutation, sizeofType);
-  if (inpCheck != CUTT_SUCCESS) return inpCheck;
-
-  if (idata == odata) return CUTT_INVALID_PARAMETER;
-
-  // Create new handle
-  *handle = curHandle;
-  curHandle++;
+static cuttResult createPlanMeasure(cuttContext_t& ctx, cuttHandle* handle, int rank, int* dim,
+  int* permutation, size_t sizeofType, hipStream_t stream, void* idata, void* odata) {
 
-  // Check that the current handle is available (it better be!)
-  {
-    std::lock_guard<std::mutex> lock(planStorageMutex);
-    if (planStorage.count(*handle) != 0) return CUTT_INTERNAL_ERROR;
-  }
+  PlanningThreadGuard planningThread(ctx);
 
   // Prepare device
   int deviceID;
@@ -247,10 +426,22 @@ cuttResult cuttPlanMeasure(cuttHandle* handle, int rank, int* dim, int* permutat
     sizeofType, deviceID, prop, plans)) return CUTT_INTERNAL_ERROR;
 #endif
 
-  // // Count cycles
-  // for (auto it=plans.begin();it != plans.end();it++) {
-  //   if (!it->countCycles(prop, 10)) return CUTT_INTERNAL_ERROR;
-  // }
+  // Search launch configurations with the model. Candidates whose launch configuration the
+  // model changed are measured with the default configuration too, to confirm the choice
+  std::list<cuttPlan_t> defaultPlans(plans);
+  ModelMemo memo;
+  for (auto it=plans.begin();it != plans.end();it++) {
+    if (!it->countCycles(prop, ctx.config.numPosMbarSample, &memo)) return CUTT_INTERNAL_ERROR;
+  }
+  if (!cuttPlan_t::searchLaunchConfigs(plans, prop, ctx.config.numPosMbarSample, &memo)) return CUTT_INTERNAL_ERROR;
+  for (auto it=plans.begin(), itd=defaultPlans.begin();itd != defaultPlans.end();it++,itd++) {
+    const LaunchConfig& lc = it->launchConfig;
+    const LaunchConfig& lcd = itd->launchConfig;
+    if (lc.numRegStorage != lcd.numRegStorage || lc.numthread.x != lcd.numthread.x ||
+      lc.numblock.x != lcd.numblock.x || lc.numblock.y != lcd.numblock.y || lc.numblock.z != lcd.numblock.z) {
+      plans.push_back(*itd);
+    }
+  }
 
   // // Count the number of elements
   size_t numBytes = sizeofType;
@@ -269,7 +460,7 @@ cuttResult cuttPlanMeasure(cuttHandle* handle, int rank, int* dim, int* permutat
     hipCheck(hipDeviceSynchronize());
     timer.start();
     // Execute plan
-    if (!cuttKernel(*it, idata, odata)) return CUTT_INTERNAL_ERROR;
+    if (!cuttKernel(*it, idata, odata, it->stream)) return CUTT_INTERNAL_ERROR;
     timer.stop();
     double curTime = timer.seconds();
     // it->print();
@@ -281,11 +472,16 @@ cuttResult cuttPlanMeasure(cuttHandle* handle, int rank, int* dim, int* permutat
     }
   }
   if (bestPlan == plans.end()) return CUTT_INTERNAL_ERROR;
+  // Candidate buffers go back to the buffer pool on return, wait for the last candidate
+  hipCheck(hipDeviceSynchronize());
 
   // bestPlan = plans.begin();
 
   // printMatlab(prop, plans, times);
-  // findMispredictionBest(plans, times, bestPlan, bestTime);
+#ifdef ENABLE_MODEL_EVAL
+  // Record candidate timings for cutt_model_eval
+  printModelEval(rank, dim, permutation, sizeofType, plans, times);
+#endif
   // bestPlan->print();
 
   // Create copy of the plan outside the list
@@ -294,6 +490,8 @@ cuttResult cuttPlanMeasure(cuttHandle* handle, int rank, int* dim, int* permutat
   // Set device pointers to NULL in the old copy of the plan so
   // that they won't be deallocated later when the object is destroyed
   bestPlan->nullDevicePointers();
+  plan->requestDim.assign(dim, dim + rank);
+  plan->requestPermutation.assign(permutation, permutation + rank);
 
   // Set stream
   plan->setStream(stream);
@@ -301,57 +499,312 @@ cuttResult cuttPlanMeasure(cuttHandle* handle, int rank, int* dim, int* permutat
   // Activate plan
   plan->activate();
 
-  // Insert plan into storage
+  // Insert plan into storage and create new handle
+  if (!ctx.planStorage.insert(plan, *handle)) {
+    delete plan;
+    return CUTT_INTERNAL_ERROR;
+  }
+
+  return CUTT_SUCCESS;
+}
+
+//
+// Frees retired plans of ctx whose executions are done. With wait, waits for all retired plans
+//
+static void reclaimPlans(cuttContext_t& ctx, const bool wait) {
+  std::vector<RetiredPlan> done;
   {
-    std::lock_guard<std::mutex> lock(planStorageMutex);
-    planStorage.insert( {*handle, plan} );
+    std::lock_guard<std::mutex> lock(ctx.retiredPlansMutex);
+    std::vector<RetiredPlan> pending;
+    for (int i=0;i < (int)ctx.retiredPlans.size();i++) {
+      RetiredPlan& r = ctx.retiredPlans[i];
+      bool isDone = true;
+      for (int j=0;j < (int)r.events.size() && isDone;j++) {
+        if (wait) {
+          hipCheck(hipEventSynchronize(r.events[j]));
+        } else {
+          isDone = (hipEventQuery(r.events[j]) != hipErrorNotReady);
+        }
+      }
+      if (isDone) {
+        done.push_back(r);
+      } else {
+        pending.push_back(r);
+      }
+    }
+    ctx.retiredPlans.swap(pending);
+  }
+  if (done.empty()) return;
+
+  int curDeviceID;
+  hipCheck(hipGetDevice(&curDeviceID));
+  int deviceID = curDeviceID;
+  for (int i=0;i < (int)done.size();i++) {
+    // Device buffers are freed on the device of the plan
+    if (done[i].plan->deviceID != deviceID) {
+      deviceID = done[i].plan->deviceID;
+      hipCheck(hipSetDevice(deviceID));
+    }
+    delete done[i].plan;
   }
+  if (deviceID != curDeviceID) hipCheck(hipSetDevice(curDeviceID));
+}
 
+//
+// Retires a plan that has been removed from the plan storage of ctx. The plan is freed by
+// reclaimPlans() once the events recorded after its executions have passed. Streams are not
+// used, they may have been destroyed already. Does not block unless the plan was executed on
+// more streams than are tracked
+//
+static void retirePlan(cuttContext_t& ctx, cuttPlan_t* plan) {
+  RetiredPlan r;
+  r.plan = plan;
+  if (!plan->execEvents.get(r.events)) {
+    int curDeviceID;
+    hipCheck(hipGetDevice(&curDeviceID));
+    if (curDeviceID != plan->deviceID) hipCheck(hipSetDevice(plan->deviceID));
+    hipCheck(hipDeviceSynchronize());
+    if (curDeviceID != plan->deviceID) hipCheck(hipSetDevice(curDeviceID));
+    r.events.clear();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(ctx.retiredPlansMutex);
+    ctx.retiredPlans.push_back(r);
+  }
+  // Free the plans retired earlier that are done. Their buffers go to the buffer pool, this
+  // does not synchronize the device
+  reclaimPlans(ctx, false);
+}
+
+void cuttGetDefaultContextConfig(cuttContextConfig* config) {
+  config->maxNumPlan = 0;
+  config->maxNumPlanningThread = 0;
+  config->numPosMbarSample = 10;
+  config->coalescePlans = 1;
+}
+
+cuttResult cuttCreateContext(cuttContext* ctx, const cuttContextConfig* config) {
+  cuttContextConfig conf = (config != NULL) ? *config : defaultContextConfig();
+  if (conf.maxNumPlan < 0 || conf.maxNumPlanningThread < 0 || conf.numPosMbarSample < 0) {
+    return CUTT_INVALID_PARAMETER;
+  }
+  *ctx = new cuttContext_t(conf);
   return CUTT_SUCCESS;
 }
 
-//void CUDART_CB cuttDestroy_callback(hipStream_t stream, hipError_t status, void *userData){
-void cuttDestroy_callback(hipStream_t stream, hipError_t status, void *userData){
-  cuttPlan_t* plan = (cuttPlan_t*) userData;
-  delete plan;
+cuttResult cuttDestroyContext(cuttContext ctx) {
+  if (ctx == NULL || ctx == &defaultContext) return CUTT_INVALID_PARAMETER;
+  std::vector<cuttPlan_t*> plans;
+  ctx->planStorage.clear(plans);
+  for (int i=0;i < (int)plans.size();i++) retirePlan(*ctx, plans[i]);
+  reclaimPlans(*ctx, true);
+  delete ctx;
+  return CUTT_SUCCESS;
 }
 
-cuttResult cuttDestroy(cuttHandle handle) {
-  std::lock_guard<std::mutex> lock(planStorageMutex);
-  auto it = planStorage.find(handle);
-  if (it == planStorage.end()) return CUTT_INVALID_PLAN;
-#ifdef CUTT_HAS_UMPIRE
-  // get the pointer cuttPlan_t
-  cuttPlan_t* plan = it->second;
-  hipStream_t stream = plan->stream;
-  // Delete entry from plan storage
-  planStorage.erase(it);
-  // register callback to deallocate plan
-  hipStreamAddCallback(stream, cuttDestroy_callback, plan, 0);
-#else
-  // Delete instance of cuttPlan_t	 
-  delete it->second;	  
-  // Delete entry from plan storage	  
-  planStorage.erase(it);
+int cuttGetNumPlanningRun(cuttContext ctx) {
+  return ctx->numPlanningRun;
+}
+
+int cuttGetNumPlanFollower(cuttContext ctx) {
+  return ctx->numPlanFollower;
+}
+
+void cuttSetPlanningHook(cuttContext ctx, void (*hook)(cuttContext ctx, void* arg), void* arg) {
+  ctx->planningHook = hook;
+  ctx->planningHookArg = arg;
+}
+
+cuttResult cuttPlanCtx(cuttContext ctx, cuttHandle* handle, int rank, int* dim, int* permutation,
+  size_t sizeofType, hipStream_t stream) {
+
+#ifdef ENABLE_NVTOOLS
+  gpuRangeStart("init");
 #endif
+
+  if (ctx == NULL) return CUTT_INVALID_PARAMETER;
+
+  // Check that input parameters are valid
+  cuttResult inpCheck = cuttPlanCheckInput(rank, dim, permutation, sizeofType);
+  if (inpCheck != CUTT_SUCCESS) return inpCheck;
+
+  if (!reservePlan(*ctx)) return CUTT_LIMIT_EXCEEDED;
+  cuttResult result = createPlan(*ctx, handle, rank, dim, permutation, sizeofType, stream);
+  if (result != CUTT_SUCCESS) ctx->numPlan.fetch_sub(1);
+  return result;
+}
+
+cuttResult cuttPlanMeasureCtx(cuttContext ctx, cuttHandle* handle, int rank, int* dim, int* permutation,
+  size_t sizeofType, hipStream_t stream, void* idata, void* odata) {
+
+  if (ctx == NULL) return CUTT_INVALID_PARAMETER;
+
+  // Check that input parameters are valid
+  cuttResult inpCheck = cuttPlanCheckInput(rank, dim, permutation, sizeofType);
+  if (inpCheck != CUTT_SUCCESS) return inpCheck;
+
+  if (idata == odata) return CUTT_INVALID_PARAMETER;
+
+  if (!reservePlan(*ctx)) return CUTT_LIMIT_EXCEEDED;
+  cuttResult result = createPlanMeasure(*ctx, handle, rank, dim, permutation, sizeofType, stream,
+    idata, odata);
+  if (result != CUTT_SUCCESS) ctx->numPlan.fetch_sub(1);
+  return result;
+}
+
+cuttResult cuttDestroyCtx(cuttContext ctx, cuttHandle handle) {
+  if (ctx == NULL) return CUTT_INVALID_PARAMETER;
+  // Returns once executes that may have found the plan are done with it
+  cuttPlan_t* plan = ctx->planStorage.erase(handle);
+  if (plan == NULL) return CUTT_INVALID_PLAN;
+  ctx->numPlan.fetch_sub(1);
+  retirePlan(*ctx, plan);
   return CUTT_SUCCESS;
 }
 
-cuttResult cuttExecute(cuttHandle handle, void* idata, void* odata) {
-  // prevent modification when find
-  std::lock_guard<std::mutex> lock(planStorageMutex);
-  auto it = planStorage.find(handle);
-  if (it == planStorage.end()) return CUTT_INVALID_PLAN;
+// Executes plan of handle on stream, or on the stream of the plan if useStream is false
+static cuttResult executePlan(cuttContext_t& ctx, cuttHandle handle, void* idata, void* odata,
+  const bool useStream, hipStream_t stream) {
+
+  // Plan stays alive until the guard goes out of scope
+  PlanStorage::ReadGuard guard(ctx.planStorage);
+  cuttPlan_t* planPtr = ctx.planStorage.find(handle);
+  if (planPtr == NULL) return CUTT_INVALID_PLAN;
 
   if (idata == odata) return CUTT_INVALID_PARAMETER;
 
-  cuttPlan_t& plan = *(it->second);
+  cuttPlan_t& plan = *planPtr;
 
   int deviceID;
   hipCheck(hipGetDevice(&deviceID));
   if (deviceID != plan.deviceID) return CUTT_INVALID_DEVICE;
 
-  if (!cuttKernel(plan, idata, odata)) return CUTT_INTERNAL_ERROR;
+  hipStream_t execStream = useStream ? stream : plan.stream;
+  if (!cuttKernel(plan, idata, odata, execStream)) return CUTT_INTERNAL_ERROR;
+  // Destruction of the plan waits for this event instead of the stream
+  plan.execEvents.record(execStream);
+  return CUTT_SUCCESS;
+}
+
+cuttResult cuttExecuteCtx(cuttContext ctx, cuttHandle handle, void* idata, void* odata) {
+  if (ctx == NULL) return CUTT_INVALID_PARAMETER;
+  return executePlan(*ctx, handle, idata, odata, false, 0);
+}
+
+cuttResult cuttExecuteAsyncCtx(cuttContext ctx, cuttHandle handle, void* idata, void* odata,
+  hipStream_t stream) {
+  if (ctx == NULL) return CUTT_INVALID_PARAMETER;
+  return executePlan(*ctx, handle, idata, odata, true, stream);
+}
+
+// Returns true if plans made for a device with properties a are valid and have the same
+// cost on a device with properties b
+static bool isSameDevice(const hipDeviceProp_t& a, const hipDeviceProp_t& b) {
+  return (strcmp(a.name, b.name) == 0 && strcmp(a.gcnArchName, b.gcnArchName) == 0 &&
+    a.major == b.major && a.minor == b.minor && a.warpSize == b.warpSize &&
+    a.multiProcessorCount == b.multiProcessorCount && a.clockRate == b.clockRate &&
+    a.memoryClockRate == b.memoryClockRate && a.memoryBusWidth == b.memoryBusWidth &&
+    a.l2CacheSize == b.l2CacheSize && a.maxThreadsPerMultiProcessor == b.maxThreadsPerMultiProcessor &&
+    a.maxThreadsPerBlock == b.maxThreadsPerBlock && a.regsPerBlock == b.regsPerBlock &&
+    a.sharedMemPerBlock == b.sharedMemPerBlock &&
+    a.maxSharedMemoryPerMultiProcessor == b.maxSharedMemoryPerMultiProcessor);
+}
+
+// Creates a plan on the current device targetDevice from plan src of another device
+static cuttResult clonePlan(cuttContext_t& ctx, const cuttPlan_t& src, const int targetDevice,
+  cuttHandle* handle) {
+
+  hipDeviceProp_t srcProp;
+  hipDeviceProp_t prop;
+  int deviceID;
+  hipCheck(hipSetDevice(src.deviceID));
+  getDeviceProp(deviceID, srcProp);
+  hipCheck(hipSetDevice(targetDevice));
+  getDeviceProp(deviceID, prop);
+
+  if (!isSameDevice(srcProp, prop)) {
+    // Different device, plan again with the model
+    std::vector<int> dim(src.requestDim);
+    std::vector<int> permutation(src.requestPermutation);
+    return createPlan(ctx, handle, (int)dim.size(), dim.data(), permutation.data(), src.sizeofType, 0);
+  }
+
+  // Same device, copy the plan and upload its descriptors
+  cuttPlan_t* plan = new cuttPlan_t();
+  *plan = src;
+  plan->nullDevicePointers();
+  plan->deviceID = targetDevice;
+  plan->setStream(0);
+  plan->activate();
+
+  if (!ctx.planStorage.insert(plan, *handle)) {
+    delete plan;
+    return CUTT_INTERNAL_ERROR;
+  }
+  return CUTT_SUCCESS;
+}
+
+cuttResult cuttPlanCloneCtx(cuttContext ctx, cuttHandle handle, int targetDevice, cuttHandle* newHandle) {
+  if (ctx == NULL) return CUTT_INVALID_PARAMETER;
+
+  int numDevice;
+  hipCheck(hipGetDeviceCount(&numDevice));
+  if (targetDevice < 0 || targetDevice >= numDevice) return CUTT_INVALID_DEVICE;
+
+  // Copy of the source plan without device buffers, so that it can be destroyed meanwhile
+  cuttPlan_t src;
+  {
+    PlanStorage::ReadGuard guard(ctx->planStorage);
+    cuttPlan_t* planPtr = ctx->planStorage.find(handle);
+    if (planPtr == NULL) return CUTT_INVALID_PLAN;
+    src = *planPtr;
+    src.nullDevicePointers();
+  }
+
+  if (!reservePlan(*ctx)) return CUTT_LIMIT_EXCEEDED;
+  int curDeviceID;
+  hipCheck(hipGetDevice(&curDeviceID));
+  cuttResult result = clonePlan(*ctx, src, targetDevice, newHandle);
+  hipCheck(hipSetDevice(curDeviceID));
+  if (result != CUTT_SUCCESS) ctx->numPlan.fetch_sub(1);
+  return result;
+}
+
+cuttResult cuttPlan(cuttHandle* handle, int rank, int* dim, int* permutation, size_t sizeofType,
+  hipStream_t stream) {
+  return cuttPlanCtx(&defaultContext, handle, rank, dim, permutation, sizeofType, stream);
+}
+
+cuttResult cuttPlanMeasure(cuttHandle* handle, int rank, int* dim, int* permutation, size_t sizeofType,
+  hipStream_t stream, void* idata, void* odata) {
+  return cuttPlanMeasureCtx(&defaultContext, handle, rank, dim, permutation, sizeofType, stream,
+    idata, odata);
+}
+
+cuttResult cuttPlanClone(cuttHandle handle, int targetDevice, cuttHandle* newHandle) {
+  return cuttPlanCloneCtx(&defaultContext, handle, targetDevice, newHandle);
+}
+
+cuttResult cuttDestroy(cuttHandle handle) {
+  return cuttDestroyCtx(&defaultContext, handle);
+}
+
+cuttResult cuttExecute(cuttHandle handle, void* idata, void* odata) {
+  return cuttExecuteCtx(&defaultContext, handle, idata, odata);
+}
+
+cuttResult cuttExecuteAsync(cuttHandle handle, void* idata, void* odata, hipStream_t stream) {
+  return cuttExecuteAsyncCtx(&defaultContext, handle, idata, odata, stream);
+}
+
+cuttResult cuttSaveKernelResources(const char* filename) {
+  if (!cuttKernelResourceSave(filename)) return CUTT_INVALID_PARAMETER;
+  return CUTT_SUCCESS;
+}
+
+cuttResult cuttLoadKernelResources(const char* filename) {
+  if (!cuttKernelResourceLoad(filename)) return CUTT_INVALID_PARAMETER;
   return CUTT_SUCCESS;
 }
 
@@ -363,7 +816,20 @@ void cuttInitialize() {
   const char* alloc_cstr = alloc_env_var ? alloc_env_var : __CUTT_XSTRINGIZE(CUTT_USES_THIS_UMPIRE_ALLOCATOR);
   cutt_umpire_allocator = umpire::ResourceManager::getInstance().getAllocator(alloc_cstr);
 #endif
+
+  // Eager initialization of all devices, one thread per device
+  const char* prewarm_env_var = std::getenv("CUTT_PREWARM");
+  if (prewarm_env_var != NULL && std::atoi(prewarm_env_var) != 0) {
+    int numDevice;
+    hipCheck(hipGetDeviceCount(&numDevice));
+    std::vector<std::thread> threads;
+    for (int i=0;i < numDevice;i++) threads.push_back(std::thread(prewarmDevice, i));
+    for (int i=0;i < numDevice;i++) threads[i].join();
+  }
 }
 
 void cuttFinalize() {
+  // Free the destroyed plans of the default context and the buffers kept for reuse
+  reclaimPlans(defaultContext, true);
+  cuttPlanReleaseBuffers();
 }
@@ -27,6 +27,10 @@ SOFTWARE.
 
 #include <hip/hip_runtime.h>
 
+// Library version
+#define CUTT_VERSION_MAJOR 1
+#define CUTT_VERSION_MINOR 1
+
 // Handle type that is used to store and access cutt plans
 typedef unsigned int cuttHandle;
 
@@ -38,18 +42,40 @@ typedef enum cuttResult_t {
   CUTT_INVALID_DEVICE,     // Execution tried on device different than where plan was created
   CUTT_INTERNAL_ERROR,     // Internal error
   CUTT_UNDEFINED_ERROR,    // Undefined error
+  CUTT_LIMIT_EXCEEDED,     // Plan limit of the context reached
 } cuttResult;
 
+// Context: plan storage and planning configuration. Plans belong to the context that created
+// them, their handles are only valid in that context. Contexts share nothing but the device
+// properties and kernel resource usage, which are the same for all contexts
+typedef struct cuttContext_t* cuttContext;
+
+// Configuration of a context
+typedef struct cuttContextConfig_t {
+  // Maximum number of plans in the context, 0 for no limit
+  int maxNumPlan;
+  // Maximum number of threads creating plans in the context at the same time, 0 for no limit.
+  // Further plan calls wait until one is done
+  int maxNumPlanningThread;
+  // Minimum number of Mbar positions the cost model samples per candidate plan
+  int numPosMbarSample;
+  // If non-zero, concurrent cuttPlan calls for the same tensor wait for one of them to plan
+  int coalescePlans;
+} cuttContextConfig;
+
 // Initializes cuTT
 //
-// This is only needed for the Umpire allocator's lifetime management:
 // - if CUTT_HAS_UMPIRE is defined, will grab Umpire's allocator;
+// - if the environment variable CUTT_PREWARM is set to a non-zero value, initializes all
+//   devices and queries resource usage of all kernels, in parallel across devices, so that
+//   the first cuttPlan() on each device is as fast as the following ones;
 // - otherwise this is a no-op
 void cuttInitialize();
 
 // Finalizes cuTT
 //
-// This is currently a no-op
+// Waits for the work on plans destroyed with cuttDestroy() to finish and frees them, and frees
+// the device buffers kept for reuse by new plans
 void cuttFinalize();
 
 //
@@ -88,9 +114,32 @@ cuttResult cuttPlan(cuttHandle* handle, int rank, int* dim, int* permutation, si
 cuttResult cuttPlanMeasure(cuttHandle* handle, int rank, int* dim, int* permutation, size_t sizeofType,
   hipStream_t stream, void* idata, void* odata);
 
+//
+// Clone plan to another device
+//
+// If the target device has the same architecture and properties as the device of the plan, the
+// chosen implementation is reused and only the device buffers of the plan are created on the
+// target device. Otherwise the plan is made again for the target device with the heuristics.
+// The new plan uses the NULL stream of the target device, use cuttExecuteAsync() for others.
+//
+// Parameters
+// handle            = Handle to the cuTT plan
+// targetDevice      = Device to create the new plan on
+// newHandle         = Returned handle to the new plan
+//
+// Returns
+// Success/unsuccess code
+//
+cuttResult cuttPlanClone(cuttHandle handle, int targetDevice, cuttHandle* newHandle);
+
 //
 // Destroy plan
 //
+// Does not wait for the GPU. The device buffers of the plan are kept for reuse by new plans
+// once the executions of the plan queued before this call are done, which is checked by later
+// cuttPlan() and cuttDestroy() calls and waited for by cuttFinalize(). The streams the plan
+// was executed on are not used, they may be destroyed before this call.
+//
 // Parameters
 // handle            = Handle to the cuTT plan
 // 
@@ -112,4 +161,83 @@ cuttResult cuttDestroy(cuttHandle handle);
 //
 cuttResult cuttExecute(cuttHandle handle, void* idata, void* odata);
 
+//
+// Execute plan out-of-place on a given stream
+//
+// The plan is not bound to the stream it was created on: one plan can be executed on any
+// number of streams of its device, also concurrently.
+//
+// Parameters
+// handle            = Handle to the cuTT plan
+// idata             = Input data size product(dim)
+// odata             = Output data size product(dim)
+// stream            = Stream to execute on
+//
+// Returns
+// Success/unsuccess code
+//
+cuttResult cuttExecuteAsync(cuttHandle handle, void* idata, void* odata, hipStream_t stream);
+
+//
+// Context-aware API
+//
+// cuttPlan, cuttPlanMeasure, cuttDestroy and cuttExecute use a default context with the
+// default configuration. The functions below take the context explicitly and otherwise behave
+// the same.
+//
+
+// Sets config to the default configuration: no limits, 10 Mbar samples, coalesced planning
+void cuttGetDefaultContextConfig(cuttContextConfig* config);
+
+//
+// Create context
+//
+// Parameters
+// ctx               = Returned context
+// config            = Configuration, NULL for the default configuration
+//
+// Returns
+// Success/unsuccess code
+//
+cuttResult cuttCreateContext(cuttContext* ctx, const cuttContextConfig* config);
+
+//
+// Destroy context and the plans left in it. The context must not be in use by other threads
+//
+cuttResult cuttDestroyContext(cuttContext ctx);
+
+cuttResult cuttPlanCtx(cuttContext ctx, cuttHandle* handle, int rank, int* dim, int* permutation,
+  size_t sizeofType, hipStream_t stream);
+
+cuttResult cuttPlanMeasureCtx(cuttContext ctx, cuttHandle* handle, int rank, int* dim, int* permutation,
+  size_t sizeofType, hipStream_t stream, void* idata, void* odata);
+
+cuttResult cuttPlanCloneCtx(cuttContext ctx, cuttHandle handle, int targetDevice, cuttHandle* newHandle);
+
+cuttResult cuttDestroyCtx(cuttContext ctx, cuttHandle handle);
+
+cuttResult cuttExecuteCtx(cuttContext ctx, cuttHandle handle, void* idata, void* odata);
+
+cuttResult cuttExecuteAsyncCtx(cuttContext ctx, cuttHandle handle, void* idata, void* odata,
+  hipStream_t stream);
+
+//
+// Save and load kernel resource usage
+//
+// The resource usage of the transpose kernels is queried from the GPU on first use and kept
+// in a table keyed by device architecture. Saving the table and loading it in a later process
+// skips the queries. A file is valid on any host with the same GPUs that runs the same version
+// of the library, built with the same MAX_REG_STORAGE. Loading checks one entry against the
+// kernels on the current device.
+//
+// Parameters
+// filename          = Name of the file
+//
+// Returns
+// Success/unsuccess code. CUTT_INVALID_PARAMETER if the file cannot be written or read, or if
+// it does not match this build
+//
+cuttResult cuttSaveKernelResources(const char* filename);
+cuttResult cuttLoadKernelResources(const char* filename);
+
 #endif // CUTT_H
@@ -0,0 +1,45 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#ifndef CUTTCONTEXTDEBUG_H
+#define CUTTCONTEXTDEBUG_H
+
+#include "cutt.h"
+
+//
+// Inspection of contexts for the tests, not part of the API
+//
+
+// Number of times ctx ran the plan search for a cuttPlan call. Coalesced calls that copied the
+// plan of another call do not count
+int cuttGetNumPlanningRun(cuttContext ctx);
+
+// Number of cuttPlan calls of ctx waiting for the plan of a coalesced call
+int cuttGetNumPlanFollower(cuttContext ctx);
+
+// Sets the function cuttPlan calls of ctx call before they run the plan search, NULL for none.
+// The calls that coalesce with it wait until the function returns
+void cuttSetPlanningHook(cuttContext ctx, void (*hook)(cuttContext ctx, void* arg), void* arg);
+
+#endif // CUTTCONTEXTDEBUG_H
@@ -0,0 +1,311 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include "cuttplan.h"
+#include "cuttkernel.h"
+#include "cuttDeviceProfile.h"
+#ifndef CUTT_PLANNER_ONLY
+#include "CudaUtils.h"
+#endif
+
+// Integer and size_t fields of hipDeviceProp_t stored in profiles
+#define PROFILE_INT_FIELDS(X) \
+  X(regsPerBlock) X(warpSize) X(maxThreadsPerBlock) X(clockRate) X(memoryClockRate) \
+  X(memoryBusWidth) X(major) X(minor) X(multiProcessorCount) X(l2CacheSize) \
+  X(maxThreadsPerMultiProcessor) X(ECCEnabled)
+#define PROFILE_SIZE_FIELDS(X) \
+  X(totalGlobalMem) X(sharedMemPerBlock) X(maxSharedMemoryPerMultiProcessor)
+
+cuttDeviceProfile::cuttDeviceProfile() {
+  memset(&prop, 0, sizeof(prop));
+  l2LineSize = 0;
+  l2Assoc = 0;
+}
+
+KernelResource cuttDeviceProfile::getKernelResource(const int method, const int sizeofType,
+  const int numRegStorage) const {
+
+  std::vector<int> key(3);
+  key[0] = method;
+  key[1] = sizeofType;
+  key[2] = (method == Packed || method == PackedSplit) ? numRegStorage : 0;
+  std::map< std::vector<int>, KernelResource >::const_iterator it = kernelResource.find(key);
+  if (it != kernelResource.end()) return it->second;
+
+  // Not captured: only the static shared memory of the tiled kernel is known
+  KernelResource kr;
+  kr.numRegs = 0;
+  kr.sharedSizeBytes = 0;
+  kr.maxThreadsPerBlock = prop.maxThreadsPerBlock;
+  kr.localSizeBytes = 0;
+  if (method == Tiled) {
+    int padding = (sizeofType < 4) ? 4/sizeofType : 1;
+    kr.sharedSizeBytes = TILEDIM*(TILEDIM + padding)*sizeofType;
+  }
+  return kr;
+}
+
+void cuttDeviceProfile::setKernelResource(const int method, const int sizeofType,
+  const int numRegStorage, const KernelResource& kr) {
+  std::vector<int> key(3);
+  key[0] = method;
+  key[1] = sizeofType;
+  key[2] = (method == Packed || method == PackedSplit) ? numRegStorage : 0;
+  kernelResource[key] = kr;
+}
+
+//
+// Built-in profiles. Values are those reported by hipGetDeviceProperties() (or
+// cudaGetDeviceProperties()) on the devices. AMD GPUs with several dies report one die.
+//
+struct BuiltinProfile {
+  const char* key;
+  const char* name;
+  const char* gcnArchName;
+  int major;
+  int minor;
+  int warpSize;
+  int multiProcessorCount;
+  int clockRate;
+  int memoryClockRate;
+  int memoryBusWidth;
+  int l2CacheSize;
+  int l2LineSize;
+  int l2Assoc;
+  int maxThreadsPerMultiProcessor;
+  size_t sharedMemPerBlock;
+  size_t maxSharedMemoryPerMultiProcessor;
+  int ECCEnabled;
+  size_t totalGlobalMem;
+};
+
+static const BuiltinProfile builtinProfiles[] = {
+  {"K20X", "Tesla K20X", "",
+    3, 5, 32, 14, 732000, 2600000, 384, 1572864, 128, 16, 2048, 49152, 49152, 1, 6ULL << 30},
+  {"TitanX", "GeForce GTX TITAN X", "",
+    5, 2, 32, 24, 1076000, 3505000, 384, 3145728, 128, 16, 2048, 49152, 98304, 0, 12ULL << 30},
+  {"V100", "Tesla V100-SXM2-16GB", "",
+    7, 0, 32, 80, 1530000, 877000, 4096, 6291456, 128, 16, 2048, 49152, 98304, 1, 16ULL << 30},
+  {"MI100", "AMD Instinct MI100", "gfx908:sramecc+:xnack-",
+    9, 0, 64, 120, 1502000, 1200000, 4096, 8388608, 128, 16, 2560, 65536, 65536, 0, 32ULL << 30},
+  {"MI250", "AMD Instinct MI250", "gfx90a:sramecc+:xnack-",
+    9, 0, 64, 104, 1700000, 1600000, 4096, 8388608, 128, 16, 2048, 65536, 65536, 0, 64ULL << 30}
+};
+
+static const int numBuiltinProfile = sizeof(builtinProfiles)/sizeof(BuiltinProfile);
+
+std::vector<std::string> cuttDeviceProfileNames() {
+  std::vector<std::string> names;
+  for (int i=0;i < numBuiltinProfile;i++) names.push_back(builtinProfiles[i].key);
+  return names;
+}
+
+bool cuttGetDeviceProfile(const char* name, cuttDeviceProfile& profile) {
+  for (int i=0;i < numBuiltinProfile;i++) {
+    const BuiltinProfile& b = builtinProfiles[i];
+    if (strcmp(name, b.key) != 0) continue;
+    profile = cuttDeviceProfile();
+    hipDeviceProp_t& prop = profile.prop;
+    strncpy(prop.name, b.name, sizeof(prop.name) - 1);
+    strncpy(prop.gcnArchName, b.gcnArchName, sizeof(prop.gcnArchName) - 1);
+    prop.major = b.major;
+    prop.minor = b.minor;
+    prop.warpSize = b.warpSize;
+    prop.multiProcessorCount = b.multiProcessorCount;
+    prop.clockRate = b.clockRate;
+    prop.memoryClockRate = b.memoryClockRate;
+    prop.memoryBusWidth = b.memoryBusWidth;
+    prop.l2CacheSize = b.l2CacheSize;
+    profile.l2LineSize = b.l2LineSize;
+    profile.l2Assoc = b.l2Assoc;
+    prop.maxThreadsPerMultiProcessor = b.maxThreadsPerMultiProcessor;
+    prop.sharedMemPerBlock = b.sharedMemPerBlock;
+    prop.maxSharedMemoryPerMultiProcessor = b.maxSharedMemoryPerMultiProcessor;
+    prop.ECCEnabled = b.ECCEnabled;
+    prop.totalGlobalMem = b.totalGlobalMem;
+    prop.regsPerBlock = 65536;
+    prop.maxThreadsPerBlock = 1024;
+    prop.maxThreadsDim[0] = 1024;
+    prop.maxThreadsDim[1] = 1024;
+    prop.maxThreadsDim[2] = (b.warpSize == 64) ? 1024 : 64;
+    prop.maxGridSize[0] = 2147483647;
+    prop.maxGridSize[1] = (b.warpSize == 64) ? 2147483647 : 65535;
+    prop.maxGridSize[2] = (b.warpSize == 64) ? 2147483647 : 65535;
+    return true;
+  }
+  return false;
+}
+
+bool cuttReadDeviceProfile(const char* filename, cuttDeviceProfile& profile) {
+  std::ifstream file(filename);
+  if (!file.is_open()) {
+    printf("cuttReadDeviceProfile: Unable to open file %s\n", filename);
+    return false;
+  }
+  profile = cuttDeviceProfile();
+  hipDeviceProp_t& prop = profile.prop;
+  std::string line;
+  int lineNum = 0;
+  while (std::getline(file, line)) {
+    lineNum++;
+    if (line.empty() || line[0] == '#') continue;
+    std::istringstream in(line);
+    std::string key;
+    in >> key;
+    bool ok = true;
+    if (key == "name" || key == "gcnArchName") {
+      std::string val;
+      std::getline(in >> std::ws, val);
+      char* dst = (key == "name") ? prop.name : prop.gcnArchName;
+      strncpy(dst, val.c_str(), 255);
+    } else if (key == "maxThreadsDim") {
+      ok = (bool)(in >> prop.maxThreadsDim[0] >> prop.maxThreadsDim[1] >> prop.maxThreadsDim[2]);
+    } else if (key == "maxGridSize") {
+      ok = (bool)(in >> prop.maxGridSize[0] >> prop.maxGridSize[1] >> prop.maxGridSize[2]);
+    } else if (key == "l2LineSize") {
+      ok = (bool)(in >> profile.l2LineSize) && profile.l2LineSize > 0;
+    } else if (key == "l2Assoc") {
+      ok = (bool)(in >> profile.l2Assoc) && profile.l2Assoc > 0;
+    } else if (key == "kernel") {
+      int method, sizeofType, numRegStorage;
+      KernelResource kr;
+      ok = (bool)(in >> method >> sizeofType >> numRegStorage >> kr.numRegs >> kr.sharedSizeBytes >> kr.maxThreadsPerBlock);
+      // Local memory was added later, older profiles do not have it
+      if (ok && !(in >> kr.localSizeBytes)) kr.localSizeBytes = 0;
+      if (ok) profile.setKernelResource(method, sizeofType, numRegStorage, kr);
+    }
+#define X(FIELD) else if (key == #FIELD) { ok = (bool)(in >> prop.FIELD); }
+    PROFILE_INT_FIELDS(X)
+    PROFILE_SIZE_FIELDS(X)
+#undef X
+    else {
+      ok = false;
+    }
+    if (!ok) {
+      printf("cuttReadDeviceProfile: Invalid line %d in file %s\n", lineNum, filename);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool cuttWriteDeviceProfile(const char* filename, const cuttDeviceProfile& profile) {
+  FILE* fp = fopen(filename, "w");
+  if (fp == NULL) {
+    printf("cuttWriteDeviceProfile: Unable to open file %s\n", filename);
+    return false;
+  }
+  const hipDeviceProp_t& prop = profile.prop;
+  fprintf(fp, "name %s\n", prop.name);
+  if (prop.gcnArchName[0] != 0) fprintf(fp, "gcnArchName %s\n", prop.gcnArchName);
+#define X(FIELD) fprintf(fp, "%s %d\n", #FIELD, prop.FIELD);
+  PROFILE_INT_FIELDS(X)
+#undef X
+#define X(FIELD) fprintf(fp, "%s %llu\n", #FIELD, (unsigned long long)prop.FIELD);
+  PROFILE_SIZE_FIELDS(X)
+#undef X
+  if (profile.l2LineSize > 0) fprintf(fp, "l2LineSize %d\n", profile.l2LineSize);
+  if (profile.l2Assoc > 0) fprintf(fp, "l2Assoc %d\n", profile.l2Assoc);
+  fprintf(fp, "maxThreadsDim %d %d %d\n", prop.maxThreadsDim[0], prop.maxThreadsDim[1], prop.maxThreadsDim[2]);
+  fprintf(fp, "maxGridSize %d %d %d\n", prop.maxGridSize[0], prop.maxGridSize[1], prop.maxGridSize[2]);
+  fprintf(fp, "# kernel method sizeofType numRegStorage numRegs sharedSizeBytes maxThreadsPerBlock localSizeBytes\n");
+  for (std::map< std::vector<int>, KernelResource >::const_iterator it=profile.kernelResource.begin();
+    it != profile.kernelResource.end();it++) {
+    fprintf(fp, "kernel %d %d %d %d %d %d %d\n", it->first[0], it->first[1], it->first[2],
+      it->second.numRegs, it->second.sharedSizeBytes, it->second.maxThreadsPerBlock,
+      it->second.localSizeBytes);
+  }
+  fclose(fp);
+  return true;
+}
+
+#ifndef CUTT_PLANNER_ONLY
+
+bool cuttCaptureDeviceProfile(const int deviceID, cuttDeviceProfile& profile) {
+  int curDeviceID;
+  hipCheck(hipGetDevice(&curDeviceID));
+  hipCheck(hipSetDevice(deviceID));
+  profile = cuttDeviceProfile();
+  hipCheck(hipGetDeviceProperties(&profile.prop, deviceID));
+  const int sizeofTypes[3] = {2, 4, 8};
+  for (int i=0;i < 3;i++) {
+    KernelResource kr;
+    for (int numRegStorage=1;numRegStorage <= MAX_REG_STORAGE;numRegStorage++) {
+      if (!isRegStorageDepth(numRegStorage)) continue;
+      if (!cuttKernelResource(Packed, sizeofTypes[i], numRegStorage, deviceID, kr)) return false;
+      profile.setKernelResource(Packed, sizeofTypes[i], numRegStorage, kr);
+      if (!cuttKernelResource(PackedSplit, sizeofTypes[i], numRegStorage, deviceID, kr)) return false;
+      profile.setKernelResource(PackedSplit, sizeofTypes[i], numRegStorage, kr);
+    }
+    if (!cuttKernelResource(Tiled, sizeofTypes[i], 0, deviceID, kr)) return false;
+    profile.setKernelResource(Tiled, sizeofTypes[i], 0, kr);
+    if (!cuttKernelResource(TiledCopy, sizeofTypes[i], 0, deviceID, kr)) return false;
+    profile.setKernelResource(TiledCopy, sizeofTypes[i], 0, kr);
+  }
+  hipCheck(hipSetDevice(curDeviceID));
+  cuttL2CacheGeometry(profile.l2LineSize, profile.l2Assoc);
+  return true;
+}
+
+void cuttL2CacheGeometry(int& lineSize, int& assoc) {
+  lineSize = DEFAULT_L2_LINE_SIZE;
+  assoc = DEFAULT_L2_ASSOC;
+}
+
+#else
+
+// Profile of the calling thread, so that threads can plan for different profiles at the same time
+static thread_local const cuttDeviceProfile* activeProfile = NULL;
+
+void cuttSetDeviceProfile(const cuttDeviceProfile* profile) {
+  activeProfile = profile;
+}
+
+void cuttL2CacheGeometry(int& lineSize, int& assoc) {
+  lineSize = (activeProfile != NULL && activeProfile->l2LineSize > 0) ? activeProfile->l2LineSize : DEFAULT_L2_LINE_SIZE;
+  assoc = (activeProfile != NULL && activeProfile->l2Assoc > 0) ? activeProfile->l2Assoc : DEFAULT_L2_ASSOC;
+}
+
+// Device is given by the profile of the calling thread, deviceID is not used
+bool cuttKernelResource(const int method, const int sizeofType, const int numRegStorage,
+  const int, KernelResource& kr) {
+  if (activeProfile == NULL) {
+    printf("cuttKernelResource: No device profile set\n");
+    return false;
+  }
+  if (sizeofType != 2 && sizeofType != 4 && sizeofType != 8) {
+    printf("cuttKernelResource: Unsupported size %d\n", sizeofType);
+    return false;
+  }
+  if ((method == Packed || method == PackedSplit) &&
+    !isRegStorageDepth(numRegStorage)) return false;
+  kr = activeProfile->getKernelResource(method, sizeofType, numRegStorage);
+  return true;
+}
+
+#endif
@@ -0,0 +1,97 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#ifndef CUTTDEVICEPROFILE_H
+#define CUTTDEVICEPROFILE_H
+
+#include <vector>
+#include <map>
+#include <string>
+#include "cuttHip.h"
+#include "cuttOccupancy.h"
+
+// L2 cache line size in bytes and associativity used when a profile does not give them.
+// The HIP runtime does not report them, so they are also used for planning on a GPU
+const int DEFAULT_L2_LINE_SIZE = 128;
+const int DEFAULT_L2_ASSOC = 16;
+
+//
+// Device profile: properties of a GPU and resource usage of the transpose kernels compiled
+// for it. Used by the planner in place of hipGetDeviceProperties() and hipFuncGetAttributes()
+// so that plans and their cost can be computed on hosts without a GPU.
+//
+// Profiles are stored as text, one "key value" pair per line:
+//   name Tesla V100-SXM2-16GB
+//   warpSize 32
+//   ...
+//   l2LineSize 128
+//   l2Assoc 16
+//   kernel [method] [sizeofType] [numRegStorage] [numRegs] [sharedSizeBytes] [maxThreadsPerBlock]
+// Lines starting with # are ignored.
+//
+class cuttDeviceProfile {
+public:
+  hipDeviceProp_t prop;
+
+  // L2 cache line size in bytes and associativity for the L2 cache simulation of the cost model,
+  // 0 = use the defaults
+  int l2LineSize;
+  int l2Assoc;
+
+  // Resource usage of kernels, key is (method, sizeofType, numRegStorage)
+  // When the table has no entry for a kernel, the register limit is not applied to its occupancy
+  std::map< std::vector<int>, KernelResource > kernelResource;
+
+  cuttDeviceProfile();
+
+  // Returns resource usage of a kernel
+  KernelResource getKernelResource(const int method, const int sizeofType, const int numRegStorage) const;
+  void setKernelResource(const int method, const int sizeofType, const int numRegStorage,
+    const KernelResource& kr);
+};
+
+// Names of the built-in profiles
+std::vector<std::string> cuttDeviceProfileNames();
+
+// Sets profile to the built-in profile of name. Returns false if there is no such profile
+bool cuttGetDeviceProfile(const char* name, cuttDeviceProfile& profile);
+
+bool cuttReadDeviceProfile(const char* filename, cuttDeviceProfile& profile);
+
+bool cuttWriteDeviceProfile(const char* filename, const cuttDeviceProfile& profile);
+
+// L2 cache line size and associativity of the device being planned for. Planner-only builds take
+// them from the device profile of the calling thread
+void cuttL2CacheGeometry(int& lineSize, int& assoc);
+
+#ifndef CUTT_PLANNER_ONLY
+// Captures the profile of a GPU, including the resource usage of all transpose kernels
+bool cuttCaptureDeviceProfile(const int deviceID, cuttDeviceProfile& profile);
+#else
+// Sets the profile cuttKernelResource() and cuttL2CacheGeometry() take kernel resource usage and
+// L2 cache geometry from in the calling thread
+void cuttSetDeviceProfile(const cuttDeviceProfile* profile);
+#endif
+
+#endif // CUTTDEVICEPROFILE_H
@@ -26,10 +26,15 @@ SOFTWARE.
 #include <iostream>
 #include <algorithm>
 #include <random>
-#include <hip/hip_runtime.h>
+#include <cmath>
+#include "cuttHip.h"
 #include <cstring>               // memcpy
 #include "cuttGpuModel.h"
+#ifndef CUTT_PLANNER_ONLY
 #include "cuttGpuModelKernel.h"
+#endif
+#include "CacheSim.h"
+#include "cuttDeviceProfile.h"   // cuttL2CacheGeometry
 #ifdef ENABLE_NVTOOLS
 #include "CudaUtils.h"
 #endif
@@ -205,14 +210,103 @@ void countCacheLines(const int pos, const int n, const int cacheWidth, int& cl_f
 }
 
 //
-// Compute memory element positions
-// Non-vectorized version
+// Compute memory element positions pos[i] = sum_k ((j0 + i)/c[k] % d[k])*ct[k], i = 0...n-1,
+// for one side (in or out) of a descriptor.
+// When sorted by c, the ranks of a descriptor side form a mixed-radix number. Positions are
+// then generated odometer-style: a linear run over the fastest rank followed by carry
+// propagation into the slower ranks, without divisions in the inner loop.
+// Returns false if the ranks do not form a mixed-radix number
+//
+static bool computePosOdometer(const int j0, const int n,
+  const int* c, const int* d, const int* ct, const int numConv, int* pos) {
+
+  // Ranks with d > 1, sorted by c
+  int sc[32];
+  int sd[32];
+  int sct[32];
+  int num = 0;
+  for (int k=0;k < numConv;k++) {
+    if (d[k] == 1) continue;
+    int i = num++;
+    while (i > 0 && sc[i - 1] > c[k]) {
+      sc[i]  = sc[i - 1];
+      sd[i]  = sd[i - 1];
+      sct[i] = sct[i - 1];
+      i--;
+    }
+    sc[i]  = c[k];
+    sd[i]  = d[k];
+    sct[i] = ct[k];
+  }
+
+  if (num == 0) {
+    for (int i=0;i < n;i++) pos[i] = 0;
+    return true;
+  }
+  if (sc[0] != 1) return false;
+  for (int k=1;k < num;k++) {
+    if (sc[k] != sc[k - 1]*sd[k - 1]) return false;
+  }
+
+  // Digits of the starting position
+  int dig[32];
+  int base = 0;
+  for (int k=1;k < num;k++) {
+    dig[k] = (j0 / sc[k]) % sd[k];
+    base += dig[k]*sct[k];
+  }
+  const int d0 = sd[0];
+  const int ct0 = sct[0];
+  int dig0 = j0 % d0;
+
+  int i = 0;
+  while (i < n) {
+    // Linear run over the fastest rank
+    int len = std::min(d0 - dig0, n - i);
+    int p = base + dig0*ct0;
+    for (int t=0;t < len;t++) pos[i + t] = p + t*ct0;
+    i += len;
+    dig0 = 0;
+    // Carry into slower ranks. Top rank wraps around, same as the % in the definition
+    for (int k=1;k < num;k++) {
+      base += sct[k];
+      if (++dig[k] < sd[k]) break;
+      base -= sd[k]*sct[k];
+      dig[k] = 0;
+    }
+  }
+
+  return true;
+}
+
+//
+// Compute memory element positions for vol0...vol1
 //
 void computePos(const int vol0, const int vol1,
   const TensorConvInOut* conv, const int numConv,
   int* posIn, int* posOut) {
 
   int nvol = vol1 - vol0;
+  if (nvol > 0) {
+    int c[32];
+    int d[32];
+    int ct[32];
+    for (int k=0;k < numConv;k++) {
+      c[k]  = conv[k].c_in;
+      d[k]  = conv[k].d_in;
+      ct[k] = conv[k].ct_in;
+    }
+    bool okIn = computePosOdometer(vol0, nvol + 1, c, d, ct, numConv, posIn);
+    for (int k=0;k < numConv;k++) {
+      c[k]  = conv[k].c_out;
+      d[k]  = conv[k].d_out;
+      ct[k] = conv[k].ct_out;
+    }
+    bool okOut = computePosOdometer(vol0, nvol + 1, c, d, ct, numConv, posOut);
+    if (okIn && okOut) return;
+  }
+
+  // Single position or not a mixed-radix descriptor
   for (int i=0;i <= nvol;i++) {
     int posInVal = 0;
     int posOutVal = 0;
@@ -227,72 +321,84 @@ void computePos(const int vol0, const int vol1,
 }
 
 //
-// Compute memory element positions
-// Starts from zero
+// Compute memory element positions for vol0...vol1 using precomputed reciprocals.
+// RANK > 0 : numConv = RANK is a compile-time constant and the rank loop unrolls
+// RANK = 0 : generic version
 //
-void computePos0(const int vol,
-  const int* __restrict__ dIn, const int* __restrict__ cIn, 
-  const int* __restrict__ dOut, const int* __restrict__ cOut,
-  int* __restrict__ posIn, int* __restrict__ posOut) {
-
-  // Element position vector
-  std::vector<int> pIn(32, 0);
-  std::vector<int> pOut(32, 0);
-  // Scalar element position
-  int posInVal = 0;
-  int posOutVal = 0;
-  for (int i=0;i < vol;i++) {
+template <int RANK>
+static void computePosFast(const int vol0, const int vol1,
+  const TensorConvInOutFast* conv, const int numConvIn,
+  int* posIn, int* posOut) {
+
+  const int numConv = (RANK > 0) ? RANK : numConvIn;
+  int nvol = vol1 - vol0;
+  for (int i=0;i <= nvol;i++) {
+    int posInVal = 0;
+    int posOutVal = 0;
+    int j = i + vol0;
+    for (int k=0;k < numConv;k++) {
+      posInVal  += fastMod(fastDiv(j, conv[k].c_in), conv[k].d_in) * conv[k].ct_in;
+      posOutVal += fastMod(fastDiv(j, conv[k].c_out), conv[k].d_out) * conv[k].ct_out;
+    }
     posIn[i] = posInVal;
     posOut[i] = posOutVal;
-    // Advance position
+  }
+}
 
-    int iIn = 0;
-    while (++pIn[iIn] == dIn[iIn]) {
-      pIn[iIn] = 0;
-      iIn++;
-    }
-    posInVal += cIn[iIn];
-    //
-    int iOut = 0;
-    while (++pOut[iOut] == dOut[iOut]) {
-      pOut[iOut] = 0;
-      iOut++;
-    }
-    posOutVal += cOut[iOut];
+typedef void (*computePosFastFunc)(const int vol0, const int vol1,
+  const TensorConvInOutFast* conv, const int numConv, int* posIn, int* posOut);
+
+// Dispatch table indexed by rank
+static const computePosFastFunc computePosFastTable[MAX_SPECIALIZED_RANK + 1] = {
+  computePosFast<0>, computePosFast<1>, computePosFast<2>, computePosFast<3>,
+  computePosFast<4>, computePosFast<5>, computePosFast<6>};
+
+void computePos(const int vol0, const int vol1,
+  const TensorConvInOutFast* conv, const int numConv,
+  int* posIn, int* posOut) {
+
+  if (numConv <= MAX_SPECIALIZED_RANK) {
+    computePosFastTable[numConv](vol0, vol1, conv, numConv, posIn, posOut);
+  } else {
+    computePosFast<0>(vol0, vol1, conv, numConv, posIn, posOut);
   }
 }
 
+//
+// Returns divisor d >= 1 with multiply-shift reciprocal.
+// With l = ceil(log2(d)) and m = floor(2^(31 + l)/d) + 1, floor(n*m/2^(31 + l)) = floor(n/d)
+// for all 0 <= n < 2^31. m <= 2^32 + 1 so that n*m fits in 64 bits
+//
+FastDiv makeFastDiv(const int d) {
+  int l = 0;
+  while ((1LL << l) < (long long)d) l++;
+  FastDiv f;
+  f.d = d;
+  f.shift = 31 + l;
+  f.mul = ((1ULL << f.shift)/(unsigned long long)d) + 1;
+  return f;
+}
+
+void makeFastConv(const TensorConvInOut* conv, const int numConv, TensorConvInOutFast* fastConv) {
+  for (int k=0;k < numConv;k++) {
+    fastConv[k].c_in   = makeFastDiv(conv[k].c_in);
+    fastConv[k].d_in   = makeFastDiv(conv[k].d_in);
+    fastConv[k].ct_in  = conv[k].ct_in;
+    fastConv[k].c_out  = makeFastDiv(conv[k].c_out);
+    fastConv[k].d_out  = makeFastDiv(conv[k].d_out);
+    fastConv[k].ct_out = conv[k].ct_out;
+  }
+}
+
+//
+// Compute memory element positions
+// Starts from zero
+//
 void computePos0(const int vol,
   const TensorConvInOut* conv, const int numConv,
   int* posIn, int* posOut) {
 
-  int dIn[32];
-  int cIn[32];
-  int dOut[32];
-  int cOut[32];
-  //
-  int c_in_prev = conv[0].ct_in;
-  int cIn_prev = conv[0].ct_in;
-  int d_in_prev = 1;
-  //
-  int c_out_prev = conv[0].ct_out;
-  int cOut_prev = conv[0].ct_out;
-  int d_out_prev = 1;
-  for (int i=0;i < numConv;i++) {
-    dIn[i] = conv[i].d_in;
-    cIn[i] = cIn_prev + conv[i].ct_in - d_in_prev*c_in_prev;
-    cIn_prev = cIn[i];
-    c_in_prev = conv[i].ct_in;
-    d_in_prev = conv[i].d_in;
-    //
-    dOut[i] = conv[i].d_out;
-    cOut[i] = cOut_prev + conv[i].ct_out - d_out_prev*c_out_prev;
-    cOut_prev = cOut[i];
-    c_out_prev = conv[i].ct_out;
-    d_out_prev = conv[i].d_out;
-  }
-
-  computePos0(vol, dIn, cIn, dOut, cOut, posIn, posOut);
+  computePos(0, vol - 1, conv, numConv, posIn, posOut);
 }
 
 //
@@ -398,7 +504,7 @@ void countPackedGlTransactions0(const int warpSize, const int accWidth, const in
   const int numPos, const int posMbarIn[INT_VECTOR_LEN], const int posMbarOut[INT_VECTOR_LEN],
   const int volMmk,  const int* __restrict__ posMmkIn, const int* __restrict__ posMmkOut,
   int& gld_tran, int& gst_tran, int& gld_req, int& gst_req,
-  int& cl_full_l2, int& cl_part_l2, int& cl_full_l1, int& cl_part_l1) {
+  int& cl_full_l2, int& cl_part_l2, int& cl_full_l1, int& cl_part_l1, int* posTran) {
 
 #ifdef NO_ALIGNED_ALLOC
   int_vector* writeSegVolMmk = (int_vector *)aligned_malloc(volMmk*sizeof(int_vector), sizeof(int_vector));
@@ -415,6 +521,8 @@ void countPackedGlTransactions0(const int warpSize, const int accWidth, const in
   int_vector writeSeg_prev(-1);
   int_vector gld_tran_tmp(0);
   int_vector gst_tran_tmp(0);
+  // Warps start a new request, warpSize is a power of two
+  const int warpMask = warpSize - 1;
   for (int j=0;j < volMmk;) {
     int_vector posMmkInVec(posMmkIn[j]);
     int_vector posMmkOutVec(posMmkOut[j]);
@@ -430,8 +538,8 @@ void countPackedGlTransactions0(const int warpSize, const int accWidth, const in
     writeSegVolMmk[j] = (posOut >> cacheWidthShift);
 
     j++;
-    readSeg_prev  = (j & 31) ? readSeg : int_vector(-1);
-    writeSeg_prev = (j & 31) ? writeSeg : int_vector(-1);
+    readSeg_prev  = (j & warpMask) ? readSeg : int_vector(-1);
+    writeSeg_prev = (j & warpMask) ? writeSeg : int_vector(-1);
   }
 
   // Global memory transactions
@@ -443,6 +551,11 @@ void countPackedGlTransactions0(const int warpSize, const int accWidth, const in
     gld_tran += gld_tran_array[i];
     gst_tran += gst_tran_array[i];
   }
+  if (posTran != NULL) {
+    for (int i=0;i < numPos;i++) {
+      posTran[i] = gld_tran_array[i] + gst_tran_array[i];
+    }
+  }
   gld_req += ((volMmk + warpSize - 1)/warpSize)*numPos;
   gst_req += ((volMmk + warpSize - 1)/warpSize)*numPos;
 
@@ -474,11 +587,15 @@ void countPackedGlTransactions0(const int warpSize, const int accWidth, const in
 
 //
 // Count numnber of shared memory transactions for Packed -method
+// RANK > 0 : numMsh = RANK is a compile-time constant and the carry loop unrolls
+// RANK = 0 : generic version
 //
-void countPackedShTransactions0(const int warpSize, const int bankWidth, const int numthread,
-  const int volMmk, const TensorConv* msh, const int numMsh,
+template <int RANK>
+static void countPackedShTransactionsN(const int warpSize, const int bankWidth, const int numthread,
+  const int volMmk, const TensorConv* msh, const int numMshIn,
   int& sld_tran, int& sst_tran, int& sld_req, int& sst_req) {
 
+  const int numMsh = (RANK > 0) ? RANK : numMshIn;
   int p[32];
   int d[32];
   int add[32];
@@ -499,23 +616,26 @@ void countPackedShTransactions0(const int warpSize, const int bankWidth, const i
 
   int pos = 0;
 
+  // Number of accesses for each bank
+  std::vector<int> numAccess(warpSize);
+
   for (int j00=0;j00 < volMmk;j00+=numthread) {
     int n0 = std::min(volMmk, j00 + numthread);
     for (int j0=j00;j0 < n0;j0+=warpSize) {
-      // Number of accesses for each bank
-      std::vector<int> numAccess(warpSize, 0);
+      std::fill(numAccess.begin(), numAccess.end(), 0);
       int maxNumAccess = 0;
       int n = std::min(warpSize, volMmk - j0);
       for (int j1=0;j1 < n;j1++) {
         int bank = pos & bankWidthMask;
         maxNumAccess = std::max(maxNumAccess, ++numAccess[bank]);
-        // Advance position
-        int ii = 0;
-        while (++p[ii] == d[ii]) {
+        // Advance position. Nothing is added when the last rank wraps around past volMmk
+        for (int ii=0;ii < numMsh;ii++) {
+          if (++p[ii] < d[ii]) {
+            pos += add[ii];
+            break;
+          }
           p[ii] = 0;
-          ii++;
         }
-        pos += add[ii];
       }
       sld_tran += maxNumAccess;
       sst_tran++;
@@ -525,6 +645,29 @@ void countPackedShTransactions0(const int warpSize, const int bankWidth, const i
   }
 }
 
+typedef void (*countPackedShTransactionsFunc)(const int warpSize, const int bankWidth, const int numthread,
+  const int volMmk, const TensorConv* msh, const int numMsh,
+  int& sld_tran, int& sst_tran, int& sld_req, int& sst_req);
+
+// Dispatch table indexed by rank
+static const countPackedShTransactionsFunc countPackedShTransactionsTable[MAX_SPECIALIZED_RANK + 1] = {
+  countPackedShTransactionsN<0>, countPackedShTransactionsN<1>, countPackedShTransactionsN<2>,
+  countPackedShTransactionsN<3>, countPackedShTransactionsN<4>, countPackedShTransactionsN<5>,
+  countPackedShTransactionsN<6>};
+
+void countPackedShTransactions0(const int warpSize, const int bankWidth, const int numthread,
+  const int volMmk, const TensorConv* msh, const int numMsh,
+  int& sld_tran, int& sst_tran, int& sld_req, int& sst_req) {
+
+  if (numMsh <= MAX_SPECIALIZED_RANK) {
+    countPackedShTransactionsTable[numMsh](warpSize, bankWidth, numthread, volMmk, msh, numMsh,
+      sld_tran, sst_tran, sld_req, sst_req);
+  } else {
+    countPackedShTransactionsN<0>(warpSize, bankWidth, numthread, volMmk, msh, numMsh,
+      sld_tran, sst_tran, sld_req, sst_req);
+  }
+}
+
 //
 // Count numnber of shared memory transactions for Packed -method
 // *** Slow reference version
@@ -559,16 +702,97 @@ void countPackedShTransactionsRef(const int warpSize, const int bankWidth, const
   }
 }
 
+//
+// Greatest common divisor
+//
+static int gcd(int a, int b) {
+  while (b != 0) {
+    int t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+MbarSampler::MbarSampler(const int vol_in, const int numPosMbarSample) : vol(vol_in), n(0), sum(0), sum2(0) {
+  if (numPosMbarSample == 0) {
+    numMin = vol;
+    numMax = vol;
+    stride = 1;
+  } else {
+    numMin = std::min(vol, std::max(2, numPosMbarSample));
+    numMax = std::min(vol, std::max(numMin, MBAR_SAMPLE_MAX));
+    // Stride closest to vol/phi that is coprime to vol. 2654435769 = 2^32/phi
+    stride = std::max(1, (int)(((unsigned long long)vol*2654435769ULL) >> 32));
+    while (gcd(stride, vol) != 1) stride++;
+  }
+}
+
+int MbarSampler::pos(const int k) const {
+  return (int)(((long long)k*(long long)stride) % vol);
+}
+
+int MbarSampler::nextBlock() const {
+  if (n >= numMax) return 0;
+  if (n >= numMin && err() <= 0.02f) return 0;
+  return std::min(MBAR_SAMPLE_BLOCK, numMax - n);
+}
+
+void MbarSampler::add(const int tran) {
+  n++;
+  sum += tran;
+  sum2 += (long long)tran*(long long)tran;
+}
+
+float MbarSampler::err() const {
+  // All positions visited => exact result
+  if (n >= vol) return 0.0f;
+  if (n < 2) return 1.0f;
+  double mean = (double)sum/(double)n;
+  if (mean == 0.0) return 0.0f;
+  double var = ((double)sum2 - (double)sum*(double)sum/(double)n)/(double)(n - 1);
+  return (float)(2.0*sqrt(std::max(0.0, var)/(double)n)/mean);
+}
+
+//
+// Global memory transactions of a tile row of n consecutive elements starting at pos.
+// Threads of the row are split into warps of warpWidth lanes
+//
+static int tileRowTransactions(const int pos, const int n, const int accWidth, const int warpWidth) {
+  int count = 0;
+  for (int i=0;i < n;i += warpWidth) count += glTransactions(pos + i, std::min(warpWidth, n - i), accWidth);
+  return count;
+}
+
+static void tileRowCacheLines(const int pos, const int n, const int cacheWidth, const int warpWidth,
+  int& cl_full, int& cl_part) {
+  cl_full = 0;
+  cl_part = 0;
+  for (int i=0;i < n;i += warpWidth) {
+    int cl_full_tmp, cl_part_tmp;
+    countCacheLines(pos + i, std::min(warpWidth, n - i), cacheWidth, cl_full_tmp, cl_part_tmp);
+    cl_full += cl_full_tmp;
+    cl_part += cl_part_tmp;
+  }
+}
+
+static int tileRowRequests(const int n, const int warpWidth) {
+  return (n + warpWidth - 1)/warpWidth;
+}
+
 //
 // Count number of global memory transactions for Tiled method
 //
 void countTiledGlTransactions(const bool isCopy,
   const int numPosMbarSample, const int volMm, const int volMk, const int volMbar,
-  const int cIn, const int cOut, const int accWidth, const int cacheWidth,
+  const int cIn, const int cOut, const int warpSize, const int accWidth, const int cacheWidth,
   std::vector<TensorConvInOut>& hostMbar, const int sizeMbar,
-  int& num_iter, float& mlp, int& gld_tran, int& gst_tran, int& gld_req, int& gst_req, int& cl_full, int& cl_part) {
+  int& num_iter, float& mlp, int& gld_tran, int& gst_tran, int& gld_req, int& gst_req, int& cl_full, int& cl_part,
+  int& numPosMbar, float& tranErr) {
 
   int ntile = ((volMm - 1)/TILEDIM + 1)*((volMk - 1)/TILEDIM + 1);
+  // Tile rows are TILEDIM threads wide, on warps narrower than that a row takes several requests
+  const int warpWidth = std::min(warpSize, TILEDIM);
   num_iter = volMbar*ntile;
 
   gld_tran = 0;
@@ -578,9 +802,9 @@ void countTiledGlTransactions(const bool isCopy,
   cl_full = 0;
   cl_part = 0;
 
-  // Random number generator
-  std::default_random_engine generator;
-  std::uniform_int_distribution<int> distribution(0, volMbar - 1);
+  MbarSampler sampler(volMbar, numPosMbarSample);
+  std::vector<TensorConvInOutFast> hostMbarFast(sizeMbar);
+  makeFastConv(hostMbar.data(), sizeMbar, hostMbarFast.data());
 
   // Number of elements inside the horizontally clipped tiles
   int h = volMm % TILEDIM;
@@ -609,14 +833,14 @@ void countTiledGlTransactions(const bool isCopy,
     mlp = (float)mlp_tot/(float)(2*ntile);
   }
 
-  int num_iposMbar = (numPosMbarSample == 0) ? volMbar : numPosMbarSample;
-
-  for (int iposMbar=0;iposMbar < num_iposMbar;iposMbar++) {
-    int posMbar = (numPosMbarSample == 0) ? iposMbar : distribution(generator);
+  int numLeft = sampler.nextBlock();
+  for (int iposMbar=0;numLeft > 0;iposMbar++) {
+    int posMbar = sampler.pos(iposMbar);
+    int tran_prev = gld_tran + gst_tran;
 
     int posMbarIn;
     int posMbarOut;
-    computePos(posMbar, posMbar, hostMbar.data(), sizeMbar, &posMbarIn, &posMbarOut);
+    computePos(posMbar, posMbar, hostMbarFast.data(), sizeMbar, &posMbarIn, &posMbarOut);
     // computePos(posMbar, posMbar, hostMbar.begin(), hostMbar.begin() + sizeMbar, posMbarInV, posMbarOutV);
 
     // Reads happen at {posMbarIn, posMbarIn + cuDimMk, posMbarIn + 2*cuDimMk, ..., posMbarIn + (TILEDIM - 1)*cuDimMk}
@@ -630,10 +854,10 @@ void countTiledGlTransactions(const bool isCopy,
       for (int i=0;i < TILEDIM;i++) {
         int posIn  = posMbarIn + i*cIn;
         int posOut = posMbarOut + i*cOut;
-        gld_tran_tmp += glTransactions(posIn, TILEDIM, accWidth);
-        gst_tran_tmp += glTransactions(posOut, TILEDIM, accWidth);
+        gld_tran_tmp += tileRowTransactions(posIn, TILEDIM, accWidth, warpWidth);
+        gst_tran_tmp += tileRowTransactions(posOut, TILEDIM, accWidth, warpWidth);
         int cl_full_tmp2, cl_part_tmp2;
-        countCacheLines(posOut, TILEDIM, cacheWidth, cl_full_tmp2, cl_part_tmp2);
+        tileRowCacheLines(posOut, TILEDIM, cacheWidth, warpWidth, cl_full_tmp2, cl_part_tmp2);
         cl_full_tmp += cl_full_tmp2;
         cl_part_tmp += cl_part_tmp2;
       }
@@ -652,23 +876,23 @@ void countTiledGlTransactions(const bool isCopy,
         for (int i=0;i < TILEDIM;i++) {
           int posIn  = posMbarIn + i*cIn;
           int posOut = posMbarOut + i*cOut;
-          gld_tran_tmp += glTransactions(posIn, h, accWidth);
-          gst_tran_tmp += glTransactions(posOut, h, accWidth);
+          gld_tran_tmp += tileRowTransactions(posIn, h, accWidth, warpWidth);
+          gst_tran_tmp += tileRowTransactions(posOut, h, accWidth, warpWidth);
           int cl_full_tmp2, cl_part_tmp2;
-          countCacheLines(posOut, h, cacheWidth, cl_full_tmp2, cl_part_tmp2);
+          tileRowCacheLines(posOut, h, cacheWidth, warpWidth, cl_full_tmp2, cl_part_tmp2);
           cl_full_tmp += cl_full_tmp2;
           cl_part_tmp += cl_part_tmp2;
         }
       } else {
         for (int i=0;i < TILEDIM;i++) {
           int posIn  = posMbarIn + i*cIn;
-          gld_tran_tmp += glTransactions(posIn, h, accWidth);
+          gld_tran_tmp += tileRowTransactions(posIn, h, accWidth, warpWidth);
         }
         for (int i=0;i < h;i++) {
           int posOut = posMbarOut + i*cOut;
-          gst_tran_tmp += glTransactions(posOut, TILEDIM, accWidth);
+          gst_tran_tmp += tileRowTransactions(posOut, TILEDIM, accWidth, warpWidth);
           int cl_full_tmp2, cl_part_tmp2;
-          countCacheLines(posOut, TILEDIM, cacheWidth, cl_full_tmp2, cl_part_tmp2);
+          tileRowCacheLines(posOut, TILEDIM, cacheWidth, warpWidth, cl_full_tmp2, cl_part_tmp2);
           cl_full_tmp += cl_full_tmp2;
           cl_part_tmp += cl_part_tmp2;
         }
@@ -688,23 +912,23 @@ void countTiledGlTransactions(const bool isCopy,
         for (int i=0;i < v;i++) {
           int posIn  = posMbarIn + i*cIn;
           int posOut = posMbarOut + i*cOut;
-          gld_tran_tmp += glTransactions(posIn, TILEDIM, accWidth);
-          gst_tran_tmp += glTransactions(posOut, TILEDIM, accWidth);
+          gld_tran_tmp += tileRowTransactions(posIn, TILEDIM, accWidth, warpWidth);
+          gst_tran_tmp += tileRowTransactions(posOut, TILEDIM, accWidth, warpWidth);
           int cl_full_tmp2, cl_part_tmp2;
-          countCacheLines(posOut, TILEDIM, cacheWidth, cl_full_tmp2, cl_part_tmp2);
+          tileRowCacheLines(posOut, TILEDIM, cacheWidth, warpWidth, cl_full_tmp2, cl_part_tmp2);
           cl_full_tmp += cl_full_tmp2;
           cl_part_tmp += cl_part_tmp2;
         }
       } else {
         for (int i=0;i < v;i++) {
           int posIn  = posMbarIn + i*cIn;
-          gld_tran_tmp += glTransactions(posIn, TILEDIM, accWidth);
+          gld_tran_tmp += tileRowTransactions(posIn, TILEDIM, accWidth, warpWidth);
         }
         for (int i=0;i < TILEDIM;i++) {
           int posOut = posMbarOut + i*cOut;
-          gst_tran_tmp += glTransactions(posOut, v, accWidth);
+          gst_tran_tmp += tileRowTransactions(posOut, v, accWidth, warpWidth);
           int cl_full_tmp2, cl_part_tmp2;
-          countCacheLines(posOut, v, cacheWidth, cl_full_tmp2, cl_part_tmp2);
+          tileRowCacheLines(posOut, v, cacheWidth, warpWidth, cl_full_tmp2, cl_part_tmp2);
           cl_full_tmp += cl_full_tmp2;
           cl_part_tmp += cl_part_tmp2;
         }
@@ -724,23 +948,23 @@ void countTiledGlTransactions(const bool isCopy,
         for (int i=0;i < v;i++) {
           int posIn  = posMbarIn + i*cIn;
           int posOut = posMbarOut + i*cOut;
-          gld_tran_tmp += glTransactions(posIn, h, accWidth);
-          gst_tran_tmp += glTransactions(posOut, h, accWidth);
+          gld_tran_tmp += tileRowTransactions(posIn, h, accWidth, warpWidth);
+          gst_tran_tmp += tileRowTransactions(posOut, h, accWidth, warpWidth);
           int cl_full_tmp2, cl_part_tmp2;
-          countCacheLines(posOut, h, cacheWidth, cl_full_tmp2, cl_part_tmp2);
+          tileRowCacheLines(posOut, h, cacheWidth, warpWidth, cl_full_tmp2, cl_part_tmp2);
           cl_full_tmp += cl_full_tmp2;
           cl_part_tmp += cl_part_tmp2;
         }
       } else {
         for (int i=0;i < v;i++) {
           int posIn  = posMbarIn + i*cIn;
-          gld_tran_tmp += glTransactions(posIn, h, accWidth);
+          gld_tran_tmp += tileRowTransactions(posIn, h, accWidth, warpWidth);
         }
         for (int i=0;i < h;i++) {
           int posOut = posMbarOut + i*cOut;
-          gst_tran_tmp += glTransactions(posOut, v, accWidth);
+          gst_tran_tmp += tileRowTransactions(posOut, v, accWidth, warpWidth);
           int cl_full_tmp2, cl_part_tmp2;
-          countCacheLines(posOut, v, cacheWidth, cl_full_tmp2, cl_part_tmp2);
+          tileRowCacheLines(posOut, v, cacheWidth, warpWidth, cl_full_tmp2, cl_part_tmp2);
           cl_full_tmp += cl_full_tmp2;
           cl_part_tmp += cl_part_tmp2;
         }
@@ -751,15 +975,192 @@ void countTiledGlTransactions(const bool isCopy,
       cl_part += cl_part_tmp*ntile_corn;
     }
 
+    sampler.add(gld_tran + gst_tran - tran_prev);
+    if (--numLeft == 0) numLeft = sampler.nextBlock();
   }
+  int num_iposMbar = sampler.num();
+  numPosMbar = num_iposMbar;
+  tranErr = sampler.err();
+
   // Requests
+  const int reqD = tileRowRequests(TILEDIM, warpWidth);
+  const int reqH = tileRowRequests(h, warpWidth);
+  const int reqV = tileRowRequests(v, warpWidth);
   if (isCopy) {
-    gld_req = num_iposMbar*( TILEDIM*ntile_full + TILEDIM*ntile_horz + v*ntile_vert + v*ntile_corn );
+    gld_req = num_iposMbar*( TILEDIM*reqD*ntile_full + TILEDIM*reqH*ntile_horz + v*reqD*ntile_vert + v*reqH*ntile_corn );
     gst_req = gld_req;
   } else {
-    gld_req = num_iposMbar*( TILEDIM*ntile_full + TILEDIM*ntile_horz + v*ntile_vert + v*ntile_corn );
-    gst_req = num_iposMbar*( TILEDIM*ntile_full + TILEDIM*ntile_vert + h*ntile_horz + h*ntile_corn );
+    gld_req = num_iposMbar*( TILEDIM*reqD*ntile_full + TILEDIM*reqH*ntile_horz + v*reqD*ntile_vert + v*reqH*ntile_corn );
+    gst_req = num_iposMbar*( TILEDIM*reqD*ntile_full + TILEDIM*reqV*ntile_vert + h*reqD*ntile_horz + h*reqV*ntile_corn );
+  }
+}
+
+//
+// Appends descriptor contents to memo key
+//
+static void appendKey(std::vector<int>& key, const TensorConvInOut* conv, const int numConv) {
+  key.push_back(numConv);
+  for (int i=0;i < numConv;i++) {
+    key.push_back(conv[i].c_in);
+    key.push_back(conv[i].d_in);
+    key.push_back(conv[i].ct_in);
+    key.push_back(conv[i].c_out);
+    key.push_back(conv[i].d_out);
+    key.push_back(conv[i].ct_out);
+  }
+}
+
+void ModelMemo::posMmk(const int vol, const TensorConvInOut* conv, const int numConv,
+  const int*& posIn, const int*& posOut) {
+
+  std::vector<int> key;
+  key.reserve(2 + 6*numConv);
+  key.push_back(vol);
+  appendKey(key, conv, numConv);
+
+  auto it = posMmkTable.find(key);
+  if (it == posMmkTable.end()) {
+    numMiss++;
+    PosMmk& p = posMmkTable[key];
+    p.posIn.resize(vol);
+    p.posOut.resize(vol);
+    computePos0(vol, conv, numConv, p.posIn.data(), p.posOut.data());
+    posIn = p.posIn.data();
+    posOut = p.posOut.data();
+  } else {
+    numHit++;
+    posIn = it->second.posIn.data();
+    posOut = it->second.posOut.data();
+  }
+}
+
+void ModelMemo::countPackedGlTransactions0(const int warpSize, const int accWidth, const int cacheWidth,
+  const int numthread,
+  const int numPos, const int posMbarIn[INT_VECTOR_LEN], const int posMbarOut[INT_VECTOR_LEN],
+  const int volMmk, const TensorConvInOut* conv, const int numConv,
+  int& gld_tran, int& gst_tran, int& gld_req, int& gst_req,
+  int& cl_full_l2, int& cl_part_l2, int* posTran) {
+
+  std::vector<int> key;
+  key.reserve(7 + 6*numConv + 2*numPos);
+  key.push_back(warpSize);
+  key.push_back(accWidth);
+  key.push_back(cacheWidth);
+  key.push_back(numthread);
+  key.push_back(volMmk);
+  appendKey(key, conv, numConv);
+  key.push_back(numPos);
+  key.insert(key.end(), posMbarIn, posMbarIn + numPos);
+  key.insert(key.end(), posMbarOut, posMbarOut + numPos);
+
+  auto it = glPackedTable.find(key);
+  if (it == glPackedTable.end()) {
+    numMiss++;
+    const int* posMmkIn;
+    const int* posMmkOut;
+    posMmk(volMmk, conv, numConv, posMmkIn, posMmkOut);
+    GlPacked r = {0, 0, 0, 0, 0, 0, {0}};
+    // L1 cache lines are not modeled
+    int cl_full_l1 = 0;
+    int cl_part_l1 = 0;
+    ::countPackedGlTransactions0(warpSize, accWidth, cacheWidth, numthread,
+      numPos, posMbarIn, posMbarOut, volMmk, posMmkIn, posMmkOut,
+      r.gld_tran, r.gst_tran, r.gld_req, r.gst_req,
+      r.cl_full_l2, r.cl_part_l2, cl_full_l1, cl_part_l1, r.posTran);
+    it = glPackedTable.insert(std::make_pair(key, r)).first;
+  } else {
+    numHit++;
+  }
+  const GlPacked& r = it->second;
+  gld_tran += r.gld_tran;
+  gst_tran += r.gst_tran;
+  gld_req += r.gld_req;
+  gst_req += r.gst_req;
+  cl_full_l2 += r.cl_full_l2;
+  cl_part_l2 += r.cl_part_l2;
+  if (posTran != NULL) {
+    for (int i=0;i < numPos;i++) posTran[i] = r.posTran[i];
+  }
+}
+
+void ModelMemo::countPackedShTransactions0(const int warpSize, const int bankWidth, const int numthread,
+  const int volMmk, const TensorConv* msh, const int numMsh,
+  int& sld_tran, int& sst_tran, int& sld_req, int& sst_req) {
+
+  std::vector<int> key;
+  key.reserve(5 + 3*numMsh);
+  key.push_back(warpSize);
+  key.push_back(bankWidth);
+  key.push_back(numthread);
+  key.push_back(volMmk);
+  key.push_back(numMsh);
+  for (int i=0;i < numMsh;i++) {
+    key.push_back(msh[i].c);
+    key.push_back(msh[i].d);
+    key.push_back(msh[i].ct);
+  }
+
+  auto it = shPackedTable.find(key);
+  if (it == shPackedTable.end()) {
+    numMiss++;
+    ShPacked r = {0, 0, 0, 0};
+    ::countPackedShTransactions0(warpSize, bankWidth, numthread, volMmk, msh, numMsh,
+      r.sld_tran, r.sst_tran, r.sld_req, r.sst_req);
+    it = shPackedTable.insert(std::make_pair(key, r)).first;
+  } else {
+    numHit++;
+  }
+  const ShPacked& r = it->second;
+  sld_tran += r.sld_tran;
+  sst_tran += r.sst_tran;
+  sld_req += r.sld_req;
+  sst_req += r.sst_req;
+}
+
+void ModelMemo::countTiledGlTransactions(const bool isCopy,
+  const int numPosMbarSample, const int volMm, const int volMk, const int volMbar,
+  const int cIn, const int cOut, const int warpSize, const int accWidth, const int cacheWidth,
+  std::vector<TensorConvInOut>& hostMbar, const int sizeMbar,
+  int& num_iter, float& mlp, int& gld_tran, int& gst_tran, int& gld_req, int& gst_req, int& cl_full, int& cl_part,
+  int& numPosMbar, float& tranErr) {
+
+  std::vector<int> key;
+  key.reserve(11 + 6*sizeMbar);
+  key.push_back(isCopy);
+  key.push_back(numPosMbarSample);
+  key.push_back(volMm);
+  key.push_back(volMk);
+  key.push_back(volMbar);
+  key.push_back(cIn);
+  key.push_back(cOut);
+  key.push_back(warpSize);
+  key.push_back(accWidth);
+  key.push_back(cacheWidth);
+  appendKey(key, hostMbar.data(), sizeMbar);
+
+  auto it = glTiledTable.find(key);
+  if (it == glTiledTable.end()) {
+    numMiss++;
+    GlTiled r;
+    ::countTiledGlTransactions(isCopy, numPosMbarSample, volMm, volMk, volMbar, cIn, cOut,
+      warpSize, accWidth, cacheWidth, hostMbar, sizeMbar,
+      r.num_iter, r.mlp, r.gld_tran, r.gst_tran, r.gld_req, r.gst_req, r.cl_full, r.cl_part,
+      r.numPosMbar, r.tranErr);
+    it = glTiledTable.insert(std::make_pair(key, r)).first;
+  } else {
+    numHit++;
   }
+  const GlTiled& r = it->second;
+  num_iter = r.num_iter;
+  mlp = r.mlp;
+  gld_tran = r.gld_tran;
+  gst_tran = r.gst_tran;
+  gld_req = r.gld_req;
+  gst_req = r.gst_req;
+  cl_full = r.cl_full;
+  cl_part = r.cl_part;
+  numPosMbar = r.numPosMbar;
+  tranErr = r.tranErr;
 }
 
 struct GpuModelProp {
@@ -768,6 +1169,12 @@ struct GpuModelProp {
   double sh_mem_latency;
   double iter_cycles;
   double fac;
+  // Kernel launch latency in microseconds
+  double launch_latency;
+  // Cycles to dispatch a thread block and set up its position descriptors
+  double block_cycles;
+  // Cycles per L1 transaction of reloading spilled registers
+  double spill_tran_cycles;
 
   GpuModelProp(int major) {
     if (major <= 3) {
@@ -777,6 +1184,9 @@ struct GpuModelProp {
       sh_mem_latency = 11.0;
       iter_cycles = 50.0;
       fac = 2.0;
+      launch_latency = 7.0;
+      block_cycles = 800.0;
+      spill_tran_cycles = 8.0;
     } else if (major <= 5) {
       // Maxwell
       base_dep_delay = 2.5;
@@ -784,6 +1194,9 @@ struct GpuModelProp {
       sh_mem_latency = 1.0;
       iter_cycles = 220.0;
       fac = 2.0;
+      launch_latency = 5.0;
+      block_cycles = 600.0;
+      spill_tran_cycles = 4.0;
     } else {
       // Pascal and above
       base_dep_delay = 2.8;
@@ -791,6 +1204,9 @@ struct GpuModelProp {
       sh_mem_latency = 1.0;
       iter_cycles = 260.0;
       fac = 2.0;
+      launch_latency = 4.0;
+      block_cycles = 500.0;
+      spill_tran_cycles = 4.0;
     } 
   }
 };
@@ -799,7 +1215,7 @@ void prepmodel5(const hipDeviceProp_t& prop, GpuModelProp& gpuModelProp,
   int nthread, int numActiveBlock, float mlp,
   int gld_req, int gst_req, int gld_tran, int gst_tran,
   int sld_req, int sst_req, int sld_tran, int sst_tran,
-  int cl_full, int cl_part,
+  int cl_full, int cl_part, double hitrate,
   double& delta_ll, double& mem_cycles, double& sh_mem_cycles, double& MWP) {
 
   double active_SM = prop.multiProcessorCount;
@@ -809,7 +1225,6 @@ void prepmodel5(const hipDeviceProp_t& prop, GpuModelProp& gpuModelProp,
   // GPU clock in GHz
   double freq = (double)prop.clockRate/1.0e6;
   int warpSize = prop.warpSize;
-  return;
 
   int active_warps_per_SM = nthread*numActiveBlock/warpSize;
 
@@ -822,8 +1237,6 @@ void prepmodel5(const hipDeviceProp_t& prop, GpuModelProp& gpuModelProp,
 
   double mem_l = gpuModelProp.base_mem_latency + (num_trans_per_request - 1.0) * gpuModelProp.base_dep_delay;
 
-  const double hitrate = 0.2;
-
   // Avg. number of memory cycles per warp per iteration
   mem_cycles = gpuModelProp.fac * mem_l * mlp;
   sh_mem_cycles = 2.0 * shnum_trans_per_request * gpuModelProp.sh_mem_latency * mlp;
@@ -844,7 +1257,8 @@ void prepmodel5(const hipDeviceProp_t& prop, GpuModelProp& gpuModelProp,
 double cyclesPacked(const bool isSplit, const size_t sizeofType, const hipDeviceProp_t& prop,
   int nthread, int numActiveBlock, float mlp, 
   int gld_req, int gst_req, int gld_tran, int gst_tran,
-  int sld_req, int sst_req, int sld_tran, int sst_tran, int num_iter, int cl_full, int cl_part) {
+  int sld_req, int sst_req, int sld_tran, int sst_tran, int num_iter, int cl_full, int cl_part,
+  double hitrate) {
 
   int warpSize = prop.warpSize;
   int warps_per_block = nthread/warpSize;
@@ -854,7 +1268,7 @@ double cyclesPacked(const bool isSplit, const size_t sizeofType, const hipDevice
   double delta_ll, mem_cycles, sh_mem_cycles, MWP;
   prepmodel5(prop, gpuModelProp, nthread, numActiveBlock, mlp,
     gld_req, gst_req, gld_tran, gst_tran,
-    sld_req, sst_req, sld_tran, sst_tran, cl_full, cl_part,
+    sld_req, sst_req, sld_tran, sst_tran, cl_full, cl_part, hitrate,
     delta_ll, mem_cycles, sh_mem_cycles, MWP);
   double ldst_cycles = mem_cycles*warps_per_block/MWP;
   double sync_cycles = 0.0;//2.0*delta_ll*(warps_per_block - 1.0);
@@ -866,7 +1280,8 @@ double cyclesPacked(const bool isSplit, const size_t sizeofType, const hipDevice
 double cyclesTiled(const bool isCopy, const size_t sizeofType, const hipDeviceProp_t& prop,
   int nthread, int numActiveBlock, float mlp, 
   int gld_req, int gst_req, int gld_tran, int gst_tran,
-  int sld_req, int sst_req, int sld_tran, int sst_tran, int num_iter, int cl_full, int cl_part) {
+  int sld_req, int sst_req, int sld_tran, int sst_tran, int num_iter, int cl_full, int cl_part,
+  double hitrate) {
 
   int warpSize = prop.warpSize;
   int warps_per_block = nthread/warpSize;
@@ -876,7 +1291,7 @@ double cyclesTiled(const bool isCopy, const size_t sizeofType, const hipDevicePr
   double delta_ll, mem_cycles, sh_mem_cycles, MWP;
   prepmodel5(prop, gpuModelProp, nthread, numActiveBlock, mlp,
     gld_req, gst_req, gld_tran, gst_tran,
-    sld_req, sst_req, sld_tran, sst_tran, cl_full, cl_part,
+    sld_req, sst_req, sld_tran, sst_tran, cl_full, cl_part, hitrate,
     delta_ll, mem_cycles, sh_mem_cycles, MWP);
   double ldst_cycles = mem_cycles*warps_per_block/MWP;
   double sync_cycles = 0.0;//2.0*delta_ll*(warps_per_block - 1.0);
@@ -889,6 +1304,188 @@ double cyclesTiled(const bool isCopy, const size_t sizeofType, const hipDevicePr
   return cycles;
 }
 
+//
+// Returns cycles of num_iter iterations of blocks of nthread threads that reload localSizeBytes
+// of spilled registers per thread from local memory. Reloads mostly hit in L1
+//
+double cyclesSpill(const hipDeviceProp_t& prop, const int nthread, const int localSizeBytes,
+  const int num_iter) {
+
+  if (localSizeBytes <= 0) return 0.0;
+
+  GpuModelProp gpuModelProp(prop.major);
+  double warps_per_block = (double)((nthread - 1)/prop.warpSize + 1);
+  // 128 byte transactions per warp
+  double tran_per_warp = (double)((localSizeBytes*prop.warpSize - 1)/128 + 1);
+  return warps_per_block*tran_per_warp*gpuModelProp.spill_tran_cycles*(double)num_iter;
+}
+
+//
+// Adds kernel launch latency, block dispatch and tail effects to the steady-state cycles of a
+// kernel. cycles are summed over all SMs for num_iter iterations that are distributed evenly
+// over numblock blocks, and blocks evenly over SMs. The kernel takes as long as the SM with the
+// most iterations, which dominates when there are few blocks per SM. Dispatch of blocks that
+// run concurrently (numActiveBlock per SM) overlaps.
+// Returns cycles summed over all SMs
+//
+double cyclesLaunch(const hipDeviceProp_t& prop, const int numblock, const int numActiveBlock,
+  const int num_iter, const double cycles) {
+
+  GpuModelProp gpuModelProp(prop.major);
+  double launch_cycles = gpuModelProp.launch_latency*(double)prop.clockRate/1000.0;
+
+  if (num_iter <= 0 || numblock <= 0) return launch_cycles*prop.multiProcessorCount;
+
+  int numSM = prop.multiProcessorCount;
+  long long iter_per_block = (num_iter - 1)/numblock + 1;
+  long long block_per_SM = (numblock - 1)/numSM + 1;
+  long long iter_per_SM = std::min((long long)num_iter, iter_per_block*block_per_SM);
+  double dispatch_cycles = gpuModelProp.block_cycles*(double)block_per_SM/(double)std::max(1, numActiveBlock);
+
+  return (launch_cycles + dispatch_cycles + cycles/(double)num_iter*(double)iter_per_SM)*(double)numSM;
+}
+
+//
+// Replays warp-wide accesses to positions posMbar + posMmk[0 ... vol-1] in L2.
+// Threads of a warp that access the same cache line in a row are coalesced
+//
+void accessL2Warps(CacheSim& cache, const size_t sizeofType, const int warpSize,
+  const int vol, const int posMbar, const int* posMmk) {
+  const int lineSize = cache.getLineSize();
+  for (int j0=0;j0 < vol;j0+=warpSize) {
+    int n = std::min(warpSize, vol - j0);
+    long long prevLine = -1;
+    for (int j1=0;j1 < n;j1++) {
+      long long addr = (long long)(posMbar + posMmk[j0 + j1])*(long long)sizeofType;
+      if (addr/lineSize != prevLine) {
+        cache.access(addr);
+        prevLine = addr/lineSize;
+      }
+    }
+  }
+}
+
+//
+// Simulates L2 cache for Packed and PackedSplit methods.
+// Replays global reads and writes of consecutive Mbar positions, starting from
+// L2SIM_NUM_WINDOW stratified positions, and returns the hit rate of the reads.
+// For Packed method, use numSplit = 1 and num1 = 0
+//
+double simulateL2Packed(const hipDeviceProp_t& prop, const size_t sizeofType,
+  const int volMbar, const int numSplit, const int splitDim, const int cuDimMm, const int cuDimMk,
+  std::vector<TensorConvInOut>& hostMbar, const int sizeMbar,
+  const int volMmk0, const int* posMmkIn0, const int* posMmkOut0,
+  const int volMmk1, const int* posMmkIn1, const int* posMmkOut1, const int num1) {
+
+  if (prop.l2CacheSize <= 0) return DEFAULT_L2_HITRATE;
+  int lineSize, assoc;
+  cuttL2CacheGeometry(lineSize, assoc);
+  CacheSim cache(prop.l2CacheSize, assoc, lineSize);
+
+  const int volPos = volMbar*numSplit;
+  MbarSampler sampler(volPos, 1);
+  std::vector<TensorConvInOutFast> hostMbarFast(sizeMbar);
+  makeFastConv(hostMbar.data(), sizeMbar, hostMbarFast.data());
+  const int numWindow = std::min(L2SIM_NUM_WINDOW, volPos);
+  const long long maxAccess = L2SIM_MAX_ACCESS/numWindow;
+  long long numRead = 0;
+  long long numReadHit = 0;
+  for (int iwin=0;iwin < numWindow;iwin++) {
+    cache.reset();
+    int pos0 = sampler.pos(iwin);
+    for (int ipos=0;ipos < volPos && cache.getNumAccess() < maxAccess;ipos++) {
+      int pos = (pos0 + ipos) % volPos;
+      int posMbar = pos / numSplit;
+      int isplit  = pos % numSplit;
+      int p0 = isplit*splitDim/numSplit;
+      int posMbarIn;
+      int posMbarOut;
+      computePos(posMbar, posMbar, hostMbarFast.data(), sizeMbar, &posMbarIn, &posMbarOut);
+      posMbarIn += p0*cuDimMm;
+      posMbarOut += p0*cuDimMk;
+      // Round up splits are spread over the split indices as in transposePackedSplit
+      bool roundUp = (num1 > 0 && (isplit + 1)*splitDim/numSplit - p0 > splitDim/numSplit);
+      int volMmk = roundUp ? volMmk1 : volMmk0;
+      // Reads
+      long long numAccess0 = cache.getNumAccess();
+      long long numHit0 = cache.getNumHit();
+      accessL2Warps(cache, sizeofType, prop.warpSize, volMmk, posMbarIn, roundUp ? posMmkIn1 : posMmkIn0);
+      numRead += cache.getNumAccess() - numAccess0;
+      numReadHit += cache.getNumHit() - numHit0;
+      // Writes
+      accessL2Warps(cache, sizeofType, prop.warpSize, volMmk, posMbarOut, roundUp ? posMmkOut1 : posMmkOut0);
+    }
+  }
+
+  return (numRead > 0) ? (double)numReadHit/(double)numRead : DEFAULT_L2_HITRATE;
+}
+
+//
+// Simulates L2 cache for Tiled and TiledCopy methods.
+// Replays global reads and writes of all tiles of consecutive Mbar positions, starting from
+// L2SIM_NUM_WINDOW stratified positions, and returns the hit rate of the reads
+//
+double simulateL2Tiled(const hipDeviceProp_t& prop, const size_t sizeofType, const bool isCopy,
+  const int volMm, const int volMk, const int volMbar, const int cIn, const int cOut,
+  std::vector<TensorConvInOut>& hostMbar, const int sizeMbar) {
+
+  if (prop.l2CacheSize <= 0) return DEFAULT_L2_HITRATE;
+  int lineSize, assoc;
+  cuttL2CacheGeometry(lineSize, assoc);
+  CacheSim cache(prop.l2CacheSize, assoc, lineSize);
+
+  const long long s = (long long)sizeofType;
+  const int ntilex = (volMm - 1)/TILEDIM + 1;
+  const int ntiley = (volMk - 1)/TILEDIM + 1;
+  MbarSampler sampler(volMbar, 1);
+  std::vector<TensorConvInOutFast> hostMbarFast(sizeMbar);
+  makeFastConv(hostMbar.data(), sizeMbar, hostMbarFast.data());
+  const int numWindow = std::min(L2SIM_NUM_WINDOW, volMbar);
+  const long long maxAccess = L2SIM_MAX_ACCESS/numWindow;
+  long long numRead = 0;
+  long long numReadHit = 0;
+  for (int iwin=0;iwin < numWindow;iwin++) {
+    cache.reset();
+    int pos0 = sampler.pos(iwin);
+    for (int ipos=0;ipos < volMbar && cache.getNumAccess() < maxAccess;ipos++) {
+      int posMbar = (pos0 + ipos) % volMbar;
+      int posMbarIn;
+      int posMbarOut;
+      computePos(posMbar, posMbar, hostMbarFast.data(), sizeMbar, &posMbarIn, &posMbarOut);
+      for (int ty=0;ty < ntiley && cache.getNumAccess() < maxAccess;ty++) {
+        for (int tx=0;tx < ntilex && cache.getNumAccess() < maxAccess;tx++) {
+          // Tile is w x h elements
+          int w = std::min(TILEDIM, volMm - tx*TILEDIM);
+          int h = std::min(TILEDIM, volMk - ty*TILEDIM);
+          // Reads: h rows of w elements
+          long long numAccess0 = cache.getNumAccess();
+          long long numHit0 = cache.getNumHit();
+          for (int i=0;i < h;i++) {
+            long long posIn = posMbarIn + (long long)(ty*TILEDIM + i)*cIn + tx*TILEDIM;
+            cache.accessRange(posIn*s, (posIn + w)*s);
+          }
+          numRead += cache.getNumAccess() - numAccess0;
+          numReadHit += cache.getNumHit() - numHit0;
+          // Writes: h rows of w elements (copy) or w rows of h elements (transpose)
+          if (isCopy) {
+            for (int i=0;i < h;i++) {
+              long long posOut = posMbarOut + (long long)(ty*TILEDIM + i)*cOut + tx*TILEDIM;
+              cache.accessRange(posOut*s, (posOut + w)*s);
+            }
+          } else {
+            for (int i=0;i < w;i++) {
+              long long posOut = posMbarOut + (long long)(tx*TILEDIM + i)*cOut + ty*TILEDIM;
+              cache.accessRange(posOut*s, (posOut + h)*s);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  return (numRead > 0) ? (double)numReadHit/(double)numRead : DEFAULT_L2_HITRATE;
+}
+
 bool check_results(const int tran, const int cl_full, const int cl_part, const int* results) {
   if (tran != results[0] || cl_full != results[1] || cl_part != results[2] ) return false;
   return true;
@@ -905,6 +1502,10 @@ void print_pos(const char* name, const int n, const int* pos) {
 bool testCounters(const int warpSize, const int accWidth, const int cacheWidth) {
 
   if (warpSize != 32) return false;
+#ifdef CUTT_PLANNER_ONLY
+  // The reference counters run on the GPU
+  return false;
+#else
 
   std::cout << "In testCounters" << std::endl;
 
@@ -1423,4 +2024,5 @@ const int shTestData[138][3] =
   delete [] gpuPosData;
 
   return true;
+#endif
 }
@@ -26,14 +26,139 @@ SOFTWARE.
 #define CUTTGPUMODEL_H
 
 #include <vector>
+#include <map>
 #include "cuttTypes.h"
 #include "cuttplan.h"
 #include "int_vector.h"
 
+// Mbar positions are sampled in blocks of this size. Convergence is checked between blocks
+const int MBAR_SAMPLE_BLOCK = 16;
+// Maximum number of sampled Mbar positions
+const int MBAR_SAMPLE_MAX = 256;
+
+// Host position generators and counters have versions specialised for ranks 1...MAX_SPECIALIZED_RANK
+const int MAX_SPECIALIZED_RANK = 6;
+
+// L2 hit rate of global memory reads when the cache is not simulated
+const double DEFAULT_L2_HITRATE = 0.2;
+// L2 simulation replays this many windows of consecutive Mbar positions
+const int L2SIM_NUM_WINDOW = 4;
+// Maximum number of simulated cache line accesses per plan
+const int L2SIM_MAX_ACCESS = 1 << 20;
+
+//
+// Deterministic, stratified sampler of Mbar positions with adaptive sample count.
+// Positions are visited in golden ratio strides through [0, vol) with the stride coprime
+// to vol: every prefix of the sequence is spread evenly over [0, vol) and the first vol
+// samples visit every position exactly once.
+// Sampling stops once the 95% confidence interval of the mean number of global memory
+// transactions per position is within 2% of the mean. All decisions are made from integer
+// sums so that the sample count is identical on all platforms and vector widths.
+//
+class MbarSampler {
+private:
+  int vol;
+  int stride;
+  int numMin;
+  int numMax;
+  int n;
+  long long sum;
+  long long sum2;
+public:
+  // numPosMbarSample = 0 : visit every position in order
+  // numPosMbarSample > 0 : minimum number of samples
+  MbarSampler(const int vol_in, const int numPosMbarSample);
+  // Returns position of k:th sample
+  int pos(const int k) const;
+  // Returns number of samples in the next block, or 0 when sampling is done
+  int nextBlock() const;
+  // Adds the number of transactions of the next sampled position
+  void add(const int tran);
+  // Number of samples added so far
+  int num() const {return n;}
+  // Relative half-width of the 95% confidence interval of the mean
+  float err() const;
+};
+
+//
+// Memo table of model sub-results for one planning session. Candidate plans often share
+// Mmk, Msh and Mbar descriptors (e.g. the same split found from the full and the reduced
+// rank, or Packed and PackedSplit plans with the same Mmk volume). Results are keyed by the
+// descriptor contents and the sampled Mbar positions, and computed on first request.
+// Not thread safe; use one table per planning session.
+//
+class ModelMemo {
+private:
+  struct PosMmk {
+    std::vector<int> posIn;
+    std::vector<int> posOut;
+  };
+  struct GlPacked {
+    int gld_tran, gst_tran, gld_req, gst_req, cl_full_l2, cl_part_l2;
+    int posTran[INT_VECTOR_LEN];
+  };
+  struct ShPacked {
+    int sld_tran, sst_tran, sld_req, sst_req;
+  };
+  struct GlTiled {
+    int num_iter, gld_tran, gst_tran, gld_req, gst_req, cl_full, cl_part, numPosMbar;
+    float mlp, tranErr;
+  };
+  std::map< std::vector<int>, PosMmk > posMmkTable;
+  std::map< std::vector<int>, GlPacked > glPackedTable;
+  std::map< std::vector<int>, ShPacked > shPackedTable;
+  std::map< std::vector<int>, GlTiled > glTiledTable;
+  int numHit;
+  int numMiss;
+public:
+  ModelMemo() : numHit(0), numMiss(0) {}
+  // Returns Mmk positions computed with computePos0(). Pointers stay valid for the lifetime of the table
+  void posMmk(const int vol, const TensorConvInOut* conv, const int numConv,
+    const int*& posIn, const int*& posOut);
+  // Same as countPackedGlTransactions0() with Mmk positions given by the descriptor conv
+  void countPackedGlTransactions0(const int warpSize, const int accWidth, const int cacheWidth,
+    const int numthread,
+    const int numPos, const int posMbarIn[INT_VECTOR_LEN], const int posMbarOut[INT_VECTOR_LEN],
+    const int volMmk, const TensorConvInOut* conv, const int numConv,
+    int& gld_tran, int& gst_tran, int& gld_req, int& gst_req,
+    int& cl_full_l2, int& cl_part_l2, int* posTran);
+  // Same as countPackedShTransactions0()
+  void countPackedShTransactions0(const int warpSize, const int bankWidth, const int numthread,
+    const int volMmk, const TensorConv* msh, const int numMsh,
+    int& sld_tran, int& sst_tran, int& sld_req, int& sst_req);
+  // Same as countTiledGlTransactions()
+  void countTiledGlTransactions(const bool isCopy,
+    const int numPosMbarSample, const int volMm, const int volMk, const int volMbar,
+    const int cIn, const int cOut, const int warpSize, const int accWidth, const int cacheWidth,
+    std::vector<TensorConvInOut>& hostMbar, const int sizeMbar,
+    int& num_iter, float& mlp, int& gld_tran, int& gst_tran, int& gld_req, int& gst_req, int& cl_full, int& cl_part,
+    int& numPosMbar, float& tranErr);
+  int getNumHit() const {return numHit;}
+  int getNumMiss() const {return numMiss;}
+};
+
+FastDiv makeFastDiv(const int d);
+
+void makeFastConv(const TensorConvInOut* conv, const int numConv, TensorConvInOutFast* fastConv);
+
+// Returns n / f.d
+inline int fastDiv(const int n, const FastDiv& f) {
+  return (int)(((unsigned long long)n*f.mul) >> f.shift);
+}
+
+// Returns n % f.d
+inline int fastMod(const int n, const FastDiv& f) {
+  return n - fastDiv(n, f)*f.d;
+}
+
 void computePos(const int vol0, const int vol1,
   const TensorConvInOut* conv, const int numConv,
   int* posIn, int* posOut);
 
+void computePos(const int vol0, const int vol1,
+  const TensorConvInOutFast* conv, const int numConv,
+  int* posIn, int* posOut);
+
 void computePos0(const int vol,
   const TensorConvInOut* conv, const int numConv,
   int* posIn, int* posOut);
@@ -53,7 +178,7 @@ void countPackedGlTransactions0(const int warpSize, const int accWidth, const in
   const int numPos, const int posMbarIn[INT_VECTOR_LEN], const int posMbarOut[INT_VECTOR_LEN],
   const int volMmk,  const int* __restrict__ posMmkIn, const int* __restrict__ posMmkOut,
   int& gld_tran, int& gst_tran, int& gld_req, int& gst_req,
-  int& cl_full_l2, int& cl_part_l2, int& cl_full_l1, int& cl_part_l1);
+  int& cl_full_l2, int& cl_part_l2, int& cl_full_l1, int& cl_part_l1, int* posTran=NULL);
 
 void countPackedShTransactions(const int warpSize, const int bankWidth, const int numthread,
   const int volMmk, const TensorConv* msh, const int numMsh,
@@ -69,19 +194,38 @@ void countPackedShTransactionsRef(const int warpSize, const int bankWidth, const
 
 void countTiledGlTransactions(const bool leadVolSame,
   const int numPosMbarSample, const int volMm, const int volMk, const int volMbar,
-  const int cIn, const int cOut, const int accWidth, const int cacheWidth,
+  const int cIn, const int cOut, const int warpSize, const int accWidth, const int cacheWidth,
   std::vector<TensorConvInOut>& hostMbar, const int sizeMbar,
-  int& num_iter, float& mlp, int& gld_tran, int& gst_tran, int& gld_req, int& gst_req, int& cl_full, int& cl_part);
+  int& num_iter, float& mlp, int& gld_tran, int& gst_tran, int& gld_req, int& gst_req, int& cl_full, int& cl_part,
+  int& numPosMbar, float& tranErr);
 
 double cyclesPacked(const bool isSplit, const size_t sizeofType, const hipDeviceProp_t& prop,
   int nthread, int numActiveBlock, float mlp, 
   int gld_req, int gst_req, int gld_tran, int gst_tran,
-  int sld_req, int sst_req, int sld_tran, int sst_tran, int num_iter, int cl_full, int cl_part);
+  int sld_req, int sst_req, int sld_tran, int sst_tran, int num_iter, int cl_full, int cl_part,
+  double hitrate);
 
 double cyclesTiled(const bool isCopy, const size_t sizeofType, const hipDeviceProp_t& prop,
   int nthread, int numActiveBlock, float mlp, 
   int gld_req, int gst_req, int gld_tran, int gst_tran,
-  int sld_req, int sst_req, int sld_tran, int sst_tran, int num_iter, int cl_full, int cl_part);
+  int sld_req, int sst_req, int sld_tran, int sst_tran, int num_iter, int cl_full, int cl_part,
+  double hitrate);
+
+double cyclesSpill(const hipDeviceProp_t& prop, const int nthread, const int localSizeBytes,
+  const int num_iter);
+
+double cyclesLaunch(const hipDeviceProp_t& prop, const int numblock, const int numActiveBlock,
+  const int num_iter, const double cycles);
+
+double simulateL2Packed(const hipDeviceProp_t& prop, const size_t sizeofType,
+  const int volMbar, const int numSplit, const int splitDim, const int cuDimMm, const int cuDimMk,
+  std::vector<TensorConvInOut>& hostMbar, const int sizeMbar,
+  const int volMmk0, const int* posMmkIn0, const int* posMmkOut0,
+  const int volMmk1, const int* posMmkIn1, const int* posMmkOut1, const int num1);
+
+double simulateL2Tiled(const hipDeviceProp_t& prop, const size_t sizeofType, const bool isCopy,
+  const int volMm, const int volMk, const int volMbar, const int cIn, const int cOut,
+  std::vector<TensorConvInOut>& hostMbar, const int sizeMbar);
 
 bool testCounters(const int warpSize, const int accWidth, const int cacheWidth);
 
@@ -0,0 +1,303 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#include <cstdio>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include "cuttGpuModel.h"
+#include "cuttGpuModelHost.h"
+
+//
+// Global memory access statistics, same as MemStat in cuttGpuModelKernel.cpp
+//
+struct HostMemStat {
+  int gld_tran;
+  int gst_tran;
+  int gld_req;
+  int gst_req;
+  int cl_full_l2;
+  int cl_part_l2;
+  int cl_full_l1;
+  int cl_part_l1;
+  void clear() {
+    gld_tran = 0;
+    gst_tran = 0;
+    gld_req = 0;
+    gst_req = 0;
+    cl_full_l2 = 0;
+    cl_part_l2 = 0;
+    cl_full_l1 = 0;
+    cl_part_l1 = 0;
+  }
+  void add(const HostMemStat& a) {
+    gld_tran += a.gld_tran;
+    gst_tran += a.gst_tran;
+    gld_req += a.gld_req;
+    gst_req += a.gst_req;
+    cl_full_l2 += a.cl_full_l2;
+    cl_part_l2 += a.cl_part_l2;
+    cl_full_l1 += a.cl_full_l1;
+    cl_part_l1 += a.cl_part_l1;
+  }
+};
+
+//
+// Counts number of global memory transactions for a warp that accesses
+// memory at pos using warp lanes 0, ..., n - 1
+//
+static int countWarpGlTransactions(const int* pos, const int n, const int accWidth) {
+  if (n == 0) return 0;
+  int count = 1;
+  for (int i=1;i < n;i++) {
+    count += (pos[i]/accWidth != pos[i - 1]/accWidth);
+  }
+  return count;
+}
+
+//
+// Counts number of full and partial cache lines for a warp that accesses
+// memory at pos using warp lanes 0, ..., n - 1
+//
+static void countWarpCacheLines(const int* pos, const int n, const int cacheWidth,
+  int& cl_full, int& cl_part) {
+
+  // Lanes [i, fullEnd) are part of a full cache line
+  int fullEnd = 0;
+  for (int i=0;i < n;i++) {
+    // Lane is at the beginning of a full cache line, if seg matches seg cacheWidth - 1 away
+    int i1 = i + (cacheWidth - 1);
+    if (i1 < n && pos[i]/cacheWidth == pos[i1]/cacheWidth) {
+      cl_full++;
+      fullEnd = i1 + 1;
+    }
+    if (i >= fullEnd) {
+      // Last lane of a partial cache line
+      int seg = pos[i]/cacheWidth;
+      int segP1 = (i + 1 < n) ? pos[i + 1]/cacheWidth : -1;
+      cl_part += (seg != segP1);
+    }
+  }
+}
+
+//
+// Counts number of full and partial cache lines for a thread block that accesses
+// memory at cachelines seg[0] ... seg[n - 1]
+//
+static void countBlockCacheLines(const int* seg, const int n, const int cacheWidth,
+  int& cl_full, int& cl_part) {
+
+  int fullEnd = 0;
+  for (int i=0;i < n;i++) {
+    int i1 = i + (cacheWidth - 1);
+    if (i1 < n && seg[i] == seg[i1]) {
+      cl_full++;
+      fullEnd = i1 + 1;
+    }
+    if (i >= fullEnd) {
+      int segP1 = (i + 1 < n) ? seg[i + 1] : -1;
+      cl_part += (seg[i] != segP1);
+    }
+  }
+}
+
+//
+// Counts one Mbar position of the Packed and PackedSplit kernels. Thread block of numthread
+// threads accesses elements posMmk = 0...volMmk-1 at posMbarIn + posMmkIn[posMmk] and
+// posMbarOut + posMmkOut[posMmk]
+//
+static void countPackedPos(const int warpSize, const int accWidth, const int cacheWidth,
+  const int numthread, const int numRegStorage, const int volMmk,
+  const int posMbarIn, const int posMbarOut, const int* posMmkIn, const int* posMmkOut,
+  std::vector<int>& buf, HostMemStat& memStat) {
+
+  int* pos = buf.data();
+  int* segOut = buf.data() + warpSize;
+
+  // Read from global memory
+  for (int j=0;j < numRegStorage;j++) {
+    for (int w=0;w < numthread;w += warpSize) {
+      int t0 = w + j*numthread;
+      int n = std::max(0, std::min(std::min(warpSize, numthread - w), volMmk - t0));
+      for (int i=0;i < n;i++) pos[i] = posMbarIn + posMmkIn[t0 + i];
+      memStat.gld_tran += countWarpGlTransactions(pos, n, accWidth);
+      memStat.gld_req += (n > 0);
+    }
+  }
+
+  // Write to global memory
+  for (int j=0;j < numRegStorage;j++) {
+    for (int w=0;w < numthread;w += warpSize) {
+      int t0 = w + j*numthread;
+      int n = std::max(0, std::min(std::min(warpSize, numthread - w), volMmk - t0));
+      for (int i=0;i < n;i++) {
+        pos[i] = posMbarOut + posMmkOut[t0 + i];
+        segOut[t0 + i] = pos[i]/cacheWidth;
+      }
+      memStat.gst_tran += countWarpGlTransactions(pos, n, accWidth);
+      memStat.gst_req += (n > 0);
+    }
+  }
+
+  countBlockCacheLines(segOut, volMmk, cacheWidth, memStat.cl_full_l2, memStat.cl_part_l2);
+  // Go from L2 segments to L1 segments
+  const int L2toL1 = accWidth/cacheWidth;
+  for (int i=0;i < volMmk;i++) segOut[i] /= L2toL1;
+  countBlockCacheLines(segOut, volMmk, accWidth, memStat.cl_full_l1, memStat.cl_part_l1);
+}
+
+//
+// Counts one Mbar position of the Tiled and TiledCopy kernels
+//
+static void countTiledPos(const bool isCopy, const int warpSize, const int accWidth, const int cacheWidth,
+  const int volX, const int volY, const int cuDimMk, const int cuDimMm,
+  const int posMbarIn, const int posMbarOut, std::vector<int>& buf, HostMemStat& memStat) {
+
+  int* pos = buf.data();
+  const int numMm = (volX - 1)/TILEDIM + 1;
+  const int numMk = (volY - 1)/TILEDIM + 1;
+  // Warps cover consecutive threadIdx.x within a row of the thread block
+  const int warpWidth = std::min(warpSize, TILEDIM);
+
+  for (int tile=0;tile < numMm*numMk;tile++) {
+    const int bx = (tile % numMm)*TILEDIM;
+    const int by = (tile / numMm)*TILEDIM;
+    for (int ty=0;ty < TILEROWS;ty++) {
+      for (int tx=0;tx < TILEDIM;tx += warpWidth) {
+
+        // Read global memory: lanes run along x
+        for (int j=0;j < TILEDIM;j += TILEROWS) {
+          int x = bx + tx;
+          int y = by + ty + j;
+          int n = (y < volY) ? std::max(0, std::min(warpWidth, volX - x)) : 0;
+          for (int i=0;i < n;i++) pos[i] = posMbarIn + x + i + y*cuDimMk;
+          memStat.gld_tran += countWarpGlTransactions(pos, n, accWidth);
+          memStat.gld_req += (n > 0);
+        }
+
+        // Write global memory: lanes run along x for copy, along y for transpose
+        for (int j=0;j < TILEDIM;j += TILEROWS) {
+          int n;
+          if (isCopy) {
+            int x = bx + tx;
+            int y = by + ty + j;
+            n = (y < volY) ? std::max(0, std::min(warpWidth, volX - x)) : 0;
+            for (int i=0;i < n;i++) pos[i] = posMbarOut + x + i + y*cuDimMm;
+          } else {
+            int x = bx + ty + j;
+            int y = by + tx;
+            n = (x < volX) ? std::max(0, std::min(warpWidth, volY - y)) : 0;
+            for (int i=0;i < n;i++) pos[i] = posMbarOut + y + i + x*cuDimMm;
+          }
+          memStat.gst_tran += countWarpGlTransactions(pos, n, accWidth);
+          memStat.gst_req += (n > 0);
+          countWarpCacheLines(pos, n, cacheWidth, memStat.cl_full_l2, memStat.cl_part_l2);
+        }
+
+      }
+    }
+  }
+}
+
+bool cuttGpuModelHost(const cuttPlan_t& plan, const int warpSize, const int accWidth, const int cacheWidth,
+  int& gld_tran, int& gst_tran, int& gld_req, int& gst_req,
+  int& cl_full_l2, int& cl_part_l2, int& cl_full_l1, int& cl_part_l1, const int numThread) {
+
+  const LaunchConfig& lc = plan.launchConfig;
+  const TensorSplit& ts = plan.tensorSplit;
+
+  if (ts.method == Trivial || ts.method == Unknown) return false;
+
+  // Packed and PackedSplit Mmk positions, one set for "round down" and one for "round up" splits
+  const int numthread = lc.numthread.x;
+  const int volThread = numthread*lc.numRegStorage;
+  std::vector<int> posMmkIn[2];
+  std::vector<int> posMmkOut[2];
+  int numWork = ts.volMbar;
+  if (ts.method == Packed || ts.method == PackedSplit) {
+    int numDesc = (ts.method == PackedSplit) ? 2 : 1;
+    for (int k=0;k < numDesc;k++) {
+      posMmkIn[k].resize(volThread);
+      posMmkOut[k].resize(volThread);
+      computePos(0, volThread - 1, plan.hostMmk.data() + k*ts.sizeMmk, ts.sizeMmk,
+        posMmkIn[k].data(), posMmkOut[k].data());
+    }
+    if (ts.method == PackedSplit) numWork = ts.volMbar*ts.numSplit;
+  }
+
+  int numWorker = (numThread > 0) ? numThread : (int)std::thread::hardware_concurrency();
+  numWorker = std::max(1, std::min(numWorker, numWork));
+  std::vector<HostMemStat> memStat(numWorker);
+
+  // Work item is a single Mbar position (and split index for PackedSplit)
+  auto worker = [&](const int iworker) {
+    HostMemStat& st = memStat[iworker];
+    st.clear();
+    std::vector<int> buf(warpSize + std::max(volThread, 1));
+    for (int iwork=iworker;iwork < numWork;iwork += numWorker) {
+      int posMbar = (ts.method == PackedSplit) ? iwork / ts.numSplit : iwork;
+      int posMbarIn = 0;
+      int posMbarOut = 0;
+      if (ts.sizeMbar > 0) {
+        computePos(posMbar, posMbar, plan.hostMbarFast.data(), ts.sizeMbar, &posMbarIn, &posMbarOut);
+      }
+      if (ts.method == Packed) {
+        countPackedPos(warpSize, accWidth, cacheWidth, numthread, lc.numRegStorage, ts.volMmk,
+          posMbarIn, posMbarOut, posMmkIn[0].data(), posMmkOut[0].data(), buf, st);
+      } else if (ts.method == PackedSplit) {
+        int isplit = iwork % ts.numSplit;
+        int p0 = isplit*ts.splitDim/ts.numSplit;
+        int volSplit = (isplit + 1)*ts.splitDim/ts.numSplit - p0;
+        int plusone = volSplit - ts.splitDim/ts.numSplit;
+        countPackedPos(warpSize, accWidth, cacheWidth, numthread, lc.numRegStorage, volSplit*ts.volMmkUnsplit,
+          posMbarIn + p0*plan.cuDimMm, posMbarOut + p0*plan.cuDimMk,
+          posMmkIn[plusone].data(), posMmkOut[plusone].data(), buf, st);
+      } else {
+        countTiledPos(ts.method == TiledCopy, warpSize, accWidth, cacheWidth,
+          plan.tiledVol.x, plan.tiledVol.y, plan.cuDimMk, plan.cuDimMm,
+          posMbarIn, posMbarOut, buf, st);
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int i=1;i < numWorker;i++) threads.push_back(std::thread(worker, i));
+  worker(0);
+  for (auto& t : threads) t.join();
+
+  HostMemStat total;
+  total.clear();
+  for (int i=0;i < numWorker;i++) total.add(memStat[i]);
+
+  gld_tran   = total.gld_tran;
+  gst_tran   = total.gst_tran;
+  gld_req    = total.gld_req;
+  gst_req    = total.gst_req;
+  cl_full_l2 = total.cl_full_l2;
+  cl_part_l2 = total.cl_part_l2;
+  cl_full_l1 = total.cl_full_l1;
+  cl_part_l1 = total.cl_part_l1;
+
+  return true;
+}
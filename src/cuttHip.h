@@ -0,0 +1,85 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#ifndef CUTTHIP_H
+#define CUTTHIP_H
+
+//
+// HIP types used by the planner and the cost model.
+// Planner-only builds (CUTT_PLANNER_ONLY) do not need HIP. When they are compiled with a plain
+// host compiler, the few types the planner uses are defined here with the same names and
+// fields as in the HIP headers. When compiled for HIP, the HIP headers are used.
+//
+#if defined(CUTT_PLANNER_ONLY) && !defined(__HIPCC__) && \
+  !defined(__HIP_PLATFORM_AMD__) && !defined(__HIP_PLATFORM_HCC__) && \
+  !defined(__HIP_PLATFORM_NVIDIA__) && !defined(__HIP_PLATFORM_NVCC__)
+#define CUTT_NO_HIP_HEADERS
+#endif
+
+#ifdef CUTT_NO_HIP_HEADERS
+
+#include <cstddef>
+
+typedef int hipError_t;
+#define hipSuccess 0
+
+typedef struct ihipStream_t* hipStream_t;
+typedef struct ihipEvent_t* hipEvent_t;
+
+struct dim3 {
+  unsigned int x, y, z;
+  dim3(unsigned int x_in=1, unsigned int y_in=1, unsigned int z_in=1) : x(x_in), y(y_in), z(z_in) {}
+};
+
+struct int2 {
+  int x, y;
+};
+
+struct hipDeviceProp_t {
+  char name[256];
+  size_t totalGlobalMem;
+  size_t sharedMemPerBlock;
+  int regsPerBlock;
+  int warpSize;
+  int maxThreadsPerBlock;
+  int maxThreadsDim[3];
+  int maxGridSize[3];
+  int clockRate;
+  int memoryClockRate;
+  int memoryBusWidth;
+  int major;
+  int minor;
+  int multiProcessorCount;
+  int l2CacheSize;
+  int maxThreadsPerMultiProcessor;
+  int ECCEnabled;
+  size_t maxSharedMemoryPerMultiProcessor;
+  char gcnArchName[256];
+};
+
+#else
+#include <hip/hip_runtime.h>
+#endif
+
+#endif // CUTTHIP_H
@@ -0,0 +1,123 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include "cuttOccupancy.h"
+
+//
+// Occupancy rules of the device architecture that are not part of hipDeviceProp_t
+//
+struct OccupancyProp {
+  // true for AMD GPUs
+  bool isAmd;
+  // AMD: SIMDs per CU, VGPRs per SIMD lane and VGPR allocation granularity per thread
+  int numSimd;
+  int vgprsPerSimd;
+  int vgprUnit;
+  // NVIDIA: register allocation granularity per warp and maximum number of blocks per SM
+  int regUnit;
+  int maxBlocks;
+  // Shared memory (LDS) allocation granularity in bytes
+  int shmemUnit;
+
+  OccupancyProp(const hipDeviceProp_t& prop) {
+    // Architecture number from gcnArchName, e.g. "gfx90a:sramecc+:xnack-" => 0x90a
+    int gfx = 0;
+    if (strncmp(prop.gcnArchName, "gfx", 3) == 0) gfx = (int)strtol(prop.gcnArchName + 3, NULL, 16);
+    isAmd = (gfx > 0);
+    numSimd = (prop.warpSize == 64) ? 4 : 2;
+    if (gfx >= 0x1000) {
+      // RDNA, wave32
+      vgprsPerSimd = 1024;
+      vgprUnit = 8;
+    } else if (gfx == 0x90a || gfx >= 0x940) {
+      // CDNA2 and above, unified VGPR and AGPR file
+      vgprsPerSimd = 512;
+      vgprUnit = 8;
+    } else {
+      vgprsPerSimd = 256;
+      vgprUnit = 4;
+    }
+    regUnit = 256;
+    if (prop.major <= 3) {
+      maxBlocks = 16;
+    } else if (prop.major == 7 && prop.minor == 5) {
+      maxBlocks = 16;
+    } else if (prop.major == 8 && prop.minor == 9) {
+      maxBlocks = 24;
+    } else if (prop.major == 8 && prop.minor > 0) {
+      maxBlocks = 16;
+    } else {
+      maxBlocks = 32;
+    }
+    shmemUnit = isAmd ? 512 : 256;
+  }
+};
+
+static int roundUp(const int x, const int unit) {
+  return ((x + unit - 1)/unit)*unit;
+}
+
+int occupancyNumActiveBlock(const hipDeviceProp_t& prop, const KernelResource& kr,
+  const int numthread, const size_t shmemsize) {
+
+  if (numthread <= 0 || numthread > std::min(prop.maxThreadsPerBlock, kr.maxThreadsPerBlock)) return 0;
+  size_t shmemBlock = shmemsize + kr.sharedSizeBytes;
+  if (shmemBlock > prop.sharedMemPerBlock) return 0;
+
+  OccupancyProp oprop(prop);
+  int numWarp = (numthread - 1)/prop.warpSize + 1;
+
+  // Limit from the number of resident threads
+  int maxWarpPerSM = prop.maxThreadsPerMultiProcessor/prop.warpSize;
+  int numActiveBlock = maxWarpPerSM/numWarp;
+
+  // Limit from registers
+  if (kr.numRegs > 0) {
+    if (oprop.isAmd) {
+      // Waves of a block are distributed over the SIMDs, each SIMD holds
+      // vgprsPerSimd/numRegs waves up to the maximum number of waves per SIMD
+      int maxWavePerSimd = std::max(1, maxWarpPerSM/oprop.numSimd);
+      int wavePerSimd = std::min(maxWavePerSimd, oprop.vgprsPerSimd/roundUp(kr.numRegs, oprop.vgprUnit));
+      numActiveBlock = std::min(numActiveBlock, (wavePerSimd*oprop.numSimd)/numWarp);
+    } else {
+      // regsPerBlock equals the register file size of an SM on all supported NVIDIA GPUs
+      int regPerWarp = roundUp(kr.numRegs*prop.warpSize, oprop.regUnit);
+      if (regPerWarp*numWarp > prop.regsPerBlock) return 0;
+      numActiveBlock = std::min(numActiveBlock, prop.regsPerBlock/(regPerWarp*numWarp));
+    }
+  }
+
+  // Limit from shared memory
+  if (shmemBlock > 0) {
+    int shmemPerSM = (int)prop.maxSharedMemoryPerMultiProcessor;
+    numActiveBlock = std::min(numActiveBlock, shmemPerSM/roundUp((int)shmemBlock, oprop.shmemUnit));
+  }
+
+  if (!oprop.isAmd) numActiveBlock = std::min(numActiveBlock, oprop.maxBlocks);
+
+  return std::max(0, numActiveBlock);
+}
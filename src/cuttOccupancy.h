@@ -0,0 +1,54 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#ifndef CUTTOCCUPANCY_H
+#define CUTTOCCUPANCY_H
+
+#include <cstddef>
+#include "cuttHip.h"
+
+//
+// Resource usage of one kernel instantiation, as reported by hipFuncGetAttributes()
+//
+struct KernelResource {
+  // Registers per thread (VGPRs on AMD GPUs)
+  int numRegs;
+  // Static shared memory (LDS) per block in bytes
+  int sharedSizeBytes;
+  // Maximum number of threads per block the kernel can be launched with
+  int maxThreadsPerBlock;
+  // Local (spill) memory per thread in bytes
+  int localSizeBytes;
+};
+
+//
+// Returns the maximum number of active blocks per SM (CU on AMD GPUs) for a kernel with
+// resource usage kr launched with numthread threads and shmemsize bytes of dynamic shared memory.
+// Computed from the device properties alone, the GPU is not queried.
+// Returns 0 when the kernel cannot be launched with this configuration.
+//
+int occupancyNumActiveBlock(const hipDeviceProp_t& prop, const KernelResource& kr,
+  const int numthread, const size_t shmemsize);
+
+#endif // CUTTOCCUPANCY_H
@@ -0,0 +1,117 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#include <cstdio>
+#include <list>
+#include <vector>
+#include "cuttplan.h"
+#include "cuttGpuModel.h"
+#include "cuttPlanner.h"
+
+//
+// Sets the device profile of the calling thread while in scope
+//
+class DeviceProfileGuard {
+public:
+  DeviceProfileGuard(const cuttDeviceProfile& profile) {cuttSetDeviceProfile(&profile);}
+  ~DeviceProfileGuard() {cuttSetDeviceProfile(NULL);}
+};
+
+bool cuttPlannerPlan(const cuttDeviceProfile& profile, const int rank, const int* dim,
+  const int* permutation, const size_t sizeofType, cuttPlannerResult& result) {
+
+  // Check input, same rules as cuttPlan()
+  if (sizeofType != 2 && sizeofType != 4 && sizeofType != 8) {
+    printf("cuttPlannerPlan: Unsupported sizeofType %d\n", (int)sizeofType);
+    return false;
+  }
+  if (rank <= 1) {
+    printf("cuttPlannerPlan: Invalid rank %d\n", rank);
+    return false;
+  }
+  std::vector<int> check(rank, 0);
+  for (int i=0;i < rank;i++) {
+    if (dim[i] <= 1 || permutation[i] < 0 || permutation[i] >= rank || check[permutation[i]]++) {
+      printf("cuttPlannerPlan: Invalid dim or permutation\n");
+      return false;
+    }
+  }
+
+  hipDeviceProp_t prop = profile.prop;
+  const int deviceID = 0;
+  DeviceProfileGuard profileGuard(profile);
+
+  std::vector<int> redDim;
+  std::vector<int> redPermutation;
+  reduceRanks(rank, dim, permutation, redDim, redPermutation);
+
+  std::list<cuttPlan_t> plans;
+  bool ok = cuttPlan_t::createPlans(rank, dim, permutation, redDim.size(), redDim.data(),
+    redPermutation.data(), sizeofType, deviceID, prop, plans);
+
+  ModelMemo memo;
+  for (auto it=plans.begin();ok && it != plans.end();it++) {
+    ok = it->countCycles(prop, 10, &memo);
+  }
+  if (ok) ok = cuttPlan_t::searchLaunchConfigs(plans, prop, 10, &memo);
+  if (!ok) return false;
+
+  std::list<cuttPlan_t>::iterator bestPlan = choosePlanHeuristic(plans);
+  if (bestPlan == plans.end()) return false;
+
+  const LaunchConfig& lc = bestPlan->launchConfig;
+  const TensorSplit& ts = bestPlan->tensorSplit;
+  result.method = ts.method;
+  result.rank = bestPlan->rank;
+  result.sizeMm = ts.sizeMm;
+  result.sizeMk = ts.sizeMk;
+  result.splitRank = (ts.method == PackedSplit) ? ts.splitRank : -1;
+  result.numSplit = (ts.method == PackedSplit) ? ts.numSplit : 1;
+  result.numthread[0] = lc.numthread.x;
+  result.numthread[1] = lc.numthread.y;
+  result.numthread[2] = lc.numthread.z;
+  result.numblock[0] = lc.numblock.x;
+  result.numblock[1] = lc.numblock.y;
+  result.numblock[2] = lc.numblock.z;
+  result.shmemsize = lc.shmemsize;
+  result.numRegStorage = lc.numRegStorage;
+  result.numActiveBlock = bestPlan->numActiveBlock;
+  result.cycles = bestPlan->cycles;
+  // Conversion factor from wallclock time to total number of cycles = (GPU clock in Hz) x #SM
+  double freq_SM = (double)prop.clockRate*1000.0*(double)prop.multiProcessorCount;
+  result.time = bestPlan->cycles/freq_SM;
+
+  return true;
+}
+
+const char* cuttPlannerMethodName(const int method) {
+  switch(method) {
+    case Trivial: return "Trivial";
+    case Packed: return "Packed";
+    case PackedSplit: return "PackedSplit";
+    case Tiled: return "Tiled";
+    case TiledCopy: return "TiledCopy";
+  }
+  return "Unknown";
+}
@@ -0,0 +1,79 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#ifndef CUTTPLANNER_H
+#define CUTTPLANNER_H
+
+#include <cstddef>
+#include "cuttDeviceProfile.h"
+
+//
+// Planner-only interface. Chooses a transpose plan and predicts its cost for the device
+// described by a device profile, without a GPU or the HIP runtime.
+// Plans are chosen with the same candidates, cost model and heuristic as cuttPlan().
+// Functions can be called from several threads at the same time.
+//
+
+// Chosen plan
+struct cuttPlannerResult {
+  // Transposing method, one of Trivial, Packed, PackedSplit, Tiled, TiledCopy in cuttplan.h
+  int method;
+  // Rank of the planned tensor (after rank reduction) and its split, see TensorSplit
+  int rank;
+  int sizeMm;
+  int sizeMk;
+  int splitRank;
+  int numSplit;
+  // Kernel launch configuration
+  int numthread[3];
+  int numblock[3];
+  size_t shmemsize;
+  int numRegStorage;
+  // Number of active thread blocks per SM
+  int numActiveBlock;
+  // Predicted cost summed over all SMs in cycles, and predicted time in seconds
+  double cycles;
+  double time;
+};
+
+//
+// Plans a transpose
+//
+// Parameters
+// profile           = Device profile to plan for
+// rank              = Rank of the tensor
+// dim[rank]         = Dimensions of the tensor
+// permutation[rank] = Transpose permutation
+// sizeofType        = Size of the elements of the tensor in bytes (=2, 4 or 8)
+// result            = Returned plan
+//
+// Returns false if the parameters are invalid or no plan was found
+//
+bool cuttPlannerPlan(const cuttDeviceProfile& profile, const int rank, const int* dim,
+  const int* permutation, const size_t sizeofType, cuttPlannerResult& result);
+
+// Returns the name of a transposing method
+const char* cuttPlannerMethodName(const int method);
+
+#endif // CUTTPLANNER_H
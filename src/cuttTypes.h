@@ -25,7 +25,25 @@ SOFTWARE.
 #ifndef CUTTTYPES_H
 #define CUTTTYPES_H
 
-#define MAX_REG_STORAGE 8
+// Deepest register storage of the Packed and PackedSplit kernels (calls.h goes up to 30).
+// Depths up to REG_STORAGE_DENSE are all instantiated, deeper ones in steps of two only:
+// neighbouring deep storages differ little in cost but each adds six kernel instantiations
+#ifndef MAX_REG_STORAGE
+#define MAX_REG_STORAGE 16
+#endif
+#define REG_STORAGE_DENSE 8
+#if MAX_REG_STORAGE < REG_STORAGE_DENSE || MAX_REG_STORAGE > 30
+#error "MAX_REG_STORAGE must be within 8...30"
+#endif
+// The deepest storage must itself be instantiated
+#if MAX_REG_STORAGE > REG_STORAGE_DENSE && MAX_REG_STORAGE % 2 != 0
+#error "MAX_REG_STORAGE above 8 must be even"
+#endif
+
+// Returns true if the Packed and PackedSplit kernels are instantiated with register storage depth n
+inline bool isRegStorageDepth(const int n) {
+  return (n >= 1 && n <= MAX_REG_STORAGE && (n <= REG_STORAGE_DENSE || n % 2 == 0));
+}
 
 struct TensorConv {
   int c;
@@ -42,4 +60,23 @@ struct TensorConvInOut {
   int ct_out;
 };
 
+//
+// Divisor with precomputed multiply-shift reciprocal. Valid for dividends 0...2^31-1
+//
+struct FastDiv {
+  int d;
+  int shift;
+  unsigned long long mul;
+};
+
+// TensorConvInOut with precomputed reciprocals of the divisors
+struct TensorConvInOutFast {
+  FastDiv c_in;
+  FastDiv d_in;
+  int ct_in;
+  FastDiv c_out;
+  FastDiv d_out;
+  int ct_out;
+};
+
 #endif // CUTTTYPES_H
@@ -37,6 +37,7 @@ SOFTWARE.
 #include "cuttTimer.h"
 #include "CudaMemcpy.h"
 #include "int_vector.h"
+#include "cuttDeviceProfile.h"
 
 #define MILLION 1000000
 #define BILLION 1000000000
@@ -89,6 +90,7 @@ int main(int argc, char *argv[]) {
   int elemsize = 8;
   std::vector<int> dimIn;
   std::vector<int> permutationIn;
+  const char* profileFilename = NULL;
   if (argc >= 2) {
     int i = 1;
     while (i < argc) {
@@ -110,6 +112,9 @@ int main(int argc, char *argv[]) {
       } else if (strcmp(argv[i], "-elemsize") == 0) {
         sscanf(argv[i+1], "%u", &elemsize);
         i += 2;
+      } else if (strcmp(argv[i], "-writeprofile") == 0 && i + 1 < argc) {
+        profileFilename = argv[i+1];
+        i += 2;
       } else if (strcmp(argv[i], "-dim") == 0) {
         i++;
         while (i < argc && isdigit(*argv[i])) {
@@ -148,6 +153,7 @@ int main(int argc, char *argv[]) {
     printf("-dim ...         : space-separated list of dimensions\n");
     printf("-permutation ... : space-separated list of permutations\n");
     printf("-bench benchID   : benchmark to run\n");
+    printf("-writeprofile [file] : write the device profile of the GPU for the planner to file and exit\n");
     return 1;
   }
 
@@ -155,6 +161,16 @@ int main(int argc, char *argv[]) {
     hipCheck(hipSetDevice(gpuid));
   }
 
+  if (profileFilename != NULL) {
+    int deviceID;
+    hipCheck(hipGetDevice(&deviceID));
+    cuttDeviceProfile profile;
+    if (!cuttCaptureDeviceProfile(deviceID, profile)) return 1;
+    if (!cuttWriteDeviceProfile(profileFilename, profile)) return 1;
+    printf("Wrote profile of %s to %s\n", profile.prop.name, profileFilename);
+    return 0;
+  }
+
   hipCheck(hipDeviceReset());
   if (elemsize == 2 || elemsize == 4) {
     hipCheck(hipDeviceSetSharedMemConfig(hipSharedMemBankSizeFourByte));
@@ -0,0 +1,232 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+//
+// Host test of LRUCache. Random operations are checked against a std::unordered_map that holds
+// every value ever set: the cache may miss a key it evicted, but must never return a value
+// other than the last one set. Eviction order, capacity and cost limits are checked on small
+// caches, and concurrent use from several threads.
+//
+#include <vector>
+#include <unordered_map>
+#include <random>
+#include <thread>
+#include <cstdio>
+#include "LRUCache.h"
+
+// Value the caches return for keys they do not hold
+const int NULL_VALUE = -1;
+
+bool testReference(const size_t capacity, const int numShard, const int numKey, const int numOp);
+bool testClock();
+bool testCost(const int numShard);
+bool testThreads(const int numThread, const int numOp);
+
+int main() {
+
+  int numFail = 0;
+  // Capacity of each shard above the number of keys, no evictions
+  if (!testReference(16000, LRUCACHE_NUM_SHARD, 1000, 200000)) numFail++;
+  if (!testReference(4096, LRUCACHE_NUM_SHARD, 1000, 200000)) numFail++;
+  // Capacity below the number of keys, with one shard and with many
+  if (!testReference(100, 1, 1000, 200000)) numFail++;
+  if (!testReference(100, LRUCACHE_NUM_SHARD, 1000, 200000)) numFail++;
+  if (!testReference(1, LRUCACHE_NUM_SHARD, 10, 10000)) numFail++;
+  if (!testReference(30, 7, 100, 100000)) numFail++;
+  if (!testClock()) numFail++;
+  if (!testCost(1)) numFail++;
+  if (!testCost(LRUCACHE_NUM_SHARD)) numFail++;
+  if (!testThreads(4, 100000)) numFail++;
+
+  if (numFail > 0) {
+    printf("cutt_cache_test: %d tests FAILED\n", numFail);
+    return 1;
+  }
+  printf("cutt_cache_test: all tests OK\n");
+  return 0;
+}
+
+//
+// Random set/get mix against a reference map. Keys are spread over the full 64-bit range so that
+// shards and buckets see clustered and scattered hashes
+//
+bool testReference(const size_t capacity, const int numShard, const int numKey, const int numOp) {
+  LRUCache<unsigned long long int, int> cache(capacity, NULL_VALUE, 0, numShard);
+  std::unordered_map<unsigned long long int, int> reference;
+  std::mt19937_64 gen(capacity*1000 + numShard);
+  std::vector<unsigned long long int> keys(numKey);
+  for (int i=0;i < numKey;i++) keys[i] = (i % 2 == 0) ? (unsigned long long int)i : gen();
+
+  int numHit = 0;
+  int numGet = 0;
+  for (int i=0;i < numOp;i++) {
+    unsigned long long int key = keys[gen() % numKey];
+    if (gen() % 3 == 0) {
+      int value = (int)(gen() % 1000000);
+      cache.set(key, value);
+      reference[key] = value;
+      // A value just set is always found
+      if (cache.get(key) != value) {
+        printf("testReference(%d, %d): key %llu not found after set\n", (int)capacity, numShard, key);
+        return false;
+      }
+    } else {
+      numGet++;
+      int value = cache.get(key);
+      auto it = reference.find(key);
+      if (value == NULL_VALUE) {
+        if (capacity/numShard >= (size_t)numKey && it != reference.end()) {
+          printf("testReference(%d, %d): key %llu evicted below capacity\n", (int)capacity, numShard, key);
+          return false;
+        }
+      } else {
+        numHit++;
+        if (it == reference.end() || it->second != value) {
+          printf("testReference(%d, %d): key %llu returned %d, expected %d\n", (int)capacity, numShard,
+            key, value, (it == reference.end()) ? NULL_VALUE : it->second);
+          return false;
+        }
+      }
+    }
+  }
+
+  // The cache holds at most capacity keys
+  int numHeld = 0;
+  for (auto it=reference.begin();it != reference.end();it++) {
+    if (cache.get(it->first) != NULL_VALUE) numHeld++;
+  }
+  if ((size_t)numHeld > capacity) {
+    printf("testReference(%d, %d): %d keys held\n", (int)capacity, numShard, numHeld);
+    return false;
+  }
+  printf("testReference(%d, %d): %d gets, %d hits, %d keys held\n", (int)capacity, numShard,
+    numGet, numHit, numHeld);
+  return true;
+}
+
+//
+// CLOCK order on one shard: keys read since the hand last passed get a second chance
+//
+bool testClock() {
+  const int capacity = 8;
+  LRUCache<int, int> cache(capacity, NULL_VALUE, 0, 1);
+  for (int i=0;i < capacity;i++) cache.set(i, i*10);
+  // Key 0 is referenced, key 1 is the first unreferenced entry the hand reaches
+  cache.get(0);
+  cache.set(capacity, capacity*10);
+  if (cache.get(0) != 0 || cache.get(1) != NULL_VALUE || cache.get(capacity) != capacity*10) {
+    printf("testClock: referenced key evicted or wrong victim\n");
+    return false;
+  }
+  // Setting an existing key updates it in place without evicting
+  cache.set(2, 200);
+  for (int i=0;i <= capacity;i++) {
+    int expected = (i == 1) ? NULL_VALUE : ((i == 2) ? 200 : i*10);
+    if (cache.get(i) != expected) {
+      printf("testClock: key %d returned %d, expected %d\n", i, cache.get(i), expected);
+      return false;
+    }
+  }
+  printf("testClock: OK\n");
+  return true;
+}
+
+//
+// Cost-based eviction: the total cost of the held keys stays within maxCost and keys costing
+// more than maxCost are not stored
+//
+bool testCost(const int numShard) {
+  const size_t maxCost = 100;
+  LRUCache<int, int> cache(1000, NULL_VALUE, maxCost, numShard);
+  std::mt19937 gen(1);
+  std::unordered_map<int, size_t> costs;
+  for (int i=0;i < 10000;i++) {
+    int key = (int)(gen() % 200);
+    size_t cost = 1 + gen() % 30;
+    cache.set(key, key, cost);
+    costs[key] = cost;
+    size_t totalCost = 0;
+    for (auto it=costs.begin();it != costs.end();it++) {
+      int value = cache.get(it->first);
+      if (value != NULL_VALUE && value != it->first) {
+        printf("testCost(%d): key %d returned %d\n", numShard, it->first, value);
+        return false;
+      }
+      if (value != NULL_VALUE) totalCost += it->second;
+    }
+    if (totalCost > maxCost) {
+      printf("testCost(%d): total cost %d exceeds %d\n", numShard, (int)totalCost, (int)maxCost);
+      return false;
+    }
+  }
+  cache.set(-1, -1, maxCost + 1);
+  if (cache.get(-1) != NULL_VALUE) {
+    printf("testCost(%d): key above maxCost was stored\n", numShard);
+    return false;
+  }
+  // Growing the cost of a held key above maxCost removes it
+  cache.set(-2, -2, 1);
+  cache.set(-2, -2, maxCost + 1);
+  if (cache.get(-2) != NULL_VALUE) {
+    printf("testCost(%d): key grown above maxCost was kept\n", numShard);
+    return false;
+  }
+  printf("testCost(%d): OK\n", numShard);
+  return true;
+}
+
+//
+// Threads share one cache. Values are a function of the key, so any hit can be checked
+//
+bool testThreads(const int numThread, const int numOp) {
+  LRUCache<unsigned long long int, unsigned long long int> cache(256, 0);
+  std::vector<int> numBad(numThread, 0);
+  std::vector<std::thread> threads;
+  for (int t=0;t < numThread;t++) {
+    threads.push_back(std::thread([&cache, &numBad, t, numOp]() {
+      std::mt19937_64 gen(t);
+      for (int i=0;i < numOp;i++) {
+        unsigned long long int key = 1 + gen() % 1024;
+        if (gen() % 4 == 0) {
+          cache.set(key, key*key);
+        } else {
+          unsigned long long int value = cache.get(key);
+          if (value != 0 && value != key*key) numBad[t]++;
+        }
+      }
+    }));
+  }
+  int numBadTot = 0;
+  for (int t=0;t < numThread;t++) {
+    threads[t].join();
+    numBadTot += numBad[t];
+  }
+  if (numBadTot > 0) {
+    printf("testThreads: %d wrong values\n", numBadTot);
+    return false;
+  }
+  printf("testThreads: OK\n");
+  return true;
+}
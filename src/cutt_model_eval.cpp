@@ -0,0 +1,417 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+//
+// Cost model accuracy evaluation.
+//
+// Reads candidate timings recorded by cuttPlanMeasure (library built with ENABLE_MODEL_EVAL,
+// lines starting with "MODELEVAL", all other lines are ignored), replays planning for every
+// recorded case with the planner-only library and the device profile of the measured GPU,
+// and compares the predicted cycles against the measured times.
+// With -exact, the sampled global memory transaction counts of every candidate are also
+// compared against exact counts over the full Mbar range (cuttGpuModelHost).
+//
+#include <vector>
+#include <list>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <cstring>         // strcmp
+#include <cmath>
+#include "cuttplan.h"
+#include "cuttGpuModel.h"
+#include "cuttGpuModelHost.h"
+#include "cuttDeviceProfile.h"
+
+// Measured candidate
+struct EvalPlan {
+  int rank;
+  int method;
+  int sizeMm;
+  int sizeMk;
+  int splitRank;
+  int numSplit;
+  int numRegStorage;
+  double time;
+  bool used;
+};
+
+// Measured tensor transpose
+struct EvalCase {
+  int rank;
+  int sizeofType;
+  std::vector<int> dim;
+  std::vector<int> permutation;
+  std::vector<EvalPlan> plans;
+};
+
+bool readCases(std::istream& in, std::vector<EvalCase>& cases);
+bool evalCase(EvalCase& evalCase, hipDeviceProp_t& prop, const bool verbose, const bool exact);
+void compareExact(const cuttPlan_t& plan, const hipDeviceProp_t& prop);
+double rankCorrelation(const std::vector<double>& x, const std::vector<double>& y);
+
+// Statistics accumulated over all cases
+int numCase = 0;
+int numCaseSkipped = 0;
+int numMatched = 0;
+int numUnmatched = 0;
+int numTop1 = 0;
+int numTop3 = 0;
+int numCorr = 0;
+double sumCorr = 0.0;
+double sumSlowdown = 0.0;
+double sumLogSlowdown = 0.0;
+double maxSlowdown = 1.0;
+double totTimeChosen = 0.0;
+double totTimeBest = 0.0;
+int numExact = 0;
+double sumTranErr = 0.0;
+double maxTranErr = 0.0;
+
+int main(int argc, char *argv[]) {
+
+  const char* profileName = NULL;
+  bool verbose = false;
+  bool exact = false;
+  const char* filename = NULL;
+  bool arg_ok = true;
+  int i = 1;
+  while (i < argc) {
+    if (strcmp(argv[i], "-profile") == 0 && i + 1 < argc) {
+      profileName = argv[i+1];
+      i += 2;
+    } else if (strcmp(argv[i], "-file") == 0 && i + 1 < argc) {
+      filename = argv[i+1];
+      i += 2;
+    } else if (strcmp(argv[i], "-verbose") == 0) {
+      verbose = true;
+      i++;
+    } else if (strcmp(argv[i], "-exact") == 0) {
+      exact = true;
+      i++;
+    } else {
+      arg_ok = false;
+      break;
+    }
+  }
+
+  if (!arg_ok || profileName == NULL) {
+    printf("cutt_model_eval [options]\n");
+    printf("Options:\n");
+    printf("-profile [name] : built-in device profile or profile file of the measured GPU\n");
+    printf("-file [name]    : file with MODELEVAL records (default is standard input)\n");
+    printf("-verbose        : print results for every case\n");
+    printf("-exact          : compare sampled transaction counts against exact host counts\n");
+    printf("Built-in profiles:");
+    std::vector<std::string> names = cuttDeviceProfileNames();
+    for (int j=0;j < (int)names.size();j++) printf(" %s", names[j].c_str());
+    printf("\n");
+    return 1;
+  }
+
+  cuttDeviceProfile profile;
+  if (!cuttGetDeviceProfile(profileName, profile)) {
+    if (!cuttReadDeviceProfile(profileName, profile)) return 1;
+  }
+  // Kernel resources and L2 cache geometry come from the profile
+  cuttSetDeviceProfile(&profile);
+  hipDeviceProp_t prop = profile.prop;
+
+  printf("Planning for %s SM version %d.%d\n", prop.name, prop.major, prop.minor);
+
+  std::vector<EvalCase> cases;
+  if (filename != NULL) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+      printf("Unable to open file %s\n", filename);
+      return 1;
+    }
+    if (!readCases(file, cases)) return 1;
+  } else {
+    if (!readCases(std::cin, cases)) return 1;
+  }
+
+  for (auto it=cases.begin();it != cases.end();it++) {
+    if (!evalCase(*it, prop, verbose, exact)) return 1;
+  }
+
+  if (numCase == 0) {
+    printf("No cases evaluated (%d skipped)\n", numCaseSkipped);
+    return 1;
+  }
+
+  printf("cases %d skipped %d\n", numCase, numCaseSkipped);
+  printf("candidates matched %d unmatched %d\n", numMatched, numUnmatched);
+  if (numCorr > 0) {
+    printf("rank correlation (Spearman, mean over %d cases) %1.3lf\n", numCorr, sumCorr/(double)numCorr);
+  }
+  printf("top-1 hit rate %1.1lf %%\n", 100.0*(double)numTop1/(double)numCase);
+  printf("top-3 hit rate %1.1lf %%\n", 100.0*(double)numTop3/(double)numCase);
+  printf("misprediction slowdown mean %1.3lf geomean %1.3lf max %1.3lf total %1.3lf\n",
+    sumSlowdown/(double)numCase, exp(sumLogSlowdown/(double)numCase), maxSlowdown,
+    totTimeChosen/totTimeBest);
+  if (numExact > 0) {
+    printf("sampled transaction count error (%d candidates) mean %1.2lf %% max %1.2lf %%\n",
+      numExact, 100.0*sumTranErr/(double)numExact, 100.0*maxTranErr);
+  }
+
+  return 0;
+}
+
+//
+// Reads MODELEVAL records from stream. Returns false on parse error
+//
+bool readCases(std::istream& in, std::vector<EvalCase>& cases) {
+  std::string line;
+  int lineno = 0;
+  while (std::getline(in, line)) {
+    lineno++;
+    std::istringstream ss(line);
+    std::string tag, type;
+    if (!(ss >> tag) || tag != "MODELEVAL") continue;
+    ss >> type;
+    if (type == "case") {
+      EvalCase c;
+      ss >> c.rank >> c.sizeofType;
+      if (!ss || c.rank < 1) {
+        printf("Invalid case on line %d\n", lineno);
+        return false;
+      }
+      c.dim.resize(c.rank);
+      c.permutation.resize(c.rank);
+      for (int i=0;i < c.rank;i++) ss >> c.dim[i];
+      for (int i=0;i < c.rank;i++) ss >> c.permutation[i];
+      if (!ss) {
+        printf("Invalid case on line %d\n", lineno);
+        return false;
+      }
+      cases.push_back(c);
+    } else if (type == "plan") {
+      EvalPlan p;
+      ss >> p.rank >> p.method >> p.sizeMm >> p.sizeMk >> p.splitRank >> p.numSplit >> p.numRegStorage >> p.time;
+      if (!ss || cases.size() == 0) {
+        printf("Invalid plan on line %d\n", lineno);
+        return false;
+      }
+      p.used = false;
+      cases.back().plans.push_back(p);
+    } else {
+      printf("Unknown record type \"%s\" on line %d\n", type.c_str(), lineno);
+      return false;
+    }
+  }
+  return true;
+}
+
+//
+// Returns true if plan matches the measured candidate.
+// Launch configuration is not part of the key so that planner changes to it can be evaluated
+//
+bool matchPlan(const cuttPlan_t& plan, const EvalPlan& p) {
+  const TensorSplit& ts = plan.tensorSplit;
+  return (plan.rank == p.rank && ts.method == p.method && ts.sizeMm == p.sizeMm &&
+    ts.sizeMk == p.sizeMk && ts.splitRank == p.splitRank && ts.numSplit == p.numSplit);
+}
+
+//
+// Replays planning for a single case and accumulates statistics
+// Returns false on planner error
+//
+bool evalCase(EvalCase& evalCase, hipDeviceProp_t& prop, const bool verbose, const bool exact) {
+
+  if (evalCase.plans.size() == 0) {
+    numCaseSkipped++;
+    return true;
+  }
+
+  std::vector<int> redDim;
+  std::vector<int> redPermutation;
+  reduceRanks(evalCase.rank, evalCase.dim.data(), evalCase.permutation.data(), redDim, redPermutation);
+
+  std::list<cuttPlan_t> plans;
+  if (!cuttPlan_t::createPlans(evalCase.rank, evalCase.dim.data(), evalCase.permutation.data(),
+    redDim.size(), redDim.data(), redPermutation.data(), evalCase.sizeofType, 0, prop, plans)) {
+    printf("createPlans failed\n");
+    return false;
+  }
+
+  ModelMemo memo;
+  for (auto it=plans.begin();it != plans.end();it++) {
+    if (!it->countCycles(prop, 10, &memo)) {
+      printf("countCycles failed\n");
+      return false;
+    }
+  }
+  if (!cuttPlan_t::searchLaunchConfigs(plans, prop, 10, &memo)) {
+    printf("searchLaunchConfigs failed\n");
+    return false;
+  }
+
+  if (exact) {
+    for (auto it=plans.begin();it != plans.end();it++) compareExact(*it, prop);
+  }
+
+  auto chosenPlan = choosePlanHeuristic(plans);
+  if (chosenPlan == plans.end()) {
+    numCaseSkipped++;
+    return true;
+  }
+
+  // Match replayed plans to measured candidates
+  std::vector<double> cycles;
+  std::vector<double> times;
+  double chosenTime = -1.0;
+  for (auto it=plans.begin();it != plans.end();it++) {
+    auto p = evalCase.plans.begin();
+    for (;p != evalCase.plans.end();p++) {
+      if (!p->used && matchPlan(*it, *p)) break;
+    }
+    if (p == evalCase.plans.end()) {
+      numUnmatched++;
+      continue;
+    }
+    p->used = true;
+    numMatched++;
+    cycles.push_back(it->cycles);
+    times.push_back(p->time);
+    if (it == chosenPlan) chosenTime = p->time;
+  }
+
+  // Chosen plan was never measured, nothing to compare against
+  if (chosenTime < 0.0) {
+    numCaseSkipped++;
+    return true;
+  }
+
+  // Measured times in increasing order
+  std::vector<double> sortedTimes;
+  for (auto p=evalCase.plans.begin();p != evalCase.plans.end();p++) sortedTimes.push_back(p->time);
+  std::sort(sortedTimes.begin(), sortedTimes.end());
+  double bestTime = sortedTimes[0];
+  int chosenRank = (int)(std::lower_bound(sortedTimes.begin(), sortedTimes.end(), chosenTime) - sortedTimes.begin());
+
+  numCase++;
+  if (chosenRank < 1) numTop1++;
+  if (chosenRank < 3) numTop3++;
+  double slowdown = (bestTime > 0.0) ? chosenTime/bestTime : 1.0;
+  sumSlowdown += slowdown;
+  sumLogSlowdown += log(slowdown);
+  maxSlowdown = std::max(maxSlowdown, slowdown);
+  totTimeChosen += chosenTime;
+  totTimeBest += bestTime;
+
+  double corr = 0.0;
+  bool corrOK = (cycles.size() >= 3);
+  if (corrOK) {
+    corr = rankCorrelation(cycles, times);
+    sumCorr += corr;
+    numCorr++;
+  }
+
+  if (verbose) {
+    printf("dim");
+    for (int i=0;i < evalCase.rank;i++) printf(" %d", evalCase.dim[i]);
+    printf(" permutation");
+    for (int i=0;i < evalCase.rank;i++) printf(" %d", evalCase.permutation[i]);
+    printf(" | candidates %d chosen rank %d slowdown %1.3lf", (int)cycles.size(), chosenRank + 1, slowdown);
+    if (corrOK) printf(" correlation %1.3lf", corr);
+    printf(" memo hit %d miss %d", memo.getNumHit(), memo.getNumMiss());
+    printf("\n");
+  }
+
+  return true;
+}
+
+//
+// Compares sampled global memory transaction count of plan, scaled to the full Mbar range,
+// against the exact count
+//
+void compareExact(const cuttPlan_t& plan, const hipDeviceProp_t& prop) {
+  const TensorSplit& ts = plan.tensorSplit;
+  if (ts.method == Trivial || plan.numPosMbar == 0) return;
+  // Same widths as in cuttPlan_t::countCycles()
+  const int accWidth = 128/plan.sizeofType;
+  const int cacheWidth = 64/plan.sizeofType;
+  int gld_tran, gst_tran, gld_req, gst_req, cl_full_l2, cl_part_l2, cl_full_l1, cl_part_l1;
+  if (!cuttGpuModelHost(plan, prop.warpSize, accWidth, cacheWidth,
+    gld_tran, gst_tran, gld_req, gst_req, cl_full_l2, cl_part_l2, cl_full_l1, cl_part_l1)) return;
+  double volSampled = (ts.method == PackedSplit) ? (double)ts.volMbar*(double)ts.numSplit : (double)ts.volMbar;
+  double tranModel = (double)(plan.gld_tran + plan.gst_tran)*volSampled/(double)plan.numPosMbar;
+  double tranExact = (double)gld_tran + (double)gst_tran;
+  if (tranExact <= 0.0) return;
+  double err = fabs(tranModel - tranExact)/tranExact;
+  sumTranErr += err;
+  maxTranErr = std::max(maxTranErr, err);
+  numExact++;
+}
+
+//
+// Ranks of values, ties get the average rank
+//
+void computeRanks(const std::vector<double>& x, std::vector<double>& r) {
+  int n = (int)x.size();
+  std::vector<int> ind(n);
+  for (int i=0;i < n;i++) ind[i] = i;
+  std::sort(ind.begin(), ind.end(), [&x](const int a, const int b) {return x[a] < x[b];});
+  r.resize(n);
+  int i = 0;
+  while (i < n) {
+    int j = i;
+    while (j + 1 < n && x[ind[j + 1]] == x[ind[i]]) j++;
+    double ave = 0.5*(double)(i + j);
+    for (int k=i;k <= j;k++) r[ind[k]] = ave;
+    i = j + 1;
+  }
+}
+
+//
+// Spearman rank correlation of x and y
+//
+double rankCorrelation(const std::vector<double>& x, const std::vector<double>& y) {
+  std::vector<double> rx, ry;
+  computeRanks(x, rx);
+  computeRanks(y, ry);
+  int n = (int)x.size();
+  double mx = 0.0;
+  double my = 0.0;
+  for (int i=0;i < n;i++) {
+    mx += rx[i];
+    my += ry[i];
+  }
+  mx /= (double)n;
+  my /= (double)n;
+  double sxy = 0.0;
+  double sxx = 0.0;
+  double syy = 0.0;
+  for (int i=0;i < n;i++) {
+    sxy += (rx[i] - mx)*(ry[i] - my);
+    sxx += (rx[i] - mx)*(rx[i] - mx);
+    syy += (ry[i] - my)*(ry[i] - my);
+  }
+  if (sxx == 0.0 || syy == 0.0) return 0.0;
+  return sxy/sqrt(sxx*syy);
+}
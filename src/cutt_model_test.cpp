@@ -0,0 +1,385 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+//
+// Host test of the cost model position generators and counters against their slow reference
+// versions, and of the sampled transaction counts of the planner against the exact host
+// counters. Runs without a GPU.
+//
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <list>
+#include "cuttGpuModel.h"
+#include "cuttGpuModelHost.h"
+#include "cuttDeviceProfile.h"
+
+bool testComputePos(const int numDesc);
+bool testFastDiv(const int numRandom);
+bool testComputePosFast(const int numDesc);
+bool testCountPackedSh(const int numDesc);
+bool testGpuModelHost(const char* profileName, const int numTensor);
+
+int main() {
+
+  int numFail = 0;
+  if (!testComputePos(3000)) numFail++;
+  if (!testFastDiv(200000)) numFail++;
+  if (!testComputePosFast(3000)) numFail++;
+  if (!testCountPackedSh(3000)) numFail++;
+  if (!testGpuModelHost("V100", 100)) numFail++;
+  if (!testGpuModelHost("MI250", 100)) numFail++;
+
+  if (numFail > 0) {
+    printf("cutt_model_test: %d tests FAILED\n", numFail);
+    return 1;
+  }
+  printf("cutt_model_test: all tests OK\n");
+  return 0;
+}
+
+//
+// Returns a random descriptor of rank numConv. With mixedRadix, both sides are mixed-radix
+// numbers over the same dimensions in different rank orders, as the planner builds them.
+// Otherwise c and d are arbitrary. Returns the volume of the dimensions
+//
+int genConv(std::mt19937& gen, const int numConv, const bool mixedRadix,
+  std::vector<TensorConvInOut>& conv) {
+
+  conv.resize(numConv);
+  int vol = 1;
+  for (int k=0;k < numConv;k++) {
+    // Dimensions of 1 are common after rank reduction of Mbar
+    int d = (gen() % 4 == 0) ? 1 : 2 + gen() % 7;
+    conv[k].d_in = d;
+    conv[k].d_out = d;
+    conv[k].ct_in = 1 + gen() % 50;
+    conv[k].ct_out = 1 + gen() % 50;
+    vol *= d;
+  }
+  if (mixedRadix) {
+    std::vector<int> orderIn(numConv);
+    std::vector<int> orderOut(numConv);
+    for (int k=0;k < numConv;k++) {
+      orderIn[k] = k;
+      orderOut[k] = k;
+    }
+    std::shuffle(orderIn.begin(), orderIn.end(), gen);
+    std::shuffle(orderOut.begin(), orderOut.end(), gen);
+    int cIn = 1;
+    int cOut = 1;
+    for (int k=0;k < numConv;k++) {
+      conv[orderIn[k]].c_in = cIn;
+      cIn *= conv[orderIn[k]].d_in;
+      conv[orderOut[k]].c_out = cOut;
+      cOut *= conv[orderOut[k]].d_out;
+    }
+  } else {
+    for (int k=0;k < numConv;k++) {
+      conv[k].c_in = 1 + gen() % 100;
+      conv[k].c_out = 1 + gen() % 100;
+    }
+  }
+  return vol;
+}
+
+//
+// computePos() against computePosRef() on random descriptors and ranges, including ranges that
+// do not start at zero and ranges past the volume, where the top rank wraps around
+//
+bool testComputePos(const int numDesc) {
+  std::mt19937 gen(1);
+  std::vector<TensorConvInOut> conv;
+  std::vector<int> posIn, posOut, posInRef, posOutRef;
+  int numMismatch = 0;
+  for (int idesc=0;idesc < numDesc;idesc++) {
+    int numConv = 1 + gen() % 8;
+    bool mixedRadix = (gen() % 4 != 0);
+    int vol = genConv(gen, numConv, mixedRadix, conv);
+    int vol0 = (gen() % 2 == 0) ? 0 : (int)(gen() % (2*vol));
+    int n = 1 + gen() % (2*vol);
+    int vol1 = vol0 + n - 1;
+    posIn.assign(n, -1);
+    posOut.assign(n, -1);
+    posInRef.assign(n, 0);
+    posOutRef.assign(n, 0);
+    computePos(vol0, vol1, conv.data(), numConv, posIn.data(), posOut.data());
+    computePosRef(vol0, vol1, conv.begin(), conv.end(), posInRef, posOutRef);
+    if (posIn != posInRef || posOut != posOutRef) {
+      if (numMismatch++ < 10) {
+        printf("testComputePos: descriptor %d rank %d mixedRadix %d vol0 %d vol1 %d mismatch\n",
+          idesc, numConv, mixedRadix, vol0, vol1);
+      }
+    }
+  }
+  if (numMismatch > 0) {
+    printf("testComputePos: %d of %d descriptors mismatch\n", numMismatch, numDesc);
+    return false;
+  }
+  printf("testComputePos: %d descriptors OK\n", numDesc);
+  return true;
+}
+
+//
+// fastDiv() and fastMod() against / and % for divisors 1...1000, powers of two and their
+// neighbours, divisors near INT_MAX and random divisors. Numerators are those next to multiples
+// of the divisor, those near INT_MAX and random ones
+//
+bool testFastDiv(const int numRandom) {
+  std::mt19937 gen(2);
+  std::vector<int> divisors;
+  for (int d=1;d <= 1000;d++) divisors.push_back(d);
+  for (int l=1;l < 31;l++) {
+    divisors.push_back((1 << l) - 1);
+    divisors.push_back(1 << l);
+    divisors.push_back((1 << l) + 1);
+  }
+  for (int i=0;i < 16;i++) divisors.push_back(INT_MAX - i);
+  for (int i=0;i < 1000;i++) divisors.push_back(1 + (int)(gen() % INT_MAX));
+
+  int numCheck = 0;
+  int numMismatch = 0;
+  std::vector<int> numerators;
+  for (int id=0;id < (int)divisors.size();id++) {
+    const int d = divisors[id];
+    FastDiv f = makeFastDiv(d);
+    numerators.clear();
+    for (int i=0;i < 3;i++) {
+      numerators.push_back(i);
+      numerators.push_back(INT_MAX - i);
+      long long m = (long long)d*(i + 1);
+      if (m - 1 <= INT_MAX) numerators.push_back((int)(m - 1));
+      if (m <= INT_MAX) numerators.push_back((int)m);
+      if (m + 1 <= INT_MAX) numerators.push_back((int)(m + 1));
+    }
+    // Largest multiple of d and its neighbours
+    int mmax = INT_MAX - INT_MAX % d;
+    numerators.push_back(mmax);
+    numerators.push_back(mmax - 1);
+    for (int i=0;i < numRandom/(int)divisors.size();i++) numerators.push_back((int)(gen() % INT_MAX));
+    for (int in=0;in < (int)numerators.size();in++) {
+      const int n = numerators[in];
+      numCheck++;
+      if (fastDiv(n, f) != n / d || fastMod(n, f) != n % d) {
+        if (numMismatch++ < 10) {
+          printf("testFastDiv: %d / %d = %d, fastDiv %d, %d %% %d = %d, fastMod %d\n",
+            n, d, n / d, fastDiv(n, f), n, d, n % d, fastMod(n, f));
+        }
+      }
+    }
+  }
+  if (numMismatch > 0) {
+    printf("testFastDiv: %d of %d divisions mismatch\n", numMismatch, numCheck);
+    return false;
+  }
+  printf("testFastDiv: %d divisors, %d divisions OK\n", (int)divisors.size(), numCheck);
+  return true;
+}
+
+//
+// computePos() with precomputed reciprocals against computePosRef(), for ranks with and without
+// a specialised version. Ranges include positions just below INT_MAX
+//
+bool testComputePosFast(const int numDesc) {
+  std::mt19937 gen(3);
+  std::vector<TensorConvInOut> conv;
+  std::vector<TensorConvInOutFast> fastConv;
+  std::vector<int> posIn, posOut, posInRef, posOutRef;
+  int numMismatch = 0;
+  for (int idesc=0;idesc < numDesc;idesc++) {
+    int numConv = 1 + gen() % (MAX_SPECIALIZED_RANK + 2);
+    int vol = genConv(gen, numConv, (gen() % 2 == 0), conv);
+    fastConv.resize(numConv);
+    makeFastConv(conv.data(), numConv, fastConv.data());
+    int n = 1 + gen() % (2*vol);
+    // computePosRef() loops up to vol1 inclusive, ranges end at INT_MAX - 1 at the latest
+    int vol0 = (gen() % 8 == 0) ? INT_MAX - n : (int)(gen() % (2*vol));
+    int vol1 = vol0 + (n - 1);
+    posIn.assign(n, -1);
+    posOut.assign(n, -1);
+    posInRef.assign(n, 0);
+    posOutRef.assign(n, 0);
+    computePos(vol0, vol1, fastConv.data(), numConv, posIn.data(), posOut.data());
+    computePosRef(vol0, vol1, conv.begin(), conv.end(), posInRef, posOutRef);
+    if (posIn != posInRef || posOut != posOutRef) {
+      if (numMismatch++ < 10) {
+        printf("testComputePosFast: descriptor %d rank %d vol0 %d vol1 %d mismatch\n",
+          idesc, numConv, vol0, vol1);
+      }
+    }
+  }
+  if (numMismatch > 0) {
+    printf("testComputePosFast: %d of %d descriptors mismatch\n", numMismatch, numDesc);
+    return false;
+  }
+  printf("testComputePosFast: %d descriptors OK\n", numDesc);
+  return true;
+}
+
+//
+// countPackedShTransactions0() against countPackedShTransactionsRef() on random shared memory
+// descriptors, for ranks with and without a specialised version. As in the planner, c of the
+// descriptor follows the rank order and ct is a mixed-radix number in a permuted order
+//
+bool testCountPackedSh(const int numDesc) {
+  std::mt19937 gen(4);
+  std::vector<TensorConv> msh;
+  std::vector<int> order;
+  int numMismatch = 0;
+  for (int idesc=0;idesc < numDesc;idesc++) {
+    int numMsh = 1 + gen() % (MAX_SPECIALIZED_RANK + 2);
+    msh.resize(numMsh);
+    order.resize(numMsh);
+    int vol = 1;
+    for (int k=0;k < numMsh;k++) {
+      msh[k].c = vol;
+      msh[k].d = (gen() % 4 == 0) ? 1 : 2 + gen() % 5;
+      vol *= msh[k].d;
+      order[k] = k;
+    }
+    std::shuffle(order.begin(), order.end(), gen);
+    int ct = 1;
+    for (int k=0;k < numMsh;k++) {
+      msh[order[k]].ct = ct;
+      // Padding of the shared memory buffer
+      ct *= msh[order[k]].d + ((gen() % 4 == 0) ? 1 : 0);
+    }
+    int volMmk = (gen() % 4 == 0) ? 1 + gen() % vol : vol;
+    // The planner counts with one bank per thread of the warp
+    int warpSize = (gen() % 2 == 0) ? 32 : 64;
+    int bankWidth = warpSize;
+    int numthread = warpSize*(1 + gen() % (1024/warpSize));
+
+    int sld_tran = 0, sst_tran = 0, sld_req = 0, sst_req = 0;
+    countPackedShTransactions0(warpSize, bankWidth, numthread, volMmk, msh.data(), numMsh,
+      sld_tran, sst_tran, sld_req, sst_req);
+    int sld_tran_ref = 0, sst_tran_ref = 0, sld_req_ref = 0, sst_req_ref = 0;
+    countPackedShTransactionsRef(warpSize, bankWidth, numthread, volMmk, msh.data(), numMsh,
+      sld_tran_ref, sst_tran_ref, sld_req_ref, sst_req_ref);
+    if (sld_tran != sld_tran_ref || sst_tran != sst_tran_ref ||
+      sld_req != sld_req_ref || sst_req != sst_req_ref) {
+      if (numMismatch++ < 10) {
+        printf("testCountPackedSh: descriptor %d rank %d volMmk %d sld_tran %d %d sst_tran %d %d sld_req %d %d sst_req %d %d\n",
+          idesc, numMsh, volMmk, sld_tran, sld_tran_ref, sst_tran, sst_tran_ref,
+          sld_req, sld_req_ref, sst_req, sst_req_ref);
+      }
+    }
+  }
+  if (numMismatch > 0) {
+    printf("testCountPackedSh: %d of %d descriptors mismatch\n", numMismatch, numDesc);
+    return false;
+  }
+  printf("testCountPackedSh: %d descriptors OK\n", numDesc);
+  return true;
+}
+
+//
+// Transaction counts of cuttPlan_t::countCycles() over every Mbar position against
+// cuttGpuModelHost() for all candidate plans of random tensors, planned for a built-in profile.
+// Fails unless Packed, PackedSplit with an uneven split, Tiled and TiledCopy were all compared
+//
+bool testGpuModelHost(const char* profileName, const int numTensor) {
+  cuttDeviceProfile profile;
+  if (!cuttGetDeviceProfile(profileName, profile)) return false;
+  cuttSetDeviceProfile(&profile);
+  hipDeviceProp_t prop = profile.prop;
+  std::mt19937 gen(5);
+  std::vector<int> numPlan(NumTransposeMethods, 0);
+  int numUnevenSplit = 0;
+  int numMismatch = 0;
+  for (int itensor=0;itensor < numTensor;itensor++) {
+    int rank = 2 + gen() % 4;
+    std::vector<int> dim(rank);
+    std::vector<int> permutation(rank);
+    int vol = 1;
+    for (int i=0;i < rank;i++) {
+      // Volume at most 2^18 elements, so that exact counting stays fast
+      int maxDim = std::max(2, (1 << 18)/vol/(1 << (rank - 1 - i)));
+      dim[i] = 2 + gen() % std::min(maxDim - 1, (i == 0) ? 300 : 40);
+      vol *= dim[i];
+      permutation[i] = i;
+    }
+    // Any permutation but the identity, keeping the leading rank gives TiledCopy plans
+    while (std::is_sorted(permutation.begin(), permutation.end())) {
+      std::shuffle(permutation.begin(), permutation.end(), gen);
+    }
+    size_t sizeofType = (gen() % 2 == 0) ? 4 : 8;
+
+    std::vector<int> redDim;
+    std::vector<int> redPermutation;
+    reduceRanks(rank, dim.data(), permutation.data(), redDim, redPermutation);
+    std::list<cuttPlan_t> plans;
+    if (!cuttPlan_t::createPlans(rank, dim.data(), permutation.data(), redDim.size(), redDim.data(),
+      redPermutation.data(), sizeofType, 0, prop, plans)) {
+      printf("testGpuModelHost: createPlans failed\n");
+      cuttSetDeviceProfile(NULL);
+      return false;
+    }
+
+    for (auto it=plans.begin();it != plans.end();it++) {
+      const TensorSplit& ts = it->tensorSplit;
+      if (ts.method == Trivial) continue;
+      if (!it->countCycles(prop, 0)) continue;
+      // Same widths as in cuttPlan_t::countCycles()
+      const int accWidth = 128/it->sizeofType;
+      const int cacheWidth = 64/it->sizeofType;
+      int gld_tran, gst_tran, gld_req, gst_req, cl_full_l2, cl_part_l2, cl_full_l1, cl_part_l1;
+      if (!cuttGpuModelHost(*it, prop.warpSize, accWidth, cacheWidth,
+        gld_tran, gst_tran, gld_req, gst_req, cl_full_l2, cl_part_l2, cl_full_l1, cl_part_l1)) {
+        printf("testGpuModelHost: cuttGpuModelHost failed\n");
+        cuttSetDeviceProfile(NULL);
+        return false;
+      }
+      numPlan[ts.method]++;
+      if (ts.method == PackedSplit && ts.splitDim % ts.numSplit != 0) numUnevenSplit++;
+      if (it->gld_tran != gld_tran || it->gst_tran != gst_tran || it->gld_req != gld_req ||
+        it->gst_req != gst_req || it->cl_full_l2 != cl_full_l2 || it->cl_part_l2 != cl_part_l2) {
+        if (numMismatch++ < 10) {
+          printf("testGpuModelHost: %s tensor %d method %d gld_tran %d %d gst_tran %d %d gld_req %d %d gst_req %d %d cl_full_l2 %d %d cl_part_l2 %d %d\n",
+            profileName, itensor, ts.method, it->gld_tran, gld_tran, it->gst_tran, gst_tran,
+            it->gld_req, gld_req, it->gst_req, gst_req, it->cl_full_l2, cl_full_l2,
+            it->cl_part_l2, cl_part_l2);
+        }
+      }
+    }
+  }
+  cuttSetDeviceProfile(NULL);
+  int numTotal = numPlan[Packed] + numPlan[PackedSplit] + numPlan[Tiled] + numPlan[TiledCopy];
+  if (numMismatch > 0) {
+    printf("testGpuModelHost: %s %d of %d plans mismatch\n", profileName, numMismatch, numTotal);
+    return false;
+  }
+  if (numPlan[Packed] == 0 || numUnevenSplit == 0 || numPlan[Tiled] == 0 || numPlan[TiledCopy] == 0) {
+    printf("testGpuModelHost: %s plans Packed %d PackedSplit %d (uneven %d) Tiled %d TiledCopy %d, not all methods covered\n",
+      profileName, numPlan[Packed], numPlan[PackedSplit], numUnevenSplit, numPlan[Tiled], numPlan[TiledCopy]);
+    return false;
+  }
+  printf("testGpuModelHost: %s %d plans OK (Packed %d PackedSplit %d uneven %d Tiled %d TiledCopy %d)\n",
+    profileName, numTotal, numPlan[Packed], numPlan[PackedSplit], numUnevenSplit, numPlan[Tiled],
+    numPlan[TiledCopy]);
+  return true;
+}
@@ -0,0 +1,110 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+//
+// Plans tensor transposes for a device profile and prints the chosen plans and their
+// predicted times. Runs without a GPU.
+//
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstdio>
+#include <cstring>         // strcmp
+#include "cuttPlanner.h"
+
+// Parses comma separated list of integers
+bool parseList(const char* str, std::vector<int>& list) {
+  list.clear();
+  std::istringstream in(str);
+  std::string item;
+  while (std::getline(in, item, ',')) {
+    int val;
+    if (sscanf(item.c_str(), "%d", &val) != 1) return false;
+    list.push_back(val);
+  }
+  return !list.empty();
+}
+
+int main(int argc, char *argv[]) {
+
+  const char* profileName = NULL;
+  std::vector<int> dim;
+  std::vector<int> permutation;
+  int sizeofType = 8;
+  bool arg_ok = true;
+  int i = 1;
+  while (i < argc) {
+    if (strcmp(argv[i], "-profile") == 0 && i + 1 < argc) {
+      profileName = argv[i+1];
+      i += 2;
+    } else if (strcmp(argv[i], "-dim") == 0 && i + 1 < argc) {
+      arg_ok = parseList(argv[i+1], dim);
+      i += 2;
+    } else if (strcmp(argv[i], "-permutation") == 0 && i + 1 < argc) {
+      arg_ok = parseList(argv[i+1], permutation);
+      i += 2;
+    } else if (strcmp(argv[i], "-type") == 0 && i + 1 < argc) {
+      sscanf(argv[i+1], "%d", &sizeofType);
+      i += 2;
+    } else {
+      arg_ok = false;
+    }
+    if (!arg_ok) break;
+  }
+
+  if (!arg_ok || profileName == NULL || dim.empty() || dim.size() != permutation.size()) {
+    printf("cutt_plan [options]\n");
+    printf("Options:\n");
+    printf("-profile [name]      : built-in device profile or profile file\n");
+    printf("-dim [list]          : comma separated dimensions, e.g. 31,64,16\n");
+    printf("-permutation [list]  : comma separated permutation, e.g. 2,0,1\n");
+    printf("-type [int]          : size of the elements in bytes, 2, 4 or 8 (default is 8)\n");
+    printf("Built-in profiles:");
+    std::vector<std::string> names = cuttDeviceProfileNames();
+    for (int j=0;j < (int)names.size();j++) printf(" %s", names[j].c_str());
+    printf("\n");
+    return 1;
+  }
+
+  cuttDeviceProfile profile;
+  if (!cuttGetDeviceProfile(profileName, profile)) {
+    if (!cuttReadDeviceProfile(profileName, profile)) return 1;
+  }
+  printf("Planning for %s SM version %d.%d\n", profile.prop.name, profile.prop.major, profile.prop.minor);
+
+  cuttPlannerResult result;
+  if (!cuttPlannerPlan(profile, (int)dim.size(), dim.data(), permutation.data(), sizeofType, result)) {
+    return 1;
+  }
+
+  printf("method %s\n", cuttPlannerMethodName(result.method));
+  printf("numthread %d %d %d numblock %d %d %d shmemsize %d numRegStorage %d numActiveBlock %d\n",
+    result.numthread[0], result.numthread[1], result.numthread[2],
+    result.numblock[0], result.numblock[1], result.numblock[2],
+    (int)result.shmemsize, result.numRegStorage, result.numActiveBlock);
+  printf("cycles %e time %1.3lf ms\n", result.cycles, result.time*1000.0);
+
+  return 0;
+}
@@ -0,0 +1,568 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+//
+// Plan-selection regression test. Plans a fixed corpus of tensor transposes for stored device
+// profiles with the planner-only library and compares the chosen plans against golden files.
+// Runs without a GPU.
+//
+// Directory layout:
+//   corpus.txt         : one case per line "sizeofType rank dim[0..rank-1] permutation[0..rank-1]"
+//   profiles/NAME.txt  : device profiles
+//   NAME.txt           : golden plans for profile NAME, one line per case
+//
+// Method, split and launch configuration must match exactly, predicted cycles within a
+// relative tolerance. Use -update to rewrite the golden files after intended planner changes.
+//
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <thread>
+#include <cstdio>
+#include <cstring>         // strcmp
+#include <cmath>
+#include "cuttPlanner.h"
+#include "cuttplan.h"          // Packed, PackedSplit
+
+// Tensor transpose in the corpus
+struct PlanCase {
+  int sizeofType;
+  std::vector<int> dim;
+  std::vector<int> permutation;
+};
+
+// Golden plan of one case
+struct GoldenPlan {
+  int method;
+  int rank;
+  int sizeMm;
+  int sizeMk;
+  int splitRank;
+  int numSplit;
+  int numRegStorage;
+  int numthread;
+  int numblock;
+  double cycles;
+};
+
+bool readCorpus(const std::string& filename, std::vector<PlanCase>& cases);
+bool writeCorpus(const std::string& filename, const std::vector<PlanCase>& cases);
+void genCorpus(std::vector<PlanCase>& cases);
+bool readGolden(const std::string& filename, std::vector<GoldenPlan>& golden);
+bool writeGolden(const std::string& filename, const std::vector<GoldenPlan>& golden);
+GoldenPlan makeGolden(const cuttPlannerResult& result);
+bool sameDecision(const GoldenPlan& a, const GoldenPlan& b);
+int checkConcurrent(const std::vector<std::string>& names, const std::vector<cuttDeviceProfile>& profiles,
+  const std::vector<PlanCase>& cases, const std::vector< std::vector<GoldenPlan> >& serialPlans);
+int checkSpill(const char* name, const std::vector<PlanCase>& cases);
+
+int main(int argc, char *argv[]) {
+
+  std::string dir = "golden";
+  std::vector<std::string> profileNames = cuttDeviceProfileNames();
+  const char* profileName = NULL;
+  double tol = 1.0e-3;
+  bool update = false;
+  bool gencorpus = false;
+  bool arg_ok = true;
+  int i = 1;
+  while (i < argc) {
+    if (strcmp(argv[i], "-dir") == 0 && i + 1 < argc) {
+      dir = argv[i+1];
+      i += 2;
+    } else if (strcmp(argv[i], "-profile") == 0 && i + 1 < argc) {
+      profileName = argv[i+1];
+      i += 2;
+    } else if (strcmp(argv[i], "-tol") == 0 && i + 1 < argc) {
+      sscanf(argv[i+1], "%lf", &tol);
+      i += 2;
+    } else if (strcmp(argv[i], "-update") == 0) {
+      update = true;
+      i++;
+    } else if (strcmp(argv[i], "-gencorpus") == 0) {
+      gencorpus = true;
+      i++;
+    } else {
+      arg_ok = false;
+      break;
+    }
+  }
+
+  if (!arg_ok) {
+    printf("cutt_plan_test [options]\n");
+    printf("Options:\n");
+    printf("-dir [name]     : directory with corpus, profiles and golden files (default is golden)\n");
+    printf("-profile [name] : test only profile name (default is all built-in profiles)\n");
+    printf("-tol [float]    : relative tolerance of predicted cycles (default is 1e-3)\n");
+    printf("-update         : write golden files (and missing profiles) instead of comparing\n");
+    printf("-gencorpus      : generate corpus.txt and exit\n");
+    return 1;
+  }
+
+  if (profileName != NULL) {
+    profileNames.clear();
+    profileNames.push_back(profileName);
+  }
+
+  std::vector<PlanCase> cases;
+  if (gencorpus) {
+    genCorpus(cases);
+    if (!writeCorpus(dir + "/corpus.txt", cases)) return 1;
+    printf("Wrote %d cases to %s/corpus.txt\n", (int)cases.size(), dir.c_str());
+    return 0;
+  }
+  if (!readCorpus(dir + "/corpus.txt", cases)) return 1;
+
+  int numFail = 0;
+  // Profiles and their plans, for the concurrent planning check
+  std::vector<cuttDeviceProfile> profiles;
+  std::vector< std::vector<GoldenPlan> > allPlans;
+  for (int iprof=0;iprof < (int)profileNames.size();iprof++) {
+    const std::string& name = profileNames[iprof];
+    std::string profileFilename = dir + "/profiles/" + name + ".txt";
+    std::string goldenFilename = dir + "/" + name + ".txt";
+
+    cuttDeviceProfile profile;
+    std::ifstream profileFile(profileFilename.c_str());
+    if (profileFile.is_open()) {
+      profileFile.close();
+      if (!cuttReadDeviceProfile(profileFilename.c_str(), profile)) return 1;
+    } else if (update && cuttGetDeviceProfile(name.c_str(), profile)) {
+      if (!cuttWriteDeviceProfile(profileFilename.c_str(), profile)) return 1;
+    } else {
+      printf("Profile %s not found\n", profileFilename.c_str());
+      return 1;
+    }
+
+    std::vector<GoldenPlan> golden;
+    if (!update && !readGolden(goldenFilename, golden)) return 1;
+    if (!update && golden.size() != cases.size()) {
+      printf("%s has %d plans, corpus has %d cases\n", goldenFilename.c_str(),
+        (int)golden.size(), (int)cases.size());
+      return 1;
+    }
+
+    std::vector<GoldenPlan> plans(cases.size());
+    int numMismatch = 0;
+    double maxCyclesErr = 0.0;
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    for (int icase=0;icase < (int)cases.size();icase++) {
+      const PlanCase& c = cases[icase];
+      cuttPlannerResult result;
+      if (!cuttPlannerPlan(profile, (int)c.dim.size(), c.dim.data(), c.permutation.data(),
+        c.sizeofType, result)) {
+        printf("%s case %d: planning failed\n", name.c_str(), icase);
+        return 1;
+      }
+      plans[icase] = makeGolden(result);
+      if (update) continue;
+      const GoldenPlan& g = golden[icase];
+      const GoldenPlan& p = plans[icase];
+      double cyclesErr = fabs(p.cycles - g.cycles)/std::max(1.0, fabs(g.cycles));
+      maxCyclesErr = std::max(maxCyclesErr, cyclesErr);
+      if (!sameDecision(p, g) || cyclesErr > tol) {
+        numMismatch++;
+        printf("%s case %d MISMATCH\n", name.c_str(), icase);
+        printf("  golden  method %s sizeMm %d sizeMk %d splitRank %d numSplit %d numRegStorage %d numthread %d numblock %d cycles %e\n",
+          cuttPlannerMethodName(g.method), g.sizeMm, g.sizeMk, g.splitRank, g.numSplit,
+          g.numRegStorage, g.numthread, g.numblock, g.cycles);
+        printf("  planned method %s sizeMm %d sizeMk %d splitRank %d numSplit %d numRegStorage %d numthread %d numblock %d cycles %e\n",
+          cuttPlannerMethodName(p.method), p.sizeMm, p.sizeMk, p.splitRank, p.numSplit,
+          p.numRegStorage, p.numthread, p.numblock, p.cycles);
+      }
+    }
+    std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+    double duration = std::chrono::duration_cast< std::chrono::duration<double> >(end - start).count();
+
+    if (update) {
+      if (!writeGolden(goldenFilename, plans)) return 1;
+      printf("%-8s wrote %d plans to %s, planning %1.3lf ms per case\n", name.c_str(),
+        (int)plans.size(), goldenFilename.c_str(), duration*1000.0/(double)cases.size());
+    } else {
+      printf("%-8s %d cases %d mismatches, max cycles error %1.2e, planning %1.3lf ms per case\n",
+        name.c_str(), (int)cases.size(), numMismatch, maxCyclesErr,
+        duration*1000.0/(double)cases.size());
+    }
+    numFail += numMismatch;
+    profiles.push_back(profile);
+    allPlans.push_back(plans);
+  }
+
+  if (!update) numFail += checkConcurrent(profileNames, profiles, cases, allPlans);
+  if (!update) numFail += checkSpill("V100", cases);
+
+  if (numFail > 0) {
+    printf("FAILED: %d plans differ from golden files\n", numFail);
+    return 1;
+  }
+  return 0;
+}
+
+GoldenPlan makeGolden(const cuttPlannerResult& result) {
+  GoldenPlan g;
+  g.method = result.method;
+  g.rank = result.rank;
+  g.sizeMm = result.sizeMm;
+  g.sizeMk = result.sizeMk;
+  g.splitRank = result.splitRank;
+  g.numSplit = result.numSplit;
+  g.numRegStorage = result.numRegStorage;
+  g.numthread = result.numthread[0]*result.numthread[1]*result.numthread[2];
+  g.numblock = result.numblock[0]*result.numblock[1]*result.numblock[2];
+  g.cycles = result.cycles;
+  return g;
+}
+
+bool sameDecision(const GoldenPlan& a, const GoldenPlan& b) {
+  return (a.method == b.method && a.rank == b.rank && a.sizeMm == b.sizeMm && a.sizeMk == b.sizeMk &&
+    a.splitRank == b.splitRank && a.numSplit == b.numSplit && a.numRegStorage == b.numRegStorage &&
+    a.numthread == b.numthread && a.numblock == b.numblock);
+}
+
+//
+// Plans the cases for all profiles at the same time, one thread per profile, and compares
+// against the plans made one profile at a time. Returns the number of differing plans
+//
+int checkConcurrent(const std::vector<std::string>& names, const std::vector<cuttDeviceProfile>& profiles,
+  const std::vector<PlanCase>& cases, const std::vector< std::vector<GoldenPlan> >& serialPlans) {
+
+  std::vector<int> numDiff(profiles.size(), 0);
+  std::vector<std::thread> threads;
+  for (int iprof=0;iprof < (int)profiles.size();iprof++) {
+    threads.push_back(std::thread([&, iprof]() {
+      for (int icase=0;icase < (int)cases.size();icase++) {
+        const PlanCase& c = cases[icase];
+        cuttPlannerResult result;
+        if (!cuttPlannerPlan(profiles[iprof], (int)c.dim.size(), c.dim.data(), c.permutation.data(),
+          c.sizeofType, result)) {
+          numDiff[iprof]++;
+          continue;
+        }
+        GoldenPlan p = makeGolden(result);
+        const GoldenPlan& g = serialPlans[iprof][icase];
+        if (!sameDecision(p, g) || p.cycles != g.cycles) numDiff[iprof]++;
+      }
+    }));
+  }
+  int numFail = 0;
+  for (int iprof=0;iprof < (int)profiles.size();iprof++) {
+    threads[iprof].join();
+    if (numDiff[iprof] > 0) {
+      printf("%s: %d plans differ when planned concurrently with other profiles\n",
+        names[iprof].c_str(), numDiff[iprof]);
+    }
+    numFail += numDiff[iprof];
+  }
+  if (numFail == 0) {
+    printf("concurrent planning for %d profiles matches\n", (int)profiles.size());
+  }
+  return numFail;
+}
+
+//
+// Plans the cases for built-in profile name with kernel entries for every Packed and PackedSplit
+// kernel, once without spills and once with deep register storages spilling. Plans that did not
+// use a deep storage must not change, the others must change or get more expensive.
+// Returns the number of failing plans
+//
+int checkSpill(const char* name, const std::vector<PlanCase>& cases) {
+  cuttDeviceProfile noSpill;
+  if (!cuttGetDeviceProfile(name, noSpill)) return 1;
+  cuttDeviceProfile spill = noSpill;
+  const int methods[2] = {Packed, PackedSplit};
+  const int sizeofTypes[3] = {2, 4, 8};
+  for (int im=0;im < 2;im++) {
+    for (int is=0;is < 3;is++) {
+      for (int numRegStorage=1;numRegStorage <= MAX_REG_STORAGE;numRegStorage++) {
+        if (!isRegStorageDepth(numRegStorage)) continue;
+        std::vector<int> key(3);
+        key[0] = methods[im];
+        key[1] = sizeofTypes[is];
+        key[2] = numRegStorage;
+        KernelResource kr;
+        kr.numRegs = 32;
+        kr.sharedSizeBytes = 0;
+        kr.maxThreadsPerBlock = 1024;
+        kr.localSizeBytes = 0;
+        noSpill.kernelResource[key] = kr;
+        if (numRegStorage > REG_STORAGE_DENSE) kr.localSizeBytes = 64*numRegStorage;
+        spill.kernelResource[key] = kr;
+      }
+    }
+  }
+
+  int numDeep = 0;
+  int numFail = 0;
+  for (int icase=0;icase < (int)cases.size();icase++) {
+    const PlanCase& c = cases[icase];
+    cuttPlannerResult resultNoSpill;
+    cuttPlannerResult resultSpill;
+    if (!cuttPlannerPlan(noSpill, (int)c.dim.size(), c.dim.data(), c.permutation.data(),
+      c.sizeofType, resultNoSpill) ||
+      !cuttPlannerPlan(spill, (int)c.dim.size(), c.dim.data(), c.permutation.data(),
+      c.sizeofType, resultSpill)) {
+      printf("%s spill case %d: planning failed\n", name, icase);
+      numFail++;
+      continue;
+    }
+    GoldenPlan a = makeGolden(resultNoSpill);
+    GoldenPlan b = makeGolden(resultSpill);
+    bool deep = ((a.method == Packed || a.method == PackedSplit) && a.numRegStorage > REG_STORAGE_DENSE);
+    if (deep) numDeep++;
+    bool ok = deep ? (!sameDecision(a, b) || b.cycles > a.cycles) : (sameDecision(a, b) && a.cycles == b.cycles);
+    if (!ok) {
+      printf("%s spill case %d: method %s numRegStorage %d cycles %e, with spills method %s numRegStorage %d cycles %e\n",
+        name, icase, cuttPlannerMethodName(a.method), a.numRegStorage, a.cycles,
+        cuttPlannerMethodName(b.method), b.numRegStorage, b.cycles);
+      numFail++;
+    }
+  }
+  if (numDeep == 0) {
+    printf("%s spill: no case uses register storage deeper than %d\n", name, REG_STORAGE_DENSE);
+    numFail++;
+  }
+  if (numFail == 0) {
+    printf("%s spill: %d plans with deep register storage change or slow down with spills\n", name, numDeep);
+  }
+  return numFail;
+}
+
+bool readCorpus(const std::string& filename, std::vector<PlanCase>& cases) {
+  std::ifstream file(filename.c_str());
+  if (!file.is_open()) {
+    printf("Unable to open file %s\n", filename.c_str());
+    return false;
+  }
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty() || line[0] == '#') continue;
+    std::istringstream in(line);
+    PlanCase c;
+    int rank;
+    bool ok = (bool)(in >> c.sizeofType >> rank) && rank > 0;
+    if (ok) {
+      c.dim.resize(rank);
+      c.permutation.resize(rank);
+      for (int r=0;r < rank;r++) ok = ok && (bool)(in >> c.dim[r]);
+      for (int r=0;r < rank;r++) ok = ok && (bool)(in >> c.permutation[r]);
+    }
+    if (!ok) {
+      printf("Invalid line in %s: %s\n", filename.c_str(), line.c_str());
+      return false;
+    }
+    cases.push_back(c);
+  }
+  return true;
+}
+
+bool writeCorpus(const std::string& filename, const std::vector<PlanCase>& cases) {
+  FILE* fp = fopen(filename.c_str(), "w");
+  if (fp == NULL) {
+    printf("Unable to open file %s\n", filename.c_str());
+    return false;
+  }
+  fprintf(fp, "# sizeofType rank dim[0...rank-1] permutation[0...rank-1]\n");
+  for (int i=0;i < (int)cases.size();i++) {
+    const PlanCase& c = cases[i];
+    fprintf(fp, "%d %d", c.sizeofType, (int)c.dim.size());
+    for (int r=0;r < (int)c.dim.size();r++) fprintf(fp, " %d", c.dim[r]);
+    for (int r=0;r < (int)c.permutation.size();r++) fprintf(fp, " %d", c.permutation[r]);
+    fprintf(fp, "\n");
+  }
+  fclose(fp);
+  return true;
+}
+
+bool readGolden(const std::string& filename, std::vector<GoldenPlan>& golden) {
+  std::ifstream file(filename.c_str());
+  if (!file.is_open()) {
+    printf("Unable to open file %s\n", filename.c_str());
+    return false;
+  }
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty() || line[0] == '#') continue;
+    std::istringstream in(line);
+    GoldenPlan g;
+    if (!(in >> g.method >> g.rank >> g.sizeMm >> g.sizeMk >> g.splitRank >> g.numSplit >>
+      g.numRegStorage >> g.numthread >> g.numblock >> g.cycles)) {
+      printf("Invalid line in %s: %s\n", filename.c_str(), line.c_str());
+      return false;
+    }
+    golden.push_back(g);
+  }
+  return true;
+}
+
+bool writeGolden(const std::string& filename, const std::vector<GoldenPlan>& golden) {
+  FILE* fp = fopen(filename.c_str(), "w");
+  if (fp == NULL) {
+    printf("Unable to open file %s\n", filename.c_str());
+    return false;
+  }
+  fprintf(fp, "# method rank sizeMm sizeMk splitRank numSplit numRegStorage numthread numblock cycles\n");
+  for (int i=0;i < (int)golden.size();i++) {
+    const GoldenPlan& g = golden[i];
+    fprintf(fp, "%d %d %d %d %d %d %d %d %d %.9e\n", g.method, g.rank, g.sizeMm, g.sizeMk,
+      g.splitRank, g.numSplit, g.numRegStorage, g.numthread, g.numblock, g.cycles);
+  }
+  fclose(fp);
+  return true;
+}
+
+//
+// Corpus generation. Uses its own normal deviates and shuffles so that the corpus does not
+// depend on the standard library implementation
+//
+
+// Normal deviate (Box-Muller)
+double normal(std::mt19937& rng, const double mean, const double sigma) {
+  double u1 = ((double)rng() + 1.0)/4294967296.0;
+  double u2 = (double)rng()/4294967296.0;
+  return mean + sigma*sqrt(-2.0*log(u1))*cos(2.0*M_PI*u2);
+}
+
+void shuffle(std::mt19937& rng, std::vector<int>& v) {
+  for (int i=(int)v.size() - 1;i > 0;i--) std::swap(v[i], v[rng() % (i + 1)]);
+}
+
+bool isTrivial(const std::vector<int>& permutation) {
+  for (int i=0;i < (int)permutation.size();i++) {
+    if (permutation[i] != i) return false;
+  }
+  return true;
+}
+
+// Random tensor of rank with numElem elements and ratio between the largest and
+// smallest dimension, as in cutt_bench benchmark 5
+void bench5Case(std::mt19937& rng, const int rank, const int numElem, const int ratio,
+  std::vector<int>& dim, std::vector<int>& permutation) {
+  dim.resize(rank);
+  permutation.resize(rank);
+  std::vector<double> dimf(rank);
+  double volf = 1.0;
+  for (int r=0;r < rank;r++) {
+    permutation[r] = r;
+    dimf[r] = 1.0 + (double)r*(ratio - 1.0)/(double)(rank - 1);
+    volf *= dimf[r];
+  }
+  double scale = pow((double)numElem/volf, 1.0/(double)rank);
+  for (int r=0;r < rank;r++) {
+    dim[r] = (r == rank - 1) ? ratio*dim[0] : (int)round(dimf[r]*scale);
+    dim[r] = std::max(2, dim[r]);
+  }
+  shuffle(rng, dim);
+  while (isTrivial(permutation)) shuffle(rng, permutation);
+}
+
+void genCorpus(std::vector<PlanCase>& cases) {
+  std::mt19937 rng(1234);
+  PlanCase c;
+
+  // Benchmark 5 style: small, medium and large random tensors of ranks 2-7
+  const int numElemAvg[3] = {4096, 1 << 20, 64 << 20};
+  const int ratios[2] = {1, 10};
+  for (int ielem=0;ielem < 3;ielem++) {
+    for (int iratio=0;iratio < 2;iratio++) {
+      for (int rank=2;rank <= 7;rank++) {
+        for (int iter=0;iter < 5;iter++) {
+          int numElem = (int)normal(rng, (double)numElemAvg[ielem], 0.2*(double)numElemAvg[ielem]);
+          bench5Case(rng, rank, numElem, ratios[iratio], c.dim, c.permutation);
+          c.sizeofType = (iter % 2 == 0) ? 4 : 8;
+          cases.push_back(c);
+        }
+      }
+    }
+  }
+
+  // Benchmark 6: TTC tensors
+  const int ttc[][7] = {
+    {2, 7248,7248, 1,0}, {2, 43408,1216, 1,0}, {2, 1216,43408, 1,0},
+    {3, 368,384,384, 0,2,1}, {3, 2144,64,384, 0,2,1}, {3, 368,64,2307, 0,2,1},
+    {3, 384,384,355, 1,0,2}, {3, 2320,384,59, 1,0,2}, {3, 384,2320,59, 1,0,2},
+    {3, 384,355,384, 2,1,0}, {3, 2320,59,384, 2,1,0}, {3, 384,59,2320, 2,1,0}
+  };
+  const int ttc4[][9] = {
+    {4, 80,96,75,96, 0,3,2,1}, {4, 464,16,75,96, 0,3,2,1}, {4, 80,16,75,582, 0,3,2,1},
+    {4, 96,75,96,75, 2,1,3,0}, {4, 608,12,96,75, 2,1,3,0}, {4, 96,12,608,75, 2,1,3,0},
+    {4, 96,75,96,75, 2,0,3,1}, {4, 608,12,96,75, 2,0,3,1}, {4, 96,12,608,75, 2,0,3,1},
+    {4, 96,96,75,75, 1,0,3,2}, {4, 608,96,12,75, 1,0,3,2}, {4, 96,608,12,75, 1,0,3,2},
+    {4, 96,75,75,96, 3,2,1,0}, {4, 608,12,75,96, 3,2,1,0}, {4, 96,12,75,608, 3,2,1,0}
+  };
+  const int ttc5[][11] = {
+    {5, 32,48,28,28,48, 0,4,2,1,3}, {5, 176,8,28,28,48, 0,4,2,1,3}, {5, 32,8,28,28,298, 0,4,2,1,3},
+    {5, 48,28,28,48,28, 3,2,1,4,0}, {5, 352,4,28,48,28, 3,2,1,4,0}, {5, 48,4,28,352,28, 3,2,1,4,0},
+    {5, 48,28,48,28,28, 2,0,4,1,3}, {5, 352,4,48,28,28, 2,0,4,1,3}, {5, 48,4,352,28,28, 2,0,4,1,3},
+    {5, 48,48,28,28,28, 1,3,0,4,2}, {5, 352,48,4,28,28, 1,3,0,4,2}, {5, 48,352,4,28,28, 1,3,0,4,2},
+    {5, 48,28,28,28,48, 4,3,2,1,0}, {5, 352,4,28,28,48, 4,3,2,1,0}, {5, 48,4,28,28,352, 4,3,2,1,0}
+  };
+  const int ttc6[][13] = {
+    {6, 16,32,15,32,15,15, 0,3,2,5,4,1}, {6, 48,10,15,32,15,15, 0,3,2,5,4,1}, {6, 16,10,15,103,15,15, 0,3,2,5,4,1},
+    {6, 32,15,15,32,15,15, 3,2,0,5,1,4}, {6, 112,5,15,32,15,15, 3,2,0,5,1,4}, {6, 32,5,15,112,15,15, 3,2,0,5,1,4},
+    {6, 32,15,32,15,15,15, 2,0,4,1,5,3}, {6, 112,5,32,15,15,15, 2,0,4,1,5,3}, {6, 32,5,112,15,15,15, 2,0,4,1,5,3},
+    {6, 32,15,15,32,15,15, 3,2,5,1,0,4}, {6, 112,5,15,32,15,15, 3,2,5,1,0,4}, {6, 32,5,15,112,15,15, 3,2,5,1,0,4},
+    {6, 32,15,15,15,15,32, 5,4,3,2,1,0}, {6, 112,5,15,15,15,32, 5,4,3,2,1,0}, {6, 32,5,15,15,15,112, 5,4,3,2,1,0}
+  };
+  const int* ttcRows[4] = {&ttc[0][0], &ttc4[0][0], &ttc5[0][0], &ttc6[0][0]};
+  const int ttcNumRow[4] = {12, 15, 15, 15};
+  const int ttcRowLen[4] = {7, 9, 11, 13};
+  for (int t=0;t < 4;t++) {
+    for (int row=0;row < ttcNumRow[t];row++) {
+      const int* p = ttcRows[t] + row*ttcRowLen[t];
+      int rank = p[0];
+      c.dim.assign(p + 1, p + 1 + rank);
+      c.permutation.assign(p + 1 + rank, p + 1 + 2*rank);
+      c.sizeofType = 8;
+      cases.push_back(c);
+    }
+  }
+
+  // Benchmark 7 style: ranks 8 and 12 with 4 large dimensions and rest small dimensions
+  const int dim8[8] = {5, 3, 2, 4, 35, 33, 37, 40};
+  const int dim12[12] = {2, 3, 4, 3, 2, 2, 3, 2, 20, 18, 22, 24};
+  for (int b=0;b < 2;b++) {
+    std::vector<int> dim = (b == 0) ? std::vector<int>(dim8, dim8 + 8) : std::vector<int>(dim12, dim12 + 12);
+    int rank = (int)dim.size();
+    // Inverse
+    c.dim = dim;
+    c.permutation.resize(rank);
+    for (int r=0;r < rank;r++) c.permutation[r] = rank - 1 - r;
+    c.sizeofType = 4;
+    cases.push_back(c);
+    // Random
+    for (int r=0;r < rank;r++) c.permutation[r] = r;
+    for (int nsample=0;nsample < 10;nsample++) {
+      shuffle(rng, c.dim);
+      shuffle(rng, c.permutation);
+      if (isTrivial(c.permutation)) continue;
+      c.sizeofType = (nsample % 2 == 0) ? 4 : 8;
+      cases.push_back(c);
+    }
+  }
+}
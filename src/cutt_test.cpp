@@ -30,12 +30,17 @@ All rights reserved.
 #include <ctime>           // std::time
 #include <cstring>         // strcmp
 #include <cmath>
+#include <thread>
+#include <atomic>
+#include <chrono>
 #include "cutt.h"
 #include "CudaUtils.h"
 #include "CudaMem.h"
 #include "TensorTester.h"
 #include "cuttTimer.h"
 #include "cuttGpuModel.h"  // testCounters
+#include "PlanStorage.h"   // PLANSTORAGE_INDEX_BITS
+#include "cuttContextDebug.h"
 
 //
 // Error checking wrapper for cutt
@@ -61,6 +66,13 @@ bool test2();
 bool test3();
 bool test4();
 bool test5();
+bool test6();
+bool test7();
+bool test8();
+bool test9();
+bool test10();
+bool test11();
+bool test12();
 template <typename T> bool test_tensor(std::vector<int>& dim, std::vector<int>& permutation);
 void printVec(std::vector<int>& vec);
 
@@ -109,6 +121,13 @@ int main(int argc, char *argv[]) {
   if(passed){passed = test3(); if(!passed) printf("Test 3 failed\n");}
   if(passed){passed = test4(); if(!passed) printf("Test 4 failed\n");}
   //if(passed){passed = test5(); if(!passed) printf("Test 5 failed\n");}
+  if(passed){passed = test6(); if(!passed) printf("Test 6 failed\n");}
+  if(passed){passed = test7(); if(!passed) printf("Test 7 failed\n");}
+  if(passed){passed = test8(); if(!passed) printf("Test 8 failed\n");}
+  if(passed){passed = test9(); if(!passed) printf("Test 9 failed\n");}
+  if(passed){passed = test10(); if(!passed) printf("Test 10 failed\n");}
+  if(passed){passed = test11(); if(!passed) printf("Test 11 failed\n");}
+  if(passed){passed = test12(); if(!passed) printf("Test 12 failed\n");}
 
   if(passed){
     std::vector<int> worstDim;
@@ -432,6 +451,546 @@ bool test5() {
 }
 
 
+//
+// Test 6: concurrent execution. Threads execute their own plans while another thread creates
+//         and destroys plans, and executes each one after destroying it
+//
+bool test6() {
+
+  std::vector<int> dim = {24, 32, 16, 36};
+  std::vector<int> permutation = {3, 1, 0, 2};
+  const int vol = 24*32*16*36;
+
+  const int numThread = 4;
+  const int numExec = 20;
+
+  int deviceID;
+  hipCheck(hipGetDevice(&deviceID));
+
+  hipStream_t streams[numThread];
+  cuttHandle plans[numThread];
+  for (int i=0;i < numThread;i++) {
+    hipCheck(hipStreamCreate(&streams[i]));
+    cuttCheck(cuttPlan(&plans[i], dim.size(), dim.data(), permutation.data(), sizeof(long long int), streams[i]));
+  }
+  set_device_array<long long int>(dataOut, -1, (size_t)vol*numThread);
+  hipCheck(hipDeviceSynchronize());
+
+  std::atomic<int> numExecFail(0);
+  std::atomic<int> numStaleExec(0);
+  std::atomic<bool> done(false);
+
+  std::thread churn([&]() {
+    hipCheck(hipSetDevice(deviceID));
+    std::vector<int> churnDim = {16, 8, 12};
+    std::vector<int> churnPermutation = {2, 0, 1};
+    while (!done.load()) {
+      cuttHandle plan;
+      cuttCheck(cuttPlan(&plan, churnDim.size(), churnDim.data(), churnPermutation.data(), sizeof(int), 0));
+      cuttCheck(cuttDestroy(plan));
+      if (cuttExecute(plan, dataIn, dataOut + (size_t)vol*numThread) != CUTT_INVALID_PLAN) numStaleExec++;
+    }
+  });
+
+  std::vector<std::thread> threads;
+  for (int i=0;i < numThread;i++) {
+    threads.push_back(std::thread([&, i]() {
+      hipCheck(hipSetDevice(deviceID));
+      for (int j=0;j < numExec;j++) {
+        if (cuttExecute(plans[i], dataIn, dataOut + (size_t)vol*i) != CUTT_SUCCESS) numExecFail++;
+      }
+      hipCheck(hipStreamSynchronize(streams[i]));
+    }));
+  }
+  for (int i=0;i < numThread;i++) threads[i].join();
+  done.store(true);
+  churn.join();
+
+  bool run_ok = (numExecFail.load() == 0 && numStaleExec.load() == 0);
+  if (!run_ok) {
+    printf("test6: %d executions failed, %d executions of destroyed plans succeeded\n",
+      numExecFail.load(), numStaleExec.load());
+  }
+  for (int i=0;i < numThread;i++) {
+    run_ok = run_ok && tester->checkTranspose(dim.size(), dim.data(), permutation.data(), dataOut + (size_t)vol*i);
+  }
+
+  for (int i=0;i < numThread;i++) {
+    cuttCheck(cuttDestroy(plans[i]));
+    hipCheck(hipStreamDestroy(streams[i]));
+  }
+
+  return run_ok;
+}
+
+//
+// Test 7: handles of destroyed plans. A new context is used so that the next plan reuses the
+//         slot of the destroyed one
+//
+bool test7() {
+
+  std::vector<int> dim = {24, 32, 16, 36};
+  std::vector<int> permutation = {3, 1, 0, 2};
+
+  cuttContext ctx;
+  cuttCheck(cuttCreateContext(&ctx, NULL));
+
+  cuttHandle plan;
+  cuttCheck(cuttPlanCtx(ctx, &plan, dim.size(), dim.data(), permutation.data(), sizeof(long long int), 0));
+  cuttCheck(cuttDestroyCtx(ctx, plan));
+
+  bool run_ok = true;
+  if (cuttExecuteCtx(ctx, plan, dataIn, dataOut) != CUTT_INVALID_PLAN ||
+    cuttDestroyCtx(ctx, plan) != CUTT_INVALID_PLAN) {
+    printf("test7: destroyed handle accepted\n");
+    run_ok = false;
+  }
+
+  // Same slot, next generation
+  cuttHandle newPlan;
+  cuttCheck(cuttPlanCtx(ctx, &newPlan, dim.size(), dim.data(), permutation.data(), sizeof(long long int), 0));
+  const cuttHandle indexMask = (1u << PLANSTORAGE_INDEX_BITS) - 1;
+  if ((newPlan & indexMask) != (plan & indexMask) || newPlan == plan) {
+    printf("test7: handle %x after destroying %x does not reuse its slot\n", newPlan, plan);
+    run_ok = false;
+  }
+  if (cuttExecuteCtx(ctx, plan, dataIn, dataOut) != CUTT_INVALID_PLAN ||
+    cuttDestroyCtx(ctx, plan) != CUTT_INVALID_PLAN) {
+    printf("test7: destroyed handle accepted after its slot was reused\n");
+    run_ok = false;
+  }
+  // Handles of slots that were never used
+  if (cuttExecuteCtx(ctx, newPlan + 1, dataIn, dataOut) != CUTT_INVALID_PLAN ||
+    cuttExecuteCtx(ctx, indexMask, dataIn, dataOut) != CUTT_INVALID_PLAN) {
+    printf("test7: unused handle accepted\n");
+    run_ok = false;
+  }
+
+  set_device_array<long long int>(dataOut, -1, 24*32*16*36);
+  hipCheck(hipDeviceSynchronize());
+  cuttCheck(cuttExecuteCtx(ctx, newPlan, dataIn, dataOut));
+  hipCheck(hipDeviceSynchronize());
+  run_ok = run_ok && tester->checkTranspose(dim.size(), dim.data(), permutation.data(), dataOut);
+
+  cuttCheck(cuttDestroyCtx(ctx, newPlan));
+  cuttCheck(cuttDestroyContext(ctx));
+
+  return run_ok;
+}
+
+//
+// Test 8: threads planning the same tensor at the same time share one planning run, but each
+//         gets its own plan. The planning thread waits until all others wait for it
+//
+const int test8NumThread = 8;
+
+// Holds the planning thread until the other threads have joined its request
+static void test8PlanningHook(cuttContext ctx, void* arg) {
+  bool* joined = (bool*)arg;
+  auto start = std::chrono::steady_clock::now();
+  while (cuttGetNumPlanFollower(ctx) < test8NumThread - 1) {
+    if (std::chrono::steady_clock::now() - start > std::chrono::seconds(30)) return;
+    std::this_thread::yield();
+  }
+  *joined = true;
+}
+
+bool test8() {
+
+  std::vector<int> dim = {31, 549, 2, 3};
+  std::vector<int> permutation = {3, 0, 2, 1};
+  const int vol = 31*549*2*3;
+
+  const int numThread = test8NumThread;
+
+  int deviceID;
+  hipCheck(hipGetDevice(&deviceID));
+
+  set_device_array<long long int>(dataOut, -1, (size_t)vol*numThread);
+  hipCheck(hipDeviceSynchronize());
+
+  cuttContext ctx;
+  cuttCheck(cuttCreateContext(&ctx, NULL));
+  bool joined = false;
+  cuttSetPlanningHook(ctx, test8PlanningHook, &joined);
+
+  cuttHandle plans[numThread];
+  cuttResult results[numThread];
+  std::vector<std::thread> threads;
+  for (int i=0;i < numThread;i++) {
+    threads.push_back(std::thread([&, i]() {
+      hipCheck(hipSetDevice(deviceID));
+      results[i] = cuttPlanCtx(ctx, &plans[i], dim.size(), dim.data(), permutation.data(),
+        sizeof(long long int), 0);
+      if (results[i] == CUTT_SUCCESS) {
+        results[i] = cuttExecuteCtx(ctx, plans[i], dataIn, dataOut + (size_t)vol*i);
+      }
+    }));
+  }
+  for (int i=0;i < numThread;i++) threads[i].join();
+  hipCheck(hipDeviceSynchronize());
+  cuttSetPlanningHook(ctx, NULL, NULL);
+
+  bool run_ok = true;
+  if (!joined) {
+    printf("test8: threads did not join the planning request\n");
+    run_ok = false;
+  }
+  if (cuttGetNumPlanningRun(ctx) != 1) {
+    printf("test8: %d planning runs for %d threads\n", cuttGetNumPlanningRun(ctx), numThread);
+    run_ok = false;
+  }
+  for (int i=0;i < numThread;i++) {
+    if (results[i] != CUTT_SUCCESS) {
+      printf("test8: thread %d failed with %d\n", i, results[i]);
+      return false;
+    }
+    for (int j=0;j < i;j++) {
+      if (plans[i] == plans[j]) {
+        printf("test8: threads %d and %d got the same handle %x\n", j, i, plans[i]);
+        run_ok = false;
+      }
+    }
+    run_ok = run_ok && tester->checkTranspose(dim.size(), dim.data(), permutation.data(), dataOut + (size_t)vol*i);
+  }
+
+  // Each plan is independent of the others
+  cuttCheck(cuttDestroyCtx(ctx, plans[0]));
+  set_device_array<long long int>(dataOut, -1, vol);
+  hipCheck(hipDeviceSynchronize());
+  cuttCheck(cuttExecuteCtx(ctx, plans[1], dataIn, dataOut));
+  hipCheck(hipDeviceSynchronize());
+  run_ok = run_ok && tester->checkTranspose(dim.size(), dim.data(), permutation.data(), dataOut);
+  for (int i=1;i < numThread;i++) cuttCheck(cuttDestroyCtx(ctx, plans[i]));
+  cuttCheck(cuttDestroyContext(ctx));
+
+  return run_ok;
+}
+
+//
+// Test 9: context with a plan limit. Plan calls fail at the limit and succeed again once a
+//         plan of the context is destroyed. Failed calls do not hold on to a plan of the limit
+//
+bool test9() {
+
+  std::vector<int> dim = {24, 32, 16, 36};
+  std::vector<int> permutation = {3, 1, 0, 2};
+  const int vol = 24*32*16*36;
+
+  int deviceID;
+  hipCheck(hipGetDevice(&deviceID));
+
+  cuttContextConfig config;
+  cuttGetDefaultContextConfig(&config);
+  config.maxNumPlan = -1;
+  cuttContext ctx;
+  if (cuttCreateContext(&ctx, &config) != CUTT_INVALID_PARAMETER) {
+    printf("test9: negative maxNumPlan accepted\n");
+    return false;
+  }
+  config.maxNumPlan = 2;
+  cuttCheck(cuttCreateContext(&ctx, &config));
+
+  bool run_ok = true;
+  cuttHandle plans[3];
+  cuttCheck(cuttPlanCtx(ctx, &plans[0], dim.size(), dim.data(), permutation.data(), sizeof(long long int), 0));
+  cuttCheck(cuttPlanCtx(ctx, &plans[1], dim.size(), dim.data(), permutation.data(), sizeof(int), 0));
+  for (int i=0;i < 3;i++) {
+    if (cuttPlanCtx(ctx, &plans[2], dim.size(), dim.data(), permutation.data(), sizeof(long long int), 0) != CUTT_LIMIT_EXCEEDED ||
+      cuttPlanMeasureCtx(ctx, &plans[2], dim.size(), dim.data(), permutation.data(), sizeof(long long int), 0,
+        dataIn, dataOut) != CUTT_LIMIT_EXCEEDED ||
+      cuttPlanCloneCtx(ctx, plans[0], deviceID, &plans[2]) != CUTT_LIMIT_EXCEEDED) {
+      printf("test9: plan limit not enforced\n");
+      run_ok = false;
+    }
+  }
+  // Invalid input fails before the limit is checked
+  if (cuttPlanCtx(ctx, &plans[2], dim.size(), dim.data(), permutation.data(), 3, 0) != CUTT_INVALID_PARAMETER) {
+    printf("test9: invalid sizeofType accepted\n");
+    run_ok = false;
+  }
+
+  // The default context has no limit
+  cuttHandle defaultPlan;
+  cuttCheck(cuttPlan(&defaultPlan, dim.size(), dim.data(), permutation.data(), sizeof(long long int), 0));
+  cuttCheck(cuttDestroy(defaultPlan));
+
+  // Destroying a plan makes room for exactly one more
+  cuttCheck(cuttDestroyCtx(ctx, plans[0]));
+  cuttCheck(cuttPlanCtx(ctx, &plans[2], dim.size(), dim.data(), permutation.data(), sizeof(long long int), 0));
+  cuttHandle extraPlan;
+  if (cuttPlanCtx(ctx, &extraPlan, dim.size(), dim.data(), permutation.data(), sizeof(long long int), 0) != CUTT_LIMIT_EXCEEDED) {
+    printf("test9: plan limit not enforced after destroy\n");
+    run_ok = false;
+  }
+
+  set_device_array<long long int>(dataOut, -1, vol*2);
+  hipCheck(hipDeviceSynchronize());
+  cuttCheck(cuttExecuteCtx(ctx, plans[1], dataIn, dataOut));
+  cuttCheck(cuttExecuteCtx(ctx, plans[2], dataIn, dataOut + vol));
+  hipCheck(hipDeviceSynchronize());
+  run_ok = run_ok && tester->checkTranspose(dim.size(), dim.data(), permutation.data(), (int *)dataOut);
+  run_ok = run_ok && tester->checkTranspose(dim.size(), dim.data(), permutation.data(), dataOut + vol);
+
+  // Plans left in the context are destroyed with it
+  cuttCheck(cuttDestroyContext(ctx));
+  if (cuttDestroyContext(NULL) != CUTT_INVALID_PARAMETER) {
+    printf("test9: NULL context accepted\n");
+    run_ok = false;
+  }
+
+  return run_ok;
+}
+
+//
+// Test 10: one plan executed on several streams with cuttExecuteAsync
+//
+bool test10() {
+
+  std::vector<int> dim = {24, 32, 16, 36, 43};
+  std::vector<int> permutation = {4, 1, 3, 0, 2};
+  const int vol = 24*32*16*36*43;
+
+  const int numStream = 4;
+
+  hipStream_t streams[numStream];
+  for (int i=0;i < numStream;i++) {
+    hipCheck(hipStreamCreate(&streams[i]));
+  }
+
+  cuttHandle plan;
+  cuttCheck(cuttPlan(&plan, dim.size(), dim.data(), permutation.data(), sizeof(long long int), 0));
+
+  set_device_array<long long int>(dataOut, -1, (size_t)vol*numStream);
+  hipCheck(hipDeviceSynchronize());
+
+  for (int i=0;i < numStream;i++) {
+    cuttCheck(cuttExecuteAsync(plan, dataIn, dataOut + (size_t)vol*i, streams[i]));
+  }
+  for (int i=0;i < numStream;i++) {
+    hipCheck(hipStreamSynchronize(streams[i]));
+  }
+
+  bool run_ok = true;
+  for (int i=0;i < numStream;i++) {
+    run_ok = run_ok && tester->checkTranspose(dim.size(), dim.data(), permutation.data(), dataOut + (size_t)vol*i);
+  }
+
+  if (cuttExecuteAsync(plan, dataIn, dataIn, streams[0]) != CUTT_INVALID_PARAMETER) {
+    printf("test10: in-place execution accepted\n");
+    run_ok = false;
+  }
+  cuttCheck(cuttDestroy(plan));
+  if (cuttExecuteAsync(plan, dataIn, dataOut, streams[0]) != CUTT_INVALID_PLAN) {
+    printf("test10: destroyed handle accepted\n");
+    run_ok = false;
+  }
+
+  for (int i=0;i < numStream;i++) {
+    hipCheck(hipStreamDestroy(streams[i]));
+  }
+
+  return run_ok;
+}
+
+//
+// Test 11: plan cloned to the same device and, if there is one, to another device
+//
+bool test11() {
+
+  std::vector<int> dim = {24, 32, 16, 36};
+  std::vector<int> permutation = {3, 1, 0, 2};
+  const int vol = 24*32*16*36;
+
+  int deviceID;
+  hipCheck(hipGetDevice(&deviceID));
+  int numDevice;
+  hipCheck(hipGetDeviceCount(&numDevice));
+
+  cuttHandle plan;
+  cuttCheck(cuttPlan(&plan, dim.size(), dim.data(), permutation.data(), sizeof(long long int), 0));
+
+  bool run_ok = true;
+  cuttHandle clone;
+  if (cuttPlanClone(plan, -1, &clone) != CUTT_INVALID_DEVICE ||
+    cuttPlanClone(plan, numDevice, &clone) != CUTT_INVALID_DEVICE) {
+    printf("test11: invalid target device accepted\n");
+    run_ok = false;
+  }
+
+  // Same device. The clone stays valid when the source plan is destroyed
+  cuttCheck(cuttPlanClone(plan, deviceID, &clone));
+  if (clone == plan) {
+    printf("test11: clone has the handle of its source\n");
+    run_ok = false;
+  }
+  cuttCheck(cuttDestroy(plan));
+  if (cuttPlanClone(plan, deviceID, &plan) != CUTT_INVALID_PLAN) {
+    printf("test11: clone of destroyed plan accepted\n");
+    run_ok = false;
+  }
+  set_device_array<long long int>(dataOut, -1, vol);
+  hipCheck(hipDeviceSynchronize());
+  cuttCheck(cuttExecute(clone, dataIn, dataOut));
+  hipCheck(hipDeviceSynchronize());
+  run_ok = run_ok && tester->checkTranspose(dim.size(), dim.data(), permutation.data(), dataOut);
+
+  if (numDevice > 1) {
+    // Another device, with its own data and tester
+    int otherDeviceID = (deviceID + 1) % numDevice;
+    cuttHandle otherClone;
+    cuttCheck(cuttPlanClone(clone, otherDeviceID, &otherClone));
+    if (cuttExecute(otherClone, dataIn, dataOut) != CUTT_INVALID_DEVICE) {
+      printf("test11: clone executed on the device of its source\n");
+      run_ok = false;
+    }
+
+    hipCheck(hipSetDevice(otherDeviceID));
+    long long int* otherDataIn = NULL;
+    long long int* otherDataOut = NULL;
+    allocate_device<long long int>(&otherDataIn, vol);
+    allocate_device<long long int>(&otherDataOut, vol);
+    TensorTester* otherTester = new TensorTester();
+    otherTester->setTensorCheckPattern((unsigned int *)otherDataIn, vol*2);
+    set_device_array<long long int>(otherDataOut, -1, vol);
+    hipCheck(hipDeviceSynchronize());
+
+    cuttCheck(cuttExecute(otherClone, otherDataIn, otherDataOut));
+    hipCheck(hipDeviceSynchronize());
+    run_ok = run_ok && otherTester->checkTranspose(dim.size(), dim.data(), permutation.data(), otherDataOut);
+
+    cuttCheck(cuttDestroy(otherClone));
+    delete otherTester;
+    deallocate_device<long long int>(&otherDataIn);
+    deallocate_device<long long int>(&otherDataOut);
+    hipCheck(hipSetDevice(deviceID));
+  } else {
+    printf("test11: only one device, clone to another device not tested\n");
+  }
+
+  cuttCheck(cuttDestroy(clone));
+
+  return run_ok;
+}
+
+//
+// Test 12: plans destroyed while their kernels are still running, followed right away by
+//          cuttDestroyContext() or cuttFinalize(), or after the stream they ran on was destroyed.
+//          Device buffers of the plans must stay alive until the kernels are done
+//
+bool test12() {
+
+  std::vector<int> dim = {24, 32, 16, 36, 43, 9};
+  std::vector<int> permutation = {5, 1, 4, 2, 3, 0};
+  const int vol = 24*32*16*36*43*9;
+  std::vector<int> smallDim = {24, 32, 16, 36, 43};
+  std::vector<int> smallPermutation = {4, 1, 3, 0, 2};
+  const int smallVol = 24*32*16*36*43;
+
+  hipStream_t streams[2];
+  for (int i=0;i < 2;i++) {
+    hipCheck(hipStreamCreate(&streams[i]));
+  }
+  bool run_ok = true;
+
+  // Context destroyed with the kernel in flight
+  {
+    cuttContext ctx;
+    cuttCheck(cuttCreateContext(&ctx, NULL));
+    cuttHandle plan;
+    cuttCheck(cuttPlanCtx(ctx, &plan, dim.size(), dim.data(), permutation.data(), sizeof(long long int), streams[0]));
+    set_device_array<long long int>(dataOut, -1, vol);
+    hipCheck(hipDeviceSynchronize());
+    cuttCheck(cuttExecuteCtx(ctx, plan, dataIn, dataOut));
+    cuttCheck(cuttDestroyCtx(ctx, plan));
+    cuttCheck(cuttDestroyContext(ctx));
+    hipCheck(hipStreamSynchronize(streams[0]));
+    run_ok = run_ok && tester->checkTranspose(dim.size(), dim.data(), permutation.data(), dataOut);
+  }
+
+  // cuttDestroy returns while the kernels of the plan are still running, also when it frees
+  // an earlier plan whose kernel is done
+  {
+    cuttHandle earlierPlan;
+    cuttCheck(cuttPlan(&earlierPlan, smallDim.size(), smallDim.data(), smallPermutation.data(), sizeof(long long int), streams[0]));
+    cuttHandle plan;
+    cuttCheck(cuttPlan(&plan, dim.size(), dim.data(), permutation.data(), sizeof(long long int), streams[0]));
+    cuttCheck(cuttExecute(earlierPlan, dataIn, dataOut));
+    cuttCheck(cuttDestroy(earlierPlan));
+    set_device_array<long long int>(dataOut, -1, vol);
+    hipCheck(hipDeviceSynchronize());
+    for (int i=0;i < 10;i++) {
+      cuttCheck(cuttExecute(plan, dataIn, dataOut));
+    }
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    cuttCheck(cuttDestroy(plan));
+    std::chrono::high_resolution_clock::time_point destroyEnd = std::chrono::high_resolution_clock::now();
+    hipCheck(hipStreamSynchronize(streams[0]));
+    std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+    double destroyTime = std::chrono::duration_cast< std::chrono::duration<double> >(destroyEnd - start).count();
+    double totalTime = std::chrono::duration_cast< std::chrono::duration<double> >(end - start).count();
+    // Kernels left running after cuttDestroy must take most of the time
+    if (totalTime > 1.0e-3 && destroyTime > 0.5*totalTime) {
+      printf("cuttDestroy waited for the kernels: %1.3lf ms of %1.3lf ms\n", destroyTime*1000.0, totalTime*1000.0);
+      run_ok = false;
+    }
+    run_ok = run_ok && tester->checkTranspose(dim.size(), dim.data(), permutation.data(), dataOut);
+  }
+
+  // Many plans, each destroyed right after its execution
+  {
+    set_device_array<long long int>(dataOut, -1, smallVol);
+    hipCheck(hipDeviceSynchronize());
+    for (int i=0;i < 40;i++) {
+      cuttHandle plan;
+      cuttCheck(cuttPlan(&plan, smallDim.size(), smallDim.data(), smallPermutation.data(), sizeof(long long int), streams[0]));
+      cuttCheck(cuttExecute(plan, dataIn, dataOut));
+      cuttCheck(cuttDestroy(plan));
+    }
+    hipCheck(hipStreamSynchronize(streams[0]));
+    run_ok = run_ok && tester->checkTranspose(smallDim.size(), smallDim.data(), smallPermutation.data(), dataOut);
+  }
+
+  // Plan executed on a stream that is destroyed before the plan
+  {
+    hipStream_t tmpStream;
+    hipCheck(hipStreamCreate(&tmpStream));
+    cuttHandle plan;
+    cuttCheck(cuttPlan(&plan, smallDim.size(), smallDim.data(), smallPermutation.data(), sizeof(long long int), 0));
+    set_device_array<long long int>(dataOut, -1, smallVol);
+    hipCheck(hipDeviceSynchronize());
+    cuttCheck(cuttExecuteAsync(plan, dataIn, dataOut, tmpStream));
+    hipCheck(hipStreamDestroy(tmpStream));
+    cuttCheck(cuttDestroy(plan));
+    hipCheck(hipDeviceSynchronize());
+    run_ok = run_ok && tester->checkTranspose(smallDim.size(), smallDim.data(), smallPermutation.data(), dataOut);
+  }
+
+  // Plan executed on two streams and finalized with both kernels in flight
+  {
+    cuttHandle plan;
+    cuttCheck(cuttPlan(&plan, smallDim.size(), smallDim.data(), smallPermutation.data(), sizeof(long long int), 0));
+    set_device_array<long long int>(dataOut, -1, (size_t)smallVol*2);
+    hipCheck(hipDeviceSynchronize());
+    for (int i=0;i < 2;i++) {
+      cuttCheck(cuttExecuteAsync(plan, dataIn, dataOut + (size_t)smallVol*i, streams[i]));
+    }
+    cuttCheck(cuttDestroy(plan));
+    cuttFinalize();
+    for (int i=0;i < 2;i++) {
+      hipCheck(hipStreamSynchronize(streams[i]));
+      run_ok = run_ok && tester->checkTranspose(smallDim.size(), smallDim.data(), smallPermutation.data(),
+        dataOut + (size_t)smallVol*i);
+    }
+  }
+
+  for (int i=0;i < 2;i++) {
+    hipCheck(hipStreamDestroy(streams[i]));
+  }
+
+  return run_ok;
+}
+
 template <typename T>
 bool test_tensor(std::vector<int>& dim, std::vector<int>& permutation) {
 
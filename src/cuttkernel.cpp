@@ -28,9 +28,17 @@ All rights reserved.
 #include <hip/hip_runtime.h>
 #include <hip/hip_fp16.h>
 #include "CudaUtils.h"
-#include "LRUCache.h"
+#include "cutt.h"
 #include "cuttkernel.h"
+#include "cuttOccupancy.h"
+#include "LRUCache.h"
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <map>
+#include <mutex>
+#include <vector>
 
 #define RESTRICT __restrict__
 
@@ -555,36 +563,86 @@ void cuttKernelSetSharedMemConfig() {
 
 }
 
-// Caches for PackedSplit kernels. One cache for all devices
-// NOTE: Not thread safe
-const int CACHE_SIZE = 100000;
-const int MAX_NUMWARP = (1024/64);
-const int MAX_NUMTYPE = 2;
-static int numDevices = -1;
-LRUCache<unsigned long long int, int> nabCache(CACHE_SIZE, -1);
+// Key of the kernel resource table. Resource usage depends only on the code object the
+// kernel was compiled to, so identical GPUs share entries
+struct KernelResourceKey {
+  // Device architecture, gcnArchName on AMD GPUs and sm_[major][minor] otherwise
+  std::string arch;
+  int method;
+  int sizeofType;
+  // 0 for kernels other than Packed and PackedSplit
+  int numRegStorage;
+
+  bool operator<(const KernelResourceKey& b) const {
+    if (arch != b.arch) return (arch < b.arch);
+    if (method != b.method) return (method < b.method);
+    if (sizeofType != b.sizeofType) return (sizeofType < b.sizeofType);
+    return (numRegStorage < b.numRegStorage);
+  }
+};
+
+// Resource usage of kernel instantiations, filled on first use, by cuttKernelResourcePrewarm()
+// or from a file written by cuttKernelResourceSave()
+static std::map< KernelResourceKey, KernelResource > kernelResourceTable;
+// Architecture of devices by device ID
+static std::map< int, std::string > deviceArchTable;
+// Guards kernelResourceTable and deviceArchTable
+static std::mutex kernelResourceTableMutex;
+
+// Resource usage by device ID, method, sizeofType and numRegStorage. Serves the lookups of the
+// planner without taking kernelResourceTableMutex. Entries evicted from here stay in the table
+const int KERNEL_RESOURCE_CACHE_SIZE = 4096;
+static KernelResource kernelResourceNull() {
+  KernelResource kr;
+  kr.numRegs = -1;
+  kr.sharedSizeBytes = 0;
+  kr.maxThreadsPerBlock = 0;
+  kr.localSizeBytes = 0;
+  return kr;
+}
+static LRUCache<unsigned long long int, KernelResource> kernelResourceCache(KERNEL_RESOURCE_CACHE_SIZE,
+  kernelResourceNull());
+
+#define CUTT_STRINGIZE(x) #x
+#define CUTT_XSTRINGIZE(x) CUTT_STRINGIZE(x)
+// Files of the kernel resource table are only valid for the library version and kernel set that
+// wrote them. On load, one entry is also checked against the code object on the current device
+static const char* kernelResourceBuild = "version " CUTT_XSTRINGIZE(CUTT_VERSION_MAJOR) "."
+  CUTT_XSTRINGIZE(CUTT_VERSION_MINOR) " MAX_REG_STORAGE=" CUTT_XSTRINGIZE(MAX_REG_STORAGE);
+
+// Returns architecture of deviceID. Caller holds kernelResourceTableMutex
+static const std::string& deviceArch(const int deviceID) {
+  std::map< int, std::string >::iterator it = deviceArchTable.find(deviceID);
+  if (it != deviceArchTable.end()) return it->second;
+  hipDeviceProp_t prop;
+  hipCheck(hipGetDeviceProperties(&prop, deviceID));
+  std::string arch(prop.gcnArchName);
+  if (arch.empty()) {
+    std::ostringstream sm;
+    sm << "sm_" << prop.major << prop.minor;
+    arch = sm.str();
+  }
+  return deviceArchTable.insert(std::pair< int, std::string >(deviceID, arch)).first->second;
+}
 
 //
-// Returns the maximum number of active blocks per SM
+// Queries resource usage of the kernel used by method, sizeofType and numRegStorage on the
+// current device. Returns false if there is no such kernel
 //
-int getNumActiveBlock(const int method, const int sizeofType, const LaunchConfig& lc,
-  const int deviceID, const hipDeviceProp_t& prop) {
+static bool queryKernelResource(const int method, const int sizeofType, const int numRegStorage,
+  KernelResource& kr) {
 
-  int numActiveBlock;
-  int numthread = lc.numthread.x * lc.numthread.y * lc.numthread.z;
-  switch(method) {
-    case Trivial:
-    {
-      // This value does not matter, but should be > 0
-      numActiveBlock = 1;
-    }
-    break;
+  if (sizeofType != 2 && sizeofType != 4 && sizeofType != 8) {
+    std::cerr << "cuttKernelResource: Unsupported size " << sizeofType << std::endl;
+    return false;
+  }
 
+  const void* func = NULL;
+  switch(method) {
     case Packed:
     {
-#define CALL0(TYPE, NREG) \
-  hipOccupancyMaxActiveBlocksPerMultiprocessor(&numActiveBlock, \
-    transposePacked<TYPE, NREG>, numthread, lc.shmemsize)
-      switch(lc.numRegStorage) {
+#define CALL0(TYPE, NREG) func = reinterpret_cast<const void*>(&transposePacked<TYPE, NREG>)
+      switch(numRegStorage) {
 #define CALL(ICASE) case ICASE: if (sizeofType == 2) CALL0(half,  ICASE); if (sizeofType == 4) CALL0(float,  ICASE); if (sizeofType == 8) CALL0(double, ICASE); break
 #include "calls.h"
       }
@@ -595,268 +653,210 @@ int getNumActiveBlock(const int method, const int sizeofType, const LaunchConfig
 
     case PackedSplit:
     {
-      // Allocate cache structure if needed
-      if (numDevices == -1) {
-        hipCheck(hipGetDeviceCount(&numDevices));
-      }
-      // Build unique key for cache
-      int key_warp = (numthread/prop.warpSize - 1);
-      if (key_warp >= MAX_NUMWARP) {
-        printf("getNumActiveBlock maximum number of warps exceeded\n");
-        exit(1);
-      }
-      int key_reg = (lc.numRegStorage - 1);
-      int key_type = sizeofType;
-      unsigned long long int key = 
-      (unsigned long long int)(lc.shmemsize/sizeofType)*MAX_NUMWARP*MAX_REG_STORAGE*MAX_NUMTYPE*numDevices + 
-      (unsigned long long int)deviceID*MAX_NUMWARP*MAX_REG_STORAGE*MAX_NUMTYPE +
-      (unsigned long long int)key_type*MAX_NUMWARP*MAX_REG_STORAGE + 
-      (unsigned long long int)key_reg*MAX_NUMWARP + 
-      (unsigned long long int)key_warp;
-
-      numActiveBlock = nabCache.get(key);
-      if (numActiveBlock == -1) {
-        // key not found in cache, determine value and add it to cache
-#define CALL0(TYPE, NREG) \
-  hipOccupancyMaxActiveBlocksPerMultiprocessor(&numActiveBlock, \
-    transposePackedSplit<TYPE, NREG>, numthread, lc.shmemsize)
-      switch(lc.numRegStorage) {
+#define CALL0(TYPE, NREG) func = reinterpret_cast<const void*>(&transposePackedSplit<TYPE, NREG>)
+      switch(numRegStorage) {
 #define CALL(ICASE) case ICASE: if (sizeofType == 2) CALL0(half,  ICASE); if (sizeofType == 4) CALL0(float,  ICASE); if (sizeofType == 8) CALL0(double, ICASE); break
 #include "calls.h"
       }
 #undef CALL
 #undef CALL0
-        nabCache.set(key, numActiveBlock);
-      }
     }
     break;
 
     case Tiled:
     {
-      if (sizeofType == 2) {
-        hipOccupancyMaxActiveBlocksPerMultiprocessor(&numActiveBlock,
-          transposeTiled<half>, numthread, lc.shmemsize);
-      } else if (sizeofType == 4) {
-        hipOccupancyMaxActiveBlocksPerMultiprocessor(&numActiveBlock,
-          transposeTiled<float>, numthread, lc.shmemsize);
-      } else if (sizeofType == 8) {
-        hipOccupancyMaxActiveBlocksPerMultiprocessor(&numActiveBlock,
-          transposeTiled<double>, numthread, lc.shmemsize);
-      } else {
-        std::cerr << "Error executing tiled plan. Unsupported size " << sizeofType << std::endl;
-      }
+      if (sizeofType == 2) func = reinterpret_cast<const void*>(&transposeTiled<half>);
+      if (sizeofType == 4) func = reinterpret_cast<const void*>(&transposeTiled<float>);
+      if (sizeofType == 8) func = reinterpret_cast<const void*>(&transposeTiled<double>);
     }
     break;
 
     case TiledCopy:
     {
-      if (sizeofType == 2) {
-        hipOccupancyMaxActiveBlocksPerMultiprocessor(&numActiveBlock,
-          transposeTiledCopy<half>, numthread, lc.shmemsize);
-      } else if (sizeofType == 4) {
-        hipOccupancyMaxActiveBlocksPerMultiprocessor(&numActiveBlock,
-          transposeTiledCopy<float>, numthread, lc.shmemsize);
-      } else if (sizeofType == 8) {
-        hipOccupancyMaxActiveBlocksPerMultiprocessor(&numActiveBlock,
-          transposeTiledCopy<double>, numthread, lc.shmemsize);
-      } else {
-        std::cerr << "Error executing tiled-copy plan. Unsupported size " << sizeofType << std::endl;
-      }
+      if (sizeofType == 2) func = reinterpret_cast<const void*>(&transposeTiledCopy<half>);
+      if (sizeofType == 4) func = reinterpret_cast<const void*>(&transposeTiledCopy<float>);
+      if (sizeofType == 8) func = reinterpret_cast<const void*>(&transposeTiledCopy<double>);
     }
     break;
   }
 
-  return numActiveBlock;
+  if (func == NULL) return false;
+
+  // Resource usage is read from the code object, the kernel is not launched
+  hipFuncAttributes attr;
+  hipCheck(hipFuncGetAttributes(&attr, func));
+  kr.numRegs = attr.numRegs;
+  kr.sharedSizeBytes = (int)attr.sharedSizeBytes;
+  kr.maxThreadsPerBlock = attr.maxThreadsPerBlock;
+  kr.localSizeBytes = (int)attr.localSizeBytes;
+  return true;
 }
 
 //
-// Sets up kernel launch configuration
-//
-// Returns the number of active blocks per SM that can be achieved on the Packed kernel
-// NOTE: Returns 0 when kernel execution is not possible
-//
-// Sets:
-// lc.numthread
-// lc.numblock
-// lc.shmemsize
-// lc.numRegStorage  (for Packed method)
+// Returns resource usage of the kernel used by method, sizeofType and numRegStorage
+// Returns false if there is no such kernel
 //
-int cuttKernelLaunchConfiguration(const int sizeofType, const TensorSplit& ts,
-  const int deviceID, const hipDeviceProp_t& prop, LaunchConfig& lc) {
-
-  // Return value of numActiveBlock
-  int numActiveBlockReturn = -1;
-
-  switch(ts.method) {
-    case Trivial:
-    {
-      // These values don't matter
-      lc.numthread.x = 1;
-      lc.numthread.y = 1;
-      lc.numthread.z = 1;
-      lc.numblock.x = 1;
-      lc.numblock.y = 1;
-      lc.numblock.z = 1;
-      lc.numblock.z = 1;
-      lc.numblock.z = 1;
-      lc.shmemsize = 0;
-      lc.numRegStorage = 0;
-    }
-    break;
-
-    case Packed:
-    {
-      // Amount of shared memory required
-      lc.shmemsize = ts.shmemAlloc(sizeofType); //ts.volMmk*sizeofType;
+bool cuttKernelResource(const int method, const int sizeofType, const int numRegStorage,
+  const int deviceID, KernelResource& kr) {
 
-      // Check that we're not using too much shared memory per block
-      if (lc.shmemsize > prop.sharedMemPerBlock) {
-        // printf("lc.shmemsize %d prop.sharedMemPerBlock %d\n", lc.shmemsize, prop.sharedMemPerBlock);
-        return 0;
-      }
+  KernelResourceKey key;
+  key.method = method;
+  key.sizeofType = sizeofType;
+  key.numRegStorage = (method == Packed || method == PackedSplit) ? numRegStorage : 0;
 
-      // Min and max number of threads we can use
-      int minNumthread = ((ts.volMmk - 1)/(prop.warpSize*MAX_REG_STORAGE) + 1)*prop.warpSize;
-      int maxNumthread = ((ts.volMmk - 1)/(prop.warpSize) + 1)*prop.warpSize;      
-      if (minNumthread > prop.maxThreadsPerBlock) return 0;
-      maxNumthread = min(prop.maxThreadsPerBlock, maxNumthread);
-      // printf("minNumthread %d maxNumthread %d\n", minNumthread, maxNumthread);
-
-      // Min and max number of register storage we can use
-      int minNumRegStorage = (ts.volMmk - 1)/maxNumthread + 1;
-      int maxNumRegStorage = (ts.volMmk - 1)/minNumthread + 1;
-      // printf("minNumRegStorage %d maxNumRegStorage %d\n", minNumRegStorage, maxNumRegStorage);
-
-      int bestVal = 0;
-      int bestNumRegStorage = 0;
-      int bestNumActiveBlock = 0;
-
-      lc.numthread.y = 1;
-      lc.numthread.z = 1;
-      lc.numblock.x = max(1, ts.volMbar);
-      lc.numblock.x = min(prop.multiProcessorCount*18, lc.numblock.x);
-      lc.numblock.y = 1;
-      lc.numblock.z = 1;
-
-      for (lc.numRegStorage=minNumRegStorage;lc.numRegStorage <= maxNumRegStorage;lc.numRegStorage++) {
-        lc.numthread.x = ((ts.volMmk - 1)/(prop.warpSize*lc.numRegStorage) + 1)*prop.warpSize;
-
-        int numActiveBlock = getNumActiveBlock(ts.method, sizeofType, lc, deviceID, prop);
-        // int val = numActiveBlock*lc.numthread.x;
-        int val = ts.volMmkUsed()*numActiveBlock;
-        if (val > bestVal) {
-          bestVal = val;
-          bestNumRegStorage = lc.numRegStorage;
-          bestNumActiveBlock = numActiveBlock;
-        }
-      }
+  unsigned long long int cacheKey = ((unsigned long long int)deviceID << 32) |
+    ((unsigned long long int)method << 24) | ((unsigned long long int)sizeofType << 16) |
+    (unsigned long long int)key.numRegStorage;
+  kr = kernelResourceCache.get(cacheKey);
+  if (kr.numRegs >= 0) return true;
 
-      if (bestNumRegStorage == 0) return 0;
-
-      lc.numRegStorage = bestNumRegStorage;
-      lc.numthread.x = ((ts.volMmk - 1)/(prop.warpSize*lc.numRegStorage) + 1)*prop.warpSize;
-      numActiveBlockReturn = bestNumActiveBlock;
+  {
+    std::lock_guard<std::mutex> lock(kernelResourceTableMutex);
+    key.arch = deviceArch(deviceID);
+    std::map< KernelResourceKey, KernelResource >::iterator it = kernelResourceTable.find(key);
+    if (it != kernelResourceTable.end()) {
+      kr = it->second;
+      kernelResourceCache.set(cacheKey, kr);
+      return true;
     }
-    break;
-
-    case PackedSplit:
-    {
-      // Amount of shared memory required
-      lc.shmemsize = ts.shmemAlloc(sizeofType);
-
-      // Check that we're not using too much shared memory per block
-      if (lc.shmemsize > prop.sharedMemPerBlock) {
-        // printf("lc.shmemsize %d prop.sharedMemPerBlock %d\n", lc.shmemsize, prop.sharedMemPerBlock);
-        return 0;
-      }
-
-      int volMmkWithSplit = (ts.splitDim/ts.numSplit + ((ts.splitDim % ts.numSplit) > 0))*ts.volMmkUnsplit;
-
-      // Min and max number of threads we can use
-      int minNumthread = ((volMmkWithSplit - 1)/(prop.warpSize*MAX_REG_STORAGE) + 1)*prop.warpSize;
-      int maxNumthread = ((volMmkWithSplit - 1)/(prop.warpSize) + 1)*prop.warpSize;      
-      if (minNumthread > prop.maxThreadsPerBlock) return 0;
-      maxNumthread = min(prop.maxThreadsPerBlock, maxNumthread);
-      // printf("minNumthread %d maxNumthread %d\n", minNumthread, maxNumthread);
-
-      // Min and max number of register storage we can use
-      int minNumRegStorage = (volMmkWithSplit - 1)/maxNumthread + 1;
-      int maxNumRegStorage = (volMmkWithSplit - 1)/minNumthread + 1;
-      // printf("minNumRegStorage %d maxNumRegStorage %d\n", minNumRegStorage, maxNumRegStorage);
-
-      int bestVal = 0;
-      int bestNumRegStorage = 0;
-      int bestNumActiveBlock = 0;
-
-      lc.numthread.y = 1;
-      lc.numthread.z = 1;
-      lc.numblock.x = ts.numSplit;
-      lc.numblock.y = max(1, min((prop.multiProcessorCount*18)/lc.numblock.x, ts.volMbar));
-      lc.numblock.z = 1;
-
-      for (lc.numRegStorage=minNumRegStorage;lc.numRegStorage <= maxNumRegStorage;lc.numRegStorage++) {
-        lc.numthread.x = ((volMmkWithSplit - 1)/(prop.warpSize*lc.numRegStorage) + 1)*prop.warpSize;
-
-        int numActiveBlock = getNumActiveBlock(ts.method, sizeofType, lc, deviceID, prop);
-        // int val = numActiveBlock*lc.numthread.x*lc.numRegStorage;
-        int val = ts.volMmkUsed()*numActiveBlock;
-        if (val > bestVal) {
-          bestVal = val;
-          bestNumRegStorage = lc.numRegStorage;
-          bestNumActiveBlock = numActiveBlock;
-        }
-      }
+  }
 
-      if (bestNumRegStorage == 0) return 0;
+  if (!queryKernelResource(method, sizeofType, numRegStorage, kr)) return false;
+  {
+    std::lock_guard<std::mutex> lock(kernelResourceTableMutex);
+    // Keep the entry of a thread that got here first, all threads then see the same values
+    kr = kernelResourceTable.insert(std::pair< KernelResourceKey, KernelResource >(key, kr)).first->second;
+  }
+  kernelResourceCache.set(cacheKey, kr);
+  return true;
+}
 
-      lc.numRegStorage = bestNumRegStorage;
-      lc.numthread.x = ((volMmkWithSplit - 1)/(prop.warpSize*lc.numRegStorage) + 1)*prop.warpSize;
-      numActiveBlockReturn = bestNumActiveBlock;
+//
+// Writes the kernel resource table to filename. The file is written next to filename and
+// renamed, so that processes reading it never see a partial table
+//
+bool cuttKernelResourceSave(const char* filename) {
+  std::string tmpname = std::string(filename) + ".tmp";
+  FILE* fp = fopen(tmpname.c_str(), "w");
+  if (fp == NULL) {
+    printf("cuttKernelResourceSave: Unable to open file %s\n", tmpname.c_str());
+    return false;
+  }
+  fprintf(fp, "build %s\n", kernelResourceBuild);
+  fprintf(fp, "# kernel arch method sizeofType numRegStorage numRegs sharedSizeBytes maxThreadsPerBlock localSizeBytes\n");
+  {
+    std::lock_guard<std::mutex> lock(kernelResourceTableMutex);
+    for (std::map< KernelResourceKey, KernelResource >::const_iterator it=kernelResourceTable.begin();
+      it != kernelResourceTable.end();it++) {
+      fprintf(fp, "kernel %s %d %d %d %d %d %d %d\n", it->first.arch.c_str(),
+        it->first.method, it->first.sizeofType, it->first.numRegStorage,
+        it->second.numRegs, it->second.sharedSizeBytes, it->second.maxThreadsPerBlock,
+        it->second.localSizeBytes);
     }
-    break;
+  }
+  bool ok = (fclose(fp) == 0);
+  if (!ok || rename(tmpname.c_str(), filename) != 0) {
+    printf("cuttKernelResourceSave: Unable to write file %s\n", filename);
+    remove(tmpname.c_str());
+    return false;
+  }
+  return true;
+}
 
-    case Tiled:
-    {
-      lc.numthread.x = TILEDIM;
-      lc.numthread.y = TILEROWS;
-      lc.numthread.z = 1;
-      lc.numblock.x = ((ts.volMm - 1)/TILEDIM + 1)*((ts.volMk - 1)/TILEDIM + 1);
-      lc.numblock.y = 1;
-      lc.numblock.z = max(1, min((prop.multiProcessorCount*8)/(lc.numblock.x*lc.numblock.y), ts.volMbar));
-      lc.shmemsize = 0;
-      lc.numRegStorage = 0;
+//
+// Adds the entries of a file written by cuttKernelResourceSave() to the kernel resource table.
+// Entries already in the table are kept. Fails if the file was written by a different library
+// version or kernel set, or if its entry for the first kernel of the current device architecture
+// differs from the kernel in this build
+//
+bool cuttKernelResourceLoad(const char* filename) {
+  std::ifstream file(filename);
+  if (!file.is_open()) {
+    printf("cuttKernelResourceLoad: Unable to open file %s\n", filename);
+    return false;
+  }
+  std::vector< std::pair< KernelResourceKey, KernelResource > > entries;
+  bool buildOk = false;
+  std::string line;
+  int lineNum = 0;
+  while (std::getline(file, line)) {
+    lineNum++;
+    if (line.empty() || line[0] == '#') continue;
+    std::istringstream in(line);
+    std::string key;
+    in >> key;
+    bool ok = true;
+    if (key == "build") {
+      std::string val;
+      std::getline(in >> std::ws, val);
+      buildOk = (val == kernelResourceBuild);
+      if (!buildOk) {
+        printf("cuttKernelResourceLoad: File %s was written by a different build\n", filename);
+        return false;
+      }
+    } else if (key == "kernel" && buildOk) {
+      std::pair< KernelResourceKey, KernelResource > e;
+      ok = (bool)(in >> e.first.arch >> e.first.method >> e.first.sizeofType >> e.first.numRegStorage
+        >> e.second.numRegs >> e.second.sharedSizeBytes >> e.second.maxThreadsPerBlock
+        >> e.second.localSizeBytes);
+      if (ok) entries.push_back(e);
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      printf("cuttKernelResourceLoad: Invalid line %d in file %s\n", lineNum, filename);
+      return false;
     }
-    break;
+  }
 
-    case TiledCopy:
-    {
-      lc.numthread.x = TILEDIM;
-      lc.numthread.y = TILEROWS;
-      lc.numthread.z = 1;
-      lc.numblock.x = ((ts.volMm - 1)/TILEDIM + 1)*((ts.volMkBar - 1)/TILEDIM + 1);
-      lc.numblock.y = 1;
-      lc.numblock.z = ts.volMbar;
-      lc.numblock.z = min((prop.multiProcessorCount*8)/(lc.numblock.x*lc.numblock.y), lc.numblock.z);
-      lc.numblock.z = max(1, lc.numblock.z);
-      lc.shmemsize = 0;
-      lc.numRegStorage = 0;
+  // Check the first entry of the current device architecture against its kernel, a file
+  // written for other kernels with the same version tag is rejected
+  int deviceID;
+  hipCheck(hipGetDevice(&deviceID));
+  std::string arch;
+  {
+    std::lock_guard<std::mutex> lock(kernelResourceTableMutex);
+    arch = deviceArch(deviceID);
+  }
+  for (int i=0;i < (int)entries.size();i++) {
+    if (entries[i].first.arch != arch) continue;
+    const KernelResourceKey& key = entries[i].first;
+    const KernelResource& kr = entries[i].second;
+    KernelResource krDevice;
+    if (!queryKernelResource(key.method, key.sizeofType, key.numRegStorage, krDevice) ||
+      krDevice.numRegs != kr.numRegs || krDevice.sharedSizeBytes != kr.sharedSizeBytes ||
+      krDevice.maxThreadsPerBlock != kr.maxThreadsPerBlock ||
+      krDevice.localSizeBytes != kr.localSizeBytes) {
+      printf("cuttKernelResourceLoad: File %s does not match the kernels of this build\n", filename);
+      return false;
     }
     break;
   }
 
-  if (lc.numblock.x > prop.maxGridSize[0] ||
-    lc.numblock.y > prop.maxGridSize[1] ||
-    lc.numblock.z > prop.maxGridSize[2]) return 0;
+  std::lock_guard<std::mutex> lock(kernelResourceTableMutex);
+  kernelResourceTable.insert(entries.begin(), entries.end());
+  return true;
+}
 
-  // Return the number of active blocks with these settings
-  if (numActiveBlockReturn == -1) {
-    // Not set, get it
-    numActiveBlockReturn = getNumActiveBlock(ts.method, sizeofType, lc, deviceID, prop);
+//
+// Fills the resource table for all kernel instantiations on device deviceID.
+// deviceID must be the current device of the calling thread
+//
+void cuttKernelResourcePrewarm(const int deviceID) {
+  const int sizeofTypes[3] = {2, 4, 8};
+  KernelResource kr;
+  for (int i=0;i < 3;i++) {
+    for (int numRegStorage=1;numRegStorage <= MAX_REG_STORAGE;numRegStorage++) {
+      if (!isRegStorageDepth(numRegStorage)) continue;
+      cuttKernelResource(Packed, sizeofTypes[i], numRegStorage, deviceID, kr);
+      cuttKernelResource(PackedSplit, sizeofTypes[i], numRegStorage, deviceID, kr);
+    }
+    cuttKernelResource(Tiled, sizeofTypes[i], 0, deviceID, kr);
+    cuttKernelResource(TiledCopy, sizeofTypes[i], 0, deviceID, kr);
   }
-  return numActiveBlockReturn;
 }
 
-bool cuttKernel(cuttPlan_t& plan, void* dataIn, void* dataOut) {
+bool cuttKernel(cuttPlan_t& plan, void* dataIn, void* dataOut, hipStream_t stream) {
 
   LaunchConfig& lc = plan.launchConfig;
   TensorSplit& ts = plan.tensorSplit;
@@ -868,7 +868,7 @@ bool cuttKernel(cuttPlan_t& plan, void* dataIn, void* dataOut) {
     case Trivial:
     {
       hipCheck(hipMemcpyAsync(dataOut, dataIn, ts.volMmk*ts.volMbar*plan.sizeofType,
-        hipMemcpyDefault, plan.stream));
+        hipMemcpyDefault, stream));
     }
     break;
 
@@ -876,7 +876,7 @@ bool cuttKernel(cuttPlan_t& plan, void* dataIn, void* dataOut) {
     {
       switch(lc.numRegStorage) {
 #define CALL0(TYPE, NREG) \
-    transposePacked<TYPE, NREG> <<< lc.numblock, lc.numthread, lc.shmemsize, plan.stream >>> \
+    transposePacked<TYPE, NREG> <<< lc.numblock, lc.numthread, lc.shmemsize, stream >>> \
       (ts.volMmk, ts.volMbar, ts.sizeMmk, ts.sizeMbar, \
       plan.Mmk, plan.Mbar, plan.Msh, (TYPE *)dataIn, (TYPE *)dataOut)
 #define CALL(ICASE) case ICASE: if (plan.sizeofType == 2) CALL0(half,  ICASE); if (plan.sizeofType == 4) CALL0(float,  ICASE); if (plan.sizeofType == 8) CALL0(double, ICASE); break
@@ -895,7 +895,7 @@ bool cuttKernel(cuttPlan_t& plan, void* dataIn, void* dataOut) {
     {
       switch(lc.numRegStorage) {
 #define CALL0(TYPE, NREG) \
-    transposePackedSplit<TYPE, NREG> <<< lc.numblock, lc.numthread, lc.shmemsize, plan.stream >>> \
+    transposePackedSplit<TYPE, NREG> <<< lc.numblock, lc.numthread, lc.shmemsize, stream >>> \
       (ts.splitDim, ts.volMmkUnsplit, ts. volMbar, ts.sizeMmk, ts.sizeMbar, \
         plan.cuDimMm, plan.cuDimMk, plan.Mmk, plan.Mbar, plan.Msh, (TYPE *)dataIn, (TYPE *)dataOut)
 #define CALL(ICASE) case ICASE: if (plan.sizeofType == 2) CALL0(half,  ICASE); if (plan.sizeofType == 4) CALL0(float,  ICASE); if (plan.sizeofType == 8) CALL0(double, ICASE); break
@@ -913,7 +913,7 @@ bool cuttKernel(cuttPlan_t& plan, void* dataIn, void* dataOut) {
     case Tiled:
     {
 #define CALL(TYPE) \
-       transposeTiled<TYPE> <<< lc.numblock, lc.numthread, 0, plan.stream >>> \
+       transposeTiled<TYPE> <<< lc.numblock, lc.numthread, 0, stream >>> \
        (((ts.volMm - 1)/TILEDIM + 1), ts.volMbar, ts.sizeMbar, plan.tiledVol, plan.cuDimMk, plan.cuDimMm, \
          plan.Mbar, (TYPE *)dataIn, (TYPE *)dataOut)
       if (plan.sizeofType == 2) CALL(half);
@@ -926,7 +926,7 @@ bool cuttKernel(cuttPlan_t& plan, void* dataIn, void* dataOut) {
     case TiledCopy:
     {
 #define CALL(TYPE) \
-      transposeTiledCopy<TYPE> <<< lc.numblock, lc.numthread, 0, plan.stream >>> \
+      transposeTiledCopy<TYPE> <<< lc.numblock, lc.numthread, 0, stream >>> \
       (((ts.volMm - 1)/TILEDIM + 1), ts.volMbar, ts.sizeMbar, plan.cuDimMk, plan.cuDimMm, plan.tiledVol, \
         plan.Mbar, (TYPE *)dataIn, (TYPE *)dataOut)
       if (plan.sizeofType == 2) CALL(half);
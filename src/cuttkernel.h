@@ -25,12 +25,31 @@ SOFTWARE.
 #ifndef CUTTKERNEL_H
 #define CUTTKERNEL_H
 #include "cuttplan.h"
+#include "cuttOccupancy.h"
 
 void cuttKernelSetSharedMemConfig();
 
+// Resource usage of the kernel used by method, sizeofType and numRegStorage.
+// Planner-only builds take it from the device profile of the calling thread
+bool cuttKernelResource(const int method, const int sizeofType, const int numRegStorage,
+  const int deviceID, KernelResource& kr);
+
+// Queries resource usage of all kernel instantiations on the current device deviceID
+void cuttKernelResourcePrewarm(const int deviceID);
+
+// Saves and loads the kernel resource table. Entries are keyed by device architecture, so a
+// file can be shared by all hosts with the same GPUs that run the same library version
+bool cuttKernelResourceSave(const char* filename);
+bool cuttKernelResourceLoad(const char* filename);
+
 int cuttKernelLaunchConfiguration(const int sizeofType, const TensorSplit& ts,
              const int deviceID, const hipDeviceProp_t& prop, LaunchConfig& lc);
 
-bool cuttKernel(cuttPlan_t& plan, void* dataIn, void* dataOut);
+void cuttKernelLaunchConfigurationsPacked(const int sizeofType, const TensorSplit& ts,
+  const int deviceID, const hipDeviceProp_t& prop, const LaunchConfig& lc,
+  std::vector<LaunchConfig>& lcs, std::vector<int>& numActiveBlock);
+
+// Launches the transpose of plan on stream. The plan may be used on any stream
+bool cuttKernel(cuttPlan_t& plan, void* dataIn, void* dataOut, hipStream_t stream);
 
 #endif // CUTTKERNEL_H
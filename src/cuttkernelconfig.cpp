@@ -0,0 +1,291 @@
+/******************************************************************************
+MIT License
+
+Copyright (c) 2016 Antti-Pekka Hynninen
+Copyright (c) 2016 Oak Ridge National Laboratory (UT-Batelle)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+#include <algorithm>
+#include "cuttkernel.h"
+#include "cuttOccupancy.h"
+
+//
+// Returns the maximum number of active blocks per SM
+//
+int getNumActiveBlock(const int method, const int sizeofType, const LaunchConfig& lc,
+  const int deviceID, const hipDeviceProp_t& prop) {
+
+  // This value does not matter, but should be > 0
+  if (method == Trivial) return 1;
+
+  KernelResource kr;
+  if (!cuttKernelResource(method, sizeofType, lc.numRegStorage, deviceID, kr)) return 0;
+
+  int numthread = lc.numthread.x * lc.numthread.y * lc.numthread.z;
+  return occupancyNumActiveBlock(prop, kr, numthread, lc.shmemsize);
+}
+
+//
+// Returns the range of register storage depths the Packed kernels can use for volMmk elements
+// per block. Returns false if the block does not fit on the device
+//
+bool packedNumRegStorageRange(const int volMmk, const hipDeviceProp_t& prop,
+  int& minNumRegStorage, int& maxNumRegStorage) {
+
+  // Min and max number of threads we can use
+  int minNumthread = ((volMmk - 1)/(prop.warpSize*MAX_REG_STORAGE) + 1)*prop.warpSize;
+  int maxNumthread = ((volMmk - 1)/(prop.warpSize) + 1)*prop.warpSize;
+  if (minNumthread > prop.maxThreadsPerBlock) return false;
+  maxNumthread = std::min(prop.maxThreadsPerBlock, maxNumthread);
+  // printf("minNumthread %d maxNumthread %d\n", minNumthread, maxNumthread);
+
+  // Min and max number of register storage we can use
+  minNumRegStorage = (volMmk - 1)/maxNumthread + 1;
+  maxNumRegStorage = (volMmk - 1)/minNumthread + 1;
+  // printf("minNumRegStorage %d maxNumRegStorage %d\n", minNumRegStorage, maxNumRegStorage);
+  // Deep storages are instantiated in steps, round up to the next one
+  while (maxNumRegStorage < MAX_REG_STORAGE && !isRegStorageDepth(maxNumRegStorage)) maxNumRegStorage++;
+  return isRegStorageDepth(maxNumRegStorage);
+}
+
+//
+// Returns the number of elements per block of the Packed and PackedSplit kernels
+//
+int packedVolMmk(const TensorSplit& ts) {
+  if (ts.method == PackedSplit) {
+    return (ts.splitDim/ts.numSplit + ((ts.splitDim % ts.numSplit) > 0))*ts.volMmkUnsplit;
+  }
+  return ts.volMmk;
+}
+
+//
+// Sets up kernel launch configuration
+//
+// Returns the number of active blocks per SM that can be achieved on the Packed kernel
+// NOTE: Returns 0 when kernel execution is not possible
+//
+// Sets:
+// lc.numthread
+// lc.numblock
+// lc.shmemsize
+// lc.numRegStorage  (for Packed method)
+//
+// The grid size and register storage set here are starting points, the planner searches them
+// with the cost model (see cuttPlan_t::searchLaunchConfigs)
+//
+int cuttKernelLaunchConfiguration(const int sizeofType, const TensorSplit& ts,
+  const int deviceID, const hipDeviceProp_t& prop, LaunchConfig& lc) {
+
+  // Return value of numActiveBlock
+  int numActiveBlockReturn = -1;
+
+  switch(ts.method) {
+    case Trivial:
+    {
+      // These values don't matter
+      lc.numthread.x = 1;
+      lc.numthread.y = 1;
+      lc.numthread.z = 1;
+      lc.numblock.x = 1;
+      lc.numblock.y = 1;
+      lc.numblock.z = 1;
+      lc.numblock.z = 1;
+      lc.numblock.z = 1;
+      lc.shmemsize = 0;
+      lc.numRegStorage = 0;
+    }
+    break;
+
+    case Packed:
+    {
+      // Amount of shared memory required
+      lc.shmemsize = ts.shmemAlloc(sizeofType); //ts.volMmk*sizeofType;
+
+      // Check that we're not using too much shared memory per block
+      if (lc.shmemsize > prop.sharedMemPerBlock) {
+        // printf("lc.shmemsize %d prop.sharedMemPerBlock %d\n", lc.shmemsize, prop.sharedMemPerBlock);
+        return 0;
+      }
+
+      // Min and max number of register storage we can use
+      int minNumRegStorage, maxNumRegStorage;
+      if (!packedNumRegStorageRange(ts.volMmk, prop, minNumRegStorage, maxNumRegStorage)) return 0;
+
+      int bestVal = 0;
+      int bestNumRegStorage = 0;
+      int bestNumActiveBlock = 0;
+
+      lc.numthread.y = 1;
+      lc.numthread.z = 1;
+      lc.numblock.x = std::max(1, ts.volMbar);
+      lc.numblock.x = std::min(prop.multiProcessorCount*18, (int)lc.numblock.x);
+      lc.numblock.y = 1;
+      lc.numblock.z = 1;
+
+      // Occupancy above the number of blocks per SM does not help. For tensors with few
+      // blocks the ties go to the smallest register storage, i.e. the shortest blocks
+      int maxBlockPerSM = (lc.numblock.x - 1)/prop.multiProcessorCount + 1;
+
+      for (lc.numRegStorage=minNumRegStorage;lc.numRegStorage <= maxNumRegStorage;lc.numRegStorage++) {
+        if (!isRegStorageDepth(lc.numRegStorage)) continue;
+        lc.numthread.x = ((ts.volMmk - 1)/(prop.warpSize*lc.numRegStorage) + 1)*prop.warpSize;
+
+        int numActiveBlock = getNumActiveBlock(ts.method, sizeofType, lc, deviceID, prop);
+        // int val = numActiveBlock*lc.numthread.x;
+        int val = ts.volMmkUsed()*std::min(numActiveBlock, maxBlockPerSM);
+        if (val > bestVal) {
+          bestVal = val;
+          bestNumRegStorage = lc.numRegStorage;
+          bestNumActiveBlock = numActiveBlock;
+        }
+      }
+
+      if (bestNumRegStorage == 0) return 0;
+
+      lc.numRegStorage = bestNumRegStorage;
+      lc.numthread.x = ((ts.volMmk - 1)/(prop.warpSize*lc.numRegStorage) + 1)*prop.warpSize;
+      numActiveBlockReturn = bestNumActiveBlock;
+    }
+    break;
+
+    case PackedSplit:
+    {
+      // Amount of shared memory required
+      lc.shmemsize = ts.shmemAlloc(sizeofType);
+
+      // Check that we're not using too much shared memory per block
+      if (lc.shmemsize > prop.sharedMemPerBlock) {
+        // printf("lc.shmemsize %d prop.sharedMemPerBlock %d\n", lc.shmemsize, prop.sharedMemPerBlock);
+        return 0;
+      }
+
+      int volMmkWithSplit = packedVolMmk(ts);
+
+      // Min and max number of register storage we can use
+      int minNumRegStorage, maxNumRegStorage;
+      if (!packedNumRegStorageRange(volMmkWithSplit, prop, minNumRegStorage, maxNumRegStorage)) return 0;
+
+      int bestVal = 0;
+      int bestNumRegStorage = 0;
+      int bestNumActiveBlock = 0;
+
+      lc.numthread.y = 1;
+      lc.numthread.z = 1;
+      lc.numblock.x = ts.numSplit;
+      lc.numblock.y = std::max(1, std::min((prop.multiProcessorCount*18)/(int)lc.numblock.x, ts.volMbar));
+      lc.numblock.z = 1;
+
+      // Occupancy above the number of blocks per SM does not help
+      int maxBlockPerSM = (lc.numblock.x*lc.numblock.y - 1)/prop.multiProcessorCount + 1;
+
+      for (lc.numRegStorage=minNumRegStorage;lc.numRegStorage <= maxNumRegStorage;lc.numRegStorage++) {
+        if (!isRegStorageDepth(lc.numRegStorage)) continue;
+        lc.numthread.x = ((volMmkWithSplit - 1)/(prop.warpSize*lc.numRegStorage) + 1)*prop.warpSize;
+
+        int numActiveBlock = getNumActiveBlock(ts.method, sizeofType, lc, deviceID, prop);
+        // int val = numActiveBlock*lc.numthread.x*lc.numRegStorage;
+        int val = ts.volMmkUsed()*std::min(numActiveBlock, maxBlockPerSM);
+        if (val > bestVal) {
+          bestVal = val;
+          bestNumRegStorage = lc.numRegStorage;
+          bestNumActiveBlock = numActiveBlock;
+        }
+      }
+
+      if (bestNumRegStorage == 0) return 0;
+
+      lc.numRegStorage = bestNumRegStorage;
+      lc.numthread.x = ((volMmkWithSplit - 1)/(prop.warpSize*lc.numRegStorage) + 1)*prop.warpSize;
+      numActiveBlockReturn = bestNumActiveBlock;
+    }
+    break;
+
+    case Tiled:
+    {
+      lc.numthread.x = TILEDIM;
+      lc.numthread.y = TILEROWS;
+      lc.numthread.z = 1;
+      lc.numblock.x = ((ts.volMm - 1)/TILEDIM + 1)*((ts.volMk - 1)/TILEDIM + 1);
+      lc.numblock.y = 1;
+      lc.numblock.z = std::max(1, std::min((prop.multiProcessorCount*8)/(int)(lc.numblock.x*lc.numblock.y), ts.volMbar));
+      lc.shmemsize = 0;
+      lc.numRegStorage = 0;
+    }
+    break;
+
+    case TiledCopy:
+    {
+      lc.numthread.x = TILEDIM;
+      lc.numthread.y = TILEROWS;
+      lc.numthread.z = 1;
+      lc.numblock.x = ((ts.volMm - 1)/TILEDIM + 1)*((ts.volMkBar - 1)/TILEDIM + 1);
+      lc.numblock.y = 1;
+      lc.numblock.z = ts.volMbar;
+      lc.numblock.z = std::min((prop.multiProcessorCount*8)/(int)(lc.numblock.x*lc.numblock.y), (int)lc.numblock.z);
+      lc.numblock.z = std::max(1, (int)lc.numblock.z);
+      lc.shmemsize = 0;
+      lc.numRegStorage = 0;
+    }
+    break;
+  }
+
+  if (lc.numblock.x > (unsigned int)prop.maxGridSize[0] ||
+    lc.numblock.y > (unsigned int)prop.maxGridSize[1] ||
+    lc.numblock.z > (unsigned int)prop.maxGridSize[2]) return 0;
+
+  // Return the number of active blocks with these settings
+  if (numActiveBlockReturn == -1) {
+    // Not set, get it
+    numActiveBlockReturn = getNumActiveBlock(ts.method, sizeofType, lc, deviceID, prop);
+  }
+  return numActiveBlockReturn;
+}
+
+//
+// Returns alternative launch configurations of a Packed or PackedSplit plan with launch
+// configuration lc, one per distinct number of threads, for the cost model to choose from.
+// The grid is kept. numActiveBlock[i] is the number of active blocks per SM of lcs[i]
+//
+void cuttKernelLaunchConfigurationsPacked(const int sizeofType, const TensorSplit& ts,
+  const int deviceID, const hipDeviceProp_t& prop, const LaunchConfig& lc,
+  std::vector<LaunchConfig>& lcs, std::vector<int>& numActiveBlock) {
+
+  lcs.clear();
+  numActiveBlock.clear();
+  if (ts.method != Packed && ts.method != PackedSplit) return;
+
+  int volMmk = packedVolMmk(ts);
+  int minNumRegStorage, maxNumRegStorage;
+  if (!packedNumRegStorageRange(volMmk, prop, minNumRegStorage, maxNumRegStorage)) return;
+
+  LaunchConfig lcAlt = lc;
+  unsigned int prevNumthread = 0;
+  for (lcAlt.numRegStorage=minNumRegStorage;lcAlt.numRegStorage <= maxNumRegStorage;lcAlt.numRegStorage++) {
+    if (!isRegStorageDepth(lcAlt.numRegStorage)) continue;
+    lcAlt.numthread.x = ((volMmk - 1)/(prop.warpSize*lcAlt.numRegStorage) + 1)*prop.warpSize;
+    // Deeper storage with the same number of threads only adds idle registers
+    if (lcAlt.numthread.x == prevNumthread) continue;
+    prevNumthread = lcAlt.numthread.x;
+    int nab = getNumActiveBlock(ts.method, sizeofType, lcAlt, deviceID, prop);
+    if (nab == 0) continue;
+    lcs.push_back(lcAlt);
+    numActiveBlock.push_back(nab);
+  }
+}
@@ -26,9 +26,13 @@ SOFTWARE.
 #include <queue>
 #include <unordered_set>
 #include <cmath>
-#include <random>
+#include <cstdio>
+#ifndef CUTT_PLANNER_ONLY
+#include <map>
+#include <mutex>
 #include "CudaUtils.h"
 #include "CudaMem.h"
+#endif
 #include "cuttplan.h"
 #include "cuttkernel.h"
 #include "cuttGpuModel.h"
@@ -803,6 +807,25 @@ void printMatlab(hipDeviceProp_t& prop, std::list<cuttPlan_t>& plans, std::vecto
   }
 }
 
+//
+// Prints measured times of all candidate plans in the format read by cutt_model_eval:
+// MODELEVAL case rank sizeofType dim[0] ... dim[rank-1] permutation[0] ... permutation[rank-1]
+// MODELEVAL plan planRank method sizeMm sizeMk splitRank numSplit numRegStorage time
+//
+void printModelEval(const int rank, const int* dim, const int* permutation, const size_t sizeofType,
+  std::list<cuttPlan_t>& plans, std::vector<double>& times) {
+  printf("MODELEVAL case %d %d", rank, (int)sizeofType);
+  for (int i=0;i < rank;i++) printf(" %d", dim[i]);
+  for (int i=0;i < rank;i++) printf(" %d", permutation[i]);
+  printf("\n");
+  int i = 0;
+  for (auto it=plans.begin();it != plans.end();it++,i++) {
+    const TensorSplit& ts = it->tensorSplit;
+    printf("MODELEVAL plan %d %d %d %d %d %d %d %e\n", it->rank, ts.method,
+      ts.sizeMm, ts.sizeMk, ts.splitRank, ts.numSplit, it->launchConfig.numRegStorage, times[i]);
+  }
+}
+
 void LaunchConfig::print() {
   printf("numthread %d %d %d numblock %d %d %d shmemsize %d numRegStorage %d\n",
     numthread.x, numthread.y, numthread.z,
@@ -819,7 +842,8 @@ void cuttPlan_t::print() {
   printf("\n");
   tensorSplit.print();
   launchConfig.print();
-  printf("numActiveBlock %d cycles %e\n", numActiveBlock, cycles);
+  printf("numActiveBlock %d cycles %e numPosMbar %d tranErr %f l2HitRate %f spillBytes %d\n", numActiveBlock, cycles,
+    numPosMbar, tranErr, l2HitRate, spillBytes);
 }
 
 
@@ -924,6 +948,9 @@ bool cuttPlan_t::setup(const int rank_in, const int* dim, const int* permutation
 
     delete [] MbarI;
     delete [] MbarO;
+
+    hostMbarFast.resize(tensorSplit.sizeMbar);
+    makeFastConv(hostMbar.data(), tensorSplit.sizeMbar, hostMbarFast.data());
   }
 
   gld_req = 1;
@@ -1062,9 +1089,13 @@ bool cuttPlan_t::setup(const int rank_in, const int* dim, const int* permutation
 // #define COUNTCYCLE_CHECK
 
 //
-// Count the number of cycles using the MWP-CWP model
+// Count the number of cycles using the MWP-CWP model.
+// Model sub-results are shared through memo, if given
 //
-bool cuttPlan_t::countCycles(hipDeviceProp_t& prop, const int numPosMbarSample) {
+bool cuttPlan_t::countCycles(hipDeviceProp_t& prop, const int numPosMbarSample, ModelMemo* memo) {
+
+  ModelMemo localMemo;
+  if (memo == NULL) memo = &localMemo;
 
   // Number of elements that are loaded per memory transaction:
   // 128 bytes per transaction
@@ -1072,14 +1103,21 @@ bool cuttPlan_t::countCycles(hipDeviceProp_t& prop, const int numPosMbarSample)
   // L2 cache line width is 32 bytes
   const int cacheWidth = 64/sizeofType;
 
+  l2HitRate = DEFAULT_L2_HITRATE;
+
   if (tensorSplit.method == Tiled) {
     // Global memory
 #ifdef ENABLE_NVTOOLS
     gpuRangeStart("countTiledGlTransactions");
 #endif
-    countTiledGlTransactions(false, numPosMbarSample, tensorSplit.volMm, tensorSplit.volMk, tensorSplit.volMbar,
-      cuDimMk, cuDimMm, accWidth, cacheWidth, hostMbar, tensorSplit.sizeMbar,
-      num_iter, mlp, gld_tran, gst_tran, gld_req, gst_req, cl_full_l2, cl_part_l2);
+    memo->countTiledGlTransactions(false, numPosMbarSample, tensorSplit.volMm, tensorSplit.volMk, tensorSplit.volMbar,
+      cuDimMk, cuDimMm, prop.warpSize, accWidth, cacheWidth, hostMbar, tensorSplit.sizeMbar,
+      num_iter, mlp, gld_tran, gst_tran, gld_req, gst_req, cl_full_l2, cl_part_l2,
+      numPosMbar, tranErr);
+#ifdef ENABLE_CACHE_SIM
+    l2HitRate = simulateL2Tiled(prop, sizeofType, false, tensorSplit.volMm, tensorSplit.volMk, tensorSplit.volMbar,
+      cuDimMk, cuDimMm, hostMbar, tensorSplit.sizeMbar);
+#endif
 #ifdef ENABLE_NVTOOLS
     gpuRangeStop();
 #endif
@@ -1093,9 +1131,14 @@ bool cuttPlan_t::countCycles(hipDeviceProp_t& prop, const int numPosMbarSample)
 #ifdef ENABLE_NVTOOLS
     gpuRangeStart("countTiledGlTransactions (copy)");
 #endif
-    countTiledGlTransactions(true, numPosMbarSample, tensorSplit.volMm, tensorSplit.volMkBar, tensorSplit.volMbar,
-      cuDimMk, cuDimMm, accWidth, cacheWidth, hostMbar, tensorSplit.sizeMbar,
-      num_iter, mlp, gld_tran, gst_tran, gld_req, gst_req, cl_full_l2, cl_part_l2);
+    memo->countTiledGlTransactions(true, numPosMbarSample, tensorSplit.volMm, tensorSplit.volMkBar, tensorSplit.volMbar,
+      cuDimMk, cuDimMm, prop.warpSize, accWidth, cacheWidth, hostMbar, tensorSplit.sizeMbar,
+      num_iter, mlp, gld_tran, gst_tran, gld_req, gst_req, cl_full_l2, cl_part_l2,
+      numPosMbar, tranErr);
+#ifdef ENABLE_CACHE_SIM
+    l2HitRate = simulateL2Tiled(prop, sizeofType, true, tensorSplit.volMm, tensorSplit.volMkBar, tensorSplit.volMbar,
+      cuDimMk, cuDimMm, hostMbar, tensorSplit.sizeMbar);
+#endif
 #ifdef ENABLE_NVTOOLS
     gpuRangeStop();
 #endif
@@ -1128,16 +1171,15 @@ bool cuttPlan_t::countCycles(hipDeviceProp_t& prop, const int numPosMbarSample)
     cl_part_l2 = 0;
     cl_full_l1 = 0;
     cl_part_l1 = 0;
-    // Random number generator
-    std::default_random_engine generator;
-    std::uniform_int_distribution<int> distribution(0, tensorSplit.volMbar*tensorSplit.numSplit - 1);
+    // Mbar positions (including the split index) are sampled in blocks
+    MbarSampler sampler(tensorSplit.volMbar*tensorSplit.numSplit, numPosMbarSample);
     // Pre-compute posMmkIn and posMmkOut
-    std::vector<int> posMmkIn0(volMmk0);
-    std::vector<int> posMmkOut0(volMmk0);
+    const int* posMmkIn0;
+    const int* posMmkOut0;
 #ifdef ENABLE_NVTOOLS
     gpuRangeStart("computePos");
 #endif
-    computePos0(volMmk0, hostMmk.data(), tensorSplit.sizeMmk, posMmkIn0.data(), posMmkOut0.data());
+    memo->posMmk(volMmk0, hostMmk.data(), tensorSplit.sizeMmk, posMmkIn0, posMmkOut0);
     // computePos(0, volMmk0 - 1, hostMmkFast.data(), tensorSplit.sizeMmk, posMmkIn0.data(), posMmkOut0.data());
 #ifdef COUNTCYCLE_CHECK
     std::vector<int> posMmkIn0Ref(volMmk0);
@@ -1159,13 +1201,13 @@ bool cuttPlan_t::countCycles(hipDeviceProp_t& prop, const int numPosMbarSample)
 #ifdef ENABLE_NVTOOLS
     gpuRangeStop();
 #endif
-    std::vector<int> posMmkIn1(volMmk1);
-    std::vector<int> posMmkOut1(volMmk1);
+    const int* posMmkIn1 = NULL;
+    const int* posMmkOut1 = NULL;
     if (num1 > 0) {
 #ifdef ENABLE_NVTOOLS
       gpuRangeStart("computePos");
 #endif
-      computePos0(volMmk1, hostMmk.data() + tensorSplit.sizeMmk, tensorSplit.sizeMmk, posMmkIn1.data(), posMmkOut1.data());
+      memo->posMmk(volMmk1, hostMmk.data() + tensorSplit.sizeMmk, tensorSplit.sizeMmk, posMmkIn1, posMmkOut1);
       // computePos(0, volMmk1 - 1, hostMmkFast.data() + tensorSplit.sizeMmk, tensorSplit.sizeMmk,
       //   posMmkIn1.data(), posMmkOut1.data());
 #ifdef COUNTCYCLE_CHECK
@@ -1190,165 +1232,189 @@ bool cuttPlan_t::countCycles(hipDeviceProp_t& prop, const int numPosMbarSample)
 #endif
     }
 
-    int num_ipos = (numPosMbarSample == 0) ? tensorSplit.volMbar*tensorSplit.numSplit : numPosMbarSample;
-
 #ifdef ENABLE_NVTOOLS
     gpuRangeStop();
     gpuRangeStart("PackedSplit: loop");
 #endif
 
-    std::vector<int> posTmp(num_ipos);
-    int numRoundUp = 0;
-    for (int ipos=0;ipos < num_ipos;ipos++) {
-      posTmp[ipos] = (numPosMbarSample == 0) ? ipos : distribution(generator);
-      int isplit = posTmp[ipos] % tensorSplit.numSplit;
-      if (isplit < num1) numRoundUp++;
-    }
-    std::vector<int> pos(num_ipos);
-    int indRoundUp = 0;
-    int indRoundDown = numRoundUp;
-    for (int ipos=0;ipos < num_ipos;ipos++) {
-      int isplit = posTmp[ipos] % tensorSplit.numSplit;
-      if (isplit < num1) {
-        pos[indRoundUp++] = posTmp[ipos];
-      } else {
-        pos[indRoundDown++] = posTmp[ipos];        
+    // Split isplit is "round up" when it is longer than dimSplit. As in transposePackedSplit,
+    // these are spread over the split indices, not the first num1 ones
+    auto isRoundUp = [&](const int isplit) {
+      return ((isplit + 1)*tensorSplit.splitDim/tensorSplit.numSplit -
+        isplit*tensorSplit.splitDim/tensorSplit.numSplit > dimSplit);
+    };
+
+    for (int num_ipos;(num_ipos = sampler.nextBlock()) > 0;) {
+      int ipos0 = sampler.num();
+      std::vector<int> posTmp(num_ipos);
+      int numRoundUp = 0;
+      for (int ipos=0;ipos < num_ipos;ipos++) {
+        posTmp[ipos] = sampler.pos(ipos0 + ipos);
+        int isplit = posTmp[ipos] % tensorSplit.numSplit;
+        if (isRoundUp(isplit)) numRoundUp++;
       }
-    }
-    if (indRoundUp != numRoundUp || indRoundDown != num_ipos) {
-      printf("cuttPlan_t::countCycles, fatal implemention bug\n");
-      return false;
-    }
-    // Round up is in pos[0 ... numRoundUp - 1]
-    // Round down is in pos[numRoundUp ... num_ipos - 1]
-
-    // Round up splits
-    for (int ipos=0;ipos < numRoundUp;ipos += INT_VECTOR_LEN) {
-      int numPos = std::min(numRoundUp - ipos, INT_VECTOR_LEN);
-      int posMbarIn[INT_VECTOR_LEN];
-      int posMbarOut[INT_VECTOR_LEN];
-      for (int i=0;i < numPos;i++) {
-        int posMbar = pos[ipos + i] / tensorSplit.numSplit;
-        int isplit  = pos[ipos + i] % tensorSplit.numSplit;
-        int p0 = isplit*tensorSplit.splitDim/tensorSplit.numSplit;
-        computePos(posMbar, posMbar, hostMbar.data(), tensorSplit.sizeMbar, &posMbarIn[i], &posMbarOut[i]);
-        posMbarIn[i] += p0*cuDimMm;
-        posMbarOut[i] += p0*cuDimMk;
+      std::vector<int> pos(num_ipos);
+      int indRoundUp = 0;
+      int indRoundDown = numRoundUp;
+      for (int ipos=0;ipos < num_ipos;ipos++) {
+        int isplit = posTmp[ipos] % tensorSplit.numSplit;
+        if (isRoundUp(isplit)) {
+          pos[indRoundUp++] = posTmp[ipos];
+        } else {
+          pos[indRoundDown++] = posTmp[ipos];        
+        }
       }
-      for (int i=numPos;i < INT_VECTOR_LEN;i++) {
-        posMbarIn[i]  = posMbarIn[numPos - 1];
-        posMbarOut[i] = posMbarOut[numPos - 1];
+      if (indRoundUp != numRoundUp || indRoundDown != num_ipos) {
+        printf("cuttPlan_t::countCycles, fatal implemention bug\n");
+        return false;
       }
+      // Round up is in pos[0 ... numRoundUp - 1]
+      // Round down is in pos[numRoundUp ... num_ipos - 1]
+
+      // Round up splits
+      for (int ipos=0;ipos < numRoundUp;ipos += INT_VECTOR_LEN) {
+        int numPos = std::min(numRoundUp - ipos, INT_VECTOR_LEN);
+        int posMbarIn[INT_VECTOR_LEN];
+        int posMbarOut[INT_VECTOR_LEN];
+        int posTran[INT_VECTOR_LEN];
+        for (int i=0;i < numPos;i++) {
+          int posMbar = pos[ipos + i] / tensorSplit.numSplit;
+          int isplit  = pos[ipos + i] % tensorSplit.numSplit;
+          int p0 = isplit*tensorSplit.splitDim/tensorSplit.numSplit;
+          computePos(posMbar, posMbar, hostMbarFast.data(), tensorSplit.sizeMbar, &posMbarIn[i], &posMbarOut[i]);
+          posMbarIn[i] += p0*cuDimMm;
+          posMbarOut[i] += p0*cuDimMk;
+        }
+        for (int i=numPos;i < INT_VECTOR_LEN;i++) {
+          posMbarIn[i]  = posMbarIn[numPos - 1];
+          posMbarOut[i] = posMbarOut[numPos - 1];
+        }
 
-      int gld_tran_tmp = 0;
-      int gst_tran_tmp = 0;
-      int gld_req_tmp = 0;
-      int gst_req_tmp = 0;
-      int cl_full_l2_tmp = 0;
-      int cl_part_l2_tmp = 0;
-      countPackedGlTransactions0(prop.warpSize, accWidth, cacheWidth, launchConfig.numthread.x,
-        numPos, posMbarIn, posMbarOut, volMmk1, posMmkIn1.data(), posMmkOut1.data(),
-        gld_tran_tmp, gst_tran_tmp, gld_req_tmp, gst_req_tmp,
-        cl_full_l2_tmp, cl_part_l2_tmp, cl_full_l1, cl_part_l1);
-      gld_tran += gld_tran_tmp;
-      gst_tran += gst_tran_tmp;
-      gld_req += gld_req_tmp;
-      gst_req += gst_req_tmp;
-      cl_full_l2 += cl_full_l2_tmp;
-      cl_part_l2 += cl_part_l2_tmp;
+        int gld_tran_tmp = 0;
+        int gst_tran_tmp = 0;
+        int gld_req_tmp = 0;
+        int gst_req_tmp = 0;
+        int cl_full_l2_tmp = 0;
+        int cl_part_l2_tmp = 0;
+        memo->countPackedGlTransactions0(prop.warpSize, accWidth, cacheWidth, launchConfig.numthread.x,
+          numPos, posMbarIn, posMbarOut, volMmk1, hostMmk.data() + tensorSplit.sizeMmk, tensorSplit.sizeMmk,
+          gld_tran_tmp, gst_tran_tmp, gld_req_tmp, gst_req_tmp,
+          cl_full_l2_tmp, cl_part_l2_tmp, posTran);
+        for (int i=0;i < numPos;i++) sampler.add(posTran[i]);
+        gld_tran += gld_tran_tmp;
+        gst_tran += gst_tran_tmp;
+        gld_req += gld_req_tmp;
+        gst_req += gst_req_tmp;
+        cl_full_l2 += cl_full_l2_tmp;
+        cl_part_l2 += cl_part_l2_tmp;
 
 #ifdef COUNTCYCLE_CHECK
-      int gld_tran_ref = 0;
-      int gst_tran_ref = 0;
-      int gld_req_ref = 0;
-      int gst_req_ref = 0;
-      int cl_full_l2_ref = 0;
-      int cl_part_l2_ref = 0;
-      for (int i=0;i < numPos;i++) {
-        countPackedGlTransactions(prop.warpSize, accWidth, cacheWidth, launchConfig.numthread.x,
-          posMbarIn[i], posMbarOut[i], volMmk1, posMmkIn1, posMmkOut1,
-          gld_tran_ref, gst_tran_ref, gld_req_ref, gst_req_ref,
-          cl_full_l2_ref, cl_part_l2_ref, cl_full_l1, cl_part_l1);
-      }
-      if (gld_tran_tmp != gld_tran_ref || gst_tran_tmp != gst_tran_ref ||
-        gld_req_tmp != gld_req_ref || gst_req_tmp != gst_req_ref) {
-        printf("PackedSplit:countPackedGlTransactions0 ERROR\n");
-        printf("tmp %d %d %d %d\n", gld_tran_tmp, gst_tran_tmp, gld_req_tmp, gst_req_tmp);
-        printf("ref %d %d %d %d\n", gld_tran_ref, gst_tran_ref, gld_req_ref, gst_req_ref);
-        return false;
-      }
-      if (cl_full_l2_tmp != cl_full_l2_ref || cl_part_l2_tmp != cl_part_l2_ref) {
-        printf("PackedSplit:countPackedGlTransactions0 ERROR\n");
-        printf("tmp %d %d\n", cl_full_l2_tmp, cl_part_l2_tmp);
-        printf("ref %d %d\n",  cl_full_l2_ref, cl_part_l2_ref);
-        return false;
-      }
+        int gld_tran_ref = 0;
+        int gst_tran_ref = 0;
+        int gld_req_ref = 0;
+        int gst_req_ref = 0;
+        int cl_full_l2_ref = 0;
+        int cl_part_l2_ref = 0;
+        std::vector<int> posMmkIn1V(posMmkIn1, posMmkIn1 + volMmk1);
+        std::vector<int> posMmkOut1V(posMmkOut1, posMmkOut1 + volMmk1);
+        for (int i=0;i < numPos;i++) {
+          countPackedGlTransactions(prop.warpSize, accWidth, cacheWidth, launchConfig.numthread.x,
+            posMbarIn[i], posMbarOut[i], volMmk1, posMmkIn1V, posMmkOut1V,
+            gld_tran_ref, gst_tran_ref, gld_req_ref, gst_req_ref,
+            cl_full_l2_ref, cl_part_l2_ref, cl_full_l1, cl_part_l1);
+        }
+        if (gld_tran_tmp != gld_tran_ref || gst_tran_tmp != gst_tran_ref ||
+          gld_req_tmp != gld_req_ref || gst_req_tmp != gst_req_ref) {
+          printf("PackedSplit:countPackedGlTransactions0 ERROR\n");
+          printf("tmp %d %d %d %d\n", gld_tran_tmp, gst_tran_tmp, gld_req_tmp, gst_req_tmp);
+          printf("ref %d %d %d %d\n", gld_tran_ref, gst_tran_ref, gld_req_ref, gst_req_ref);
+          return false;
+        }
+        if (cl_full_l2_tmp != cl_full_l2_ref || cl_part_l2_tmp != cl_part_l2_ref) {
+          printf("PackedSplit:countPackedGlTransactions0 ERROR\n");
+          printf("tmp %d %d\n", cl_full_l2_tmp, cl_part_l2_tmp);
+          printf("ref %d %d\n",  cl_full_l2_ref, cl_part_l2_ref);
+          return false;
+        }
 #endif
-    }
-
-    // Round down splits
-    for (int ipos=numRoundUp;ipos < num_ipos;ipos += INT_VECTOR_LEN) {
-      int numPos = std::min(num_ipos - ipos, INT_VECTOR_LEN);
-      int posMbarIn[INT_VECTOR_LEN];
-      int posMbarOut[INT_VECTOR_LEN];
-      for (int i=0;i < numPos;i++) {
-        int posMbar = pos[ipos + i] / tensorSplit.numSplit;
-        int isplit  = pos[ipos + i] % tensorSplit.numSplit;
-        int p0 = isplit*tensorSplit.splitDim/tensorSplit.numSplit;
-        computePos(posMbar, posMbar, hostMbar.data(), tensorSplit.sizeMbar, &posMbarIn[i], &posMbarOut[i]);
-        posMbarIn[i] += p0*cuDimMm;
-        posMbarOut[i] += p0*cuDimMk;
-      }
-      for (int i=numPos;i < INT_VECTOR_LEN;i++) {
-        posMbarIn[i]  = posMbarIn[numPos - 1];
-        posMbarOut[i] = posMbarOut[numPos - 1];
       }
 
-      int gld_tran_tmp = 0;
-      int gst_tran_tmp = 0;
-      int gld_req_tmp = 0;
-      int gst_req_tmp = 0;
-      int cl_full_l2_tmp = 0;
-      int cl_part_l2_tmp = 0;
-      countPackedGlTransactions0(prop.warpSize, accWidth, cacheWidth, launchConfig.numthread.x,
-        numPos, posMbarIn, posMbarOut, volMmk0, posMmkIn0.data(), posMmkOut0.data(),
-        gld_tran_tmp, gst_tran_tmp, gld_req_tmp, gst_req_tmp,
-        cl_full_l2_tmp, cl_part_l2_tmp, cl_full_l1, cl_part_l1);
-      gld_tran += gld_tran_tmp;
-      gst_tran += gst_tran_tmp;
-      gld_req += gld_req_tmp;
-      gst_req += gst_req_tmp;
-      cl_full_l2 += cl_full_l2_tmp;
-      cl_part_l2 += cl_part_l2_tmp;
+      // Round down splits
+      for (int ipos=numRoundUp;ipos < num_ipos;ipos += INT_VECTOR_LEN) {
+        int numPos = std::min(num_ipos - ipos, INT_VECTOR_LEN);
+        int posMbarIn[INT_VECTOR_LEN];
+        int posMbarOut[INT_VECTOR_LEN];
+        int posTran[INT_VECTOR_LEN];
+        for (int i=0;i < numPos;i++) {
+          int posMbar = pos[ipos + i] / tensorSplit.numSplit;
+          int isplit  = pos[ipos + i] % tensorSplit.numSplit;
+          int p0 = isplit*tensorSplit.splitDim/tensorSplit.numSplit;
+          computePos(posMbar, posMbar, hostMbarFast.data(), tensorSplit.sizeMbar, &posMbarIn[i], &posMbarOut[i]);
+          posMbarIn[i] += p0*cuDimMm;
+          posMbarOut[i] += p0*cuDimMk;
+        }
+        for (int i=numPos;i < INT_VECTOR_LEN;i++) {
+          posMbarIn[i]  = posMbarIn[numPos - 1];
+          posMbarOut[i] = posMbarOut[numPos - 1];
+        }
+
+        int gld_tran_tmp = 0;
+        int gst_tran_tmp = 0;
+        int gld_req_tmp = 0;
+        int gst_req_tmp = 0;
+        int cl_full_l2_tmp = 0;
+        int cl_part_l2_tmp = 0;
+        memo->countPackedGlTransactions0(prop.warpSize, accWidth, cacheWidth, launchConfig.numthread.x,
+          numPos, posMbarIn, posMbarOut, volMmk0, hostMmk.data(), tensorSplit.sizeMmk,
+          gld_tran_tmp, gst_tran_tmp, gld_req_tmp, gst_req_tmp,
+          cl_full_l2_tmp, cl_part_l2_tmp, posTran);
+        for (int i=0;i < numPos;i++) sampler.add(posTran[i]);
+        gld_tran += gld_tran_tmp;
+        gst_tran += gst_tran_tmp;
+        gld_req += gld_req_tmp;
+        gst_req += gst_req_tmp;
+        cl_full_l2 += cl_full_l2_tmp;
+        cl_part_l2 += cl_part_l2_tmp;
 
 #ifdef COUNTCYCLE_CHECK
-      int gld_tran_ref = 0;
-      int gst_tran_ref = 0;
-      int gld_req_ref = 0;
-      int gst_req_ref = 0;
-      int cl_full_l2_ref = 0;
-      int cl_part_l2_ref = 0;
-      for (int i=0;i < numPos;i++) {
-        countPackedGlTransactions(prop.warpSize, accWidth, cacheWidth, launchConfig.numthread.x,
-          posMbarIn[i], posMbarOut[i], volMmk0, posMmkIn0, posMmkOut0,
-          gld_tran_ref, gst_tran_ref, gld_req_ref, gst_req_ref,
-          cl_full_l2_ref, cl_part_l2_ref, cl_full_l1, cl_part_l1);
-      }
-      if (gld_tran_tmp != gld_tran_ref || gst_tran_tmp != gst_tran_ref ||
-        gld_req_tmp != gld_req_ref || gst_req_tmp != gst_req_ref) {
-        printf("PackedSplit:countPackedGlTransactions0 ERROR\n");
-        printf("tmp %d %d %d %d\n", gld_tran_tmp, gst_tran_tmp, gld_req_tmp, gst_req_tmp);
-        printf("ref %d %d %d %d\n", gld_tran_ref, gst_tran_ref, gld_req_ref, gst_req_ref);
-        return false;
-      }
-      if (cl_full_l2_tmp != cl_full_l2_ref || cl_part_l2_tmp != cl_part_l2_ref) {
-        printf("PackedSplit:countPackedGlTransactions0 ERROR\n");
-        printf("tmp %d %d\n", cl_full_l2_tmp, cl_part_l2_tmp);
-        printf("ref %d %d\n",  cl_full_l2_ref, cl_part_l2_ref);
-        return false;
-      }
+        int gld_tran_ref = 0;
+        int gst_tran_ref = 0;
+        int gld_req_ref = 0;
+        int gst_req_ref = 0;
+        int cl_full_l2_ref = 0;
+        int cl_part_l2_ref = 0;
+        std::vector<int> posMmkIn0V(posMmkIn0, posMmkIn0 + volMmk0);
+        std::vector<int> posMmkOut0V(posMmkOut0, posMmkOut0 + volMmk0);
+        for (int i=0;i < numPos;i++) {
+          countPackedGlTransactions(prop.warpSize, accWidth, cacheWidth, launchConfig.numthread.x,
+            posMbarIn[i], posMbarOut[i], volMmk0, posMmkIn0V, posMmkOut0V,
+            gld_tran_ref, gst_tran_ref, gld_req_ref, gst_req_ref,
+            cl_full_l2_ref, cl_part_l2_ref, cl_full_l1, cl_part_l1);
+        }
+        if (gld_tran_tmp != gld_tran_ref || gst_tran_tmp != gst_tran_ref ||
+          gld_req_tmp != gld_req_ref || gst_req_tmp != gst_req_ref) {
+          printf("PackedSplit:countPackedGlTransactions0 ERROR\n");
+          printf("tmp %d %d %d %d\n", gld_tran_tmp, gst_tran_tmp, gld_req_tmp, gst_req_tmp);
+          printf("ref %d %d %d %d\n", gld_tran_ref, gst_tran_ref, gld_req_ref, gst_req_ref);
+          return false;
+        }
+        if (cl_full_l2_tmp != cl_full_l2_ref || cl_part_l2_tmp != cl_part_l2_ref) {
+          printf("PackedSplit:countPackedGlTransactions0 ERROR\n");
+          printf("tmp %d %d\n", cl_full_l2_tmp, cl_part_l2_tmp);
+          printf("ref %d %d\n",  cl_full_l2_ref, cl_part_l2_ref);
+          return false;
+        }
 #endif
+      }
     }
+    numPosMbar = sampler.num();
+    tranErr = sampler.err();
+
+#ifdef ENABLE_CACHE_SIM
+    l2HitRate = simulateL2Packed(prop, sizeofType, tensorSplit.volMbar, tensorSplit.numSplit, tensorSplit.splitDim,
+      cuDimMm, cuDimMk, hostMbar, tensorSplit.sizeMbar,
+      volMmk0, posMmkIn0, posMmkOut0, volMmk1, posMmkIn1, posMmkOut1, num1);
+#endif
 
 #ifdef ENABLE_NVTOOLS
     gpuRangeStop();
@@ -1361,7 +1427,7 @@ bool cuttPlan_t::countCycles(hipDeviceProp_t& prop, const int numPosMbarSample)
     sld_req = 0;
     sst_req = 0;
     // Round down splits
-    countPackedShTransactions0(prop.warpSize, prop.warpSize, launchConfig.numthread.x, 
+    memo->countPackedShTransactions0(prop.warpSize, prop.warpSize, launchConfig.numthread.x,
       volMmk0, hostMsh.data(), tensorSplit.sizeMmk,
       sld_tran, sst_tran, sld_req, sst_req);
 #ifdef COUNTCYCLE_CHECK
@@ -1393,7 +1459,7 @@ bool cuttPlan_t::countCycles(hipDeviceProp_t& prop, const int numPosMbarSample)
       int sst_tran_tmp = 0;
       int sld_req_tmp = 0;
       int sst_req_tmp = 0;
-      countPackedShTransactions0(prop.warpSize, prop.warpSize, launchConfig.numthread.x, 
+      memo->countPackedShTransactions0(prop.warpSize, prop.warpSize, launchConfig.numthread.x,
         volMmk1, hostMsh.data() + tensorSplit.sizeMmk, tensorSplit.sizeMmk,
         sld_tran_tmp, sst_tran_tmp, sld_req_tmp, sst_req_tmp);
 #ifdef COUNTCYCLE_CHECK
@@ -1439,15 +1505,11 @@ bool cuttPlan_t::countCycles(hipDeviceProp_t& prop, const int numPosMbarSample)
     cl_part_l2 = 0;
     cl_full_l1 = 0;
     cl_part_l1 = 0;
-    // Random number generator
-    std::default_random_engine generator;
-    std::uniform_int_distribution<int> distribution(0, tensorSplit.volMbar - 1);
+    MbarSampler sampler(tensorSplit.volMbar, numPosMbarSample);
     // Pre-compute posMmkIn and posMmkOut
-    std::vector<int> posMmkIn(tensorSplit.volMmk);
-    std::vector<int> posMmkOut(tensorSplit.volMmk);
-
-    computePos0(tensorSplit.volMmk, hostMmk.data(), tensorSplit.sizeMmk,
-      posMmkIn.data(), posMmkOut.data());
+    const int* posMmkIn;
+    const int* posMmkOut;
+    memo->posMmk(tensorSplit.volMmk, hostMmk.data(), tensorSplit.sizeMmk, posMmkIn, posMmkOut);
     // computePos(0, tensorSplit.volMmk - 1, hostMmkFast.data(), tensorSplit.sizeMmk,
     //   posMmkIn.data(), posMmkOut.data());
 #ifdef COUNTCYCLE_CHECK
@@ -1464,19 +1526,19 @@ bool cuttPlan_t::countCycles(hipDeviceProp_t& prop, const int numPosMbarSample)
     }
 #endif
 
-    int num_ipos = (numPosMbarSample == 0) ? tensorSplit.volMbar : numPosMbarSample;
+    // Vector chunks never cross sampling block boundaries
+    int num_ipos = sampler.nextBlock();
 
 #ifdef ENABLE_NVTOOLS
     gpuRangeStop();
     gpuRangeStart("Packed: loop");
 #endif
 
-    for (int iposMbar=0;iposMbar < num_ipos;iposMbar+=INT_VECTOR_LEN) {
-      // int posMbar = (numPosMbarSample == 0) ? iposMbar : distribution(generator);
+    for (int iposMbar=0;iposMbar < num_ipos;) {
       int numPos = std::min(num_ipos - iposMbar, INT_VECTOR_LEN);
       int posMbar[INT_VECTOR_LEN];
       for (int i=0;i < numPos;i++) {
-        posMbar[i] = (numPosMbarSample == 0) ? (iposMbar + i) : distribution(generator);
+        posMbar[i] = sampler.pos(iposMbar + i);
       }
       for (int i=numPos;i < INT_VECTOR_LEN;i++) {
         posMbar[i] = posMbar[numPos - 1];
@@ -1488,7 +1550,7 @@ bool cuttPlan_t::countCycles(hipDeviceProp_t& prop, const int numPosMbarSample)
       gpuRangeStart("computePos");
 #endif
       for (int i=0;i < INT_VECTOR_LEN;i++) {
-        computePos(posMbar[i], posMbar[i], hostMbar.data(), tensorSplit.sizeMbar, &posMbarIn[i], &posMbarOut[i]);
+        computePos(posMbar[i], posMbar[i], hostMbarFast.data(), tensorSplit.sizeMbar, &posMbarIn[i], &posMbarOut[i]);
       }
       // computePosRef(posMbar, posMbar, hostMbar.begin(), hostMbar.begin() + tensorSplit.sizeMbar, posMbarInV, posMbarOutV);
       // int posMbarIn = posMbarInV[0];
@@ -1505,10 +1567,12 @@ bool cuttPlan_t::countCycles(hipDeviceProp_t& prop, const int numPosMbarSample)
       int gst_req_tmp = 0;
       int cl_full_l2_tmp = 0;
       int cl_part_l2_tmp = 0;
-      countPackedGlTransactions0(prop.warpSize, accWidth, cacheWidth, launchConfig.numthread.x,
-        numPos, posMbarIn, posMbarOut, tensorSplit.volMmk, posMmkIn.data(), posMmkOut.data(),
+      int posTran[INT_VECTOR_LEN];
+      memo->countPackedGlTransactions0(prop.warpSize, accWidth, cacheWidth, launchConfig.numthread.x,
+        numPos, posMbarIn, posMbarOut, tensorSplit.volMmk, hostMmk.data(), tensorSplit.sizeMmk,
         gld_tran_tmp, gst_tran_tmp, gld_req_tmp, gst_req_tmp,
-        cl_full_l2_tmp, cl_part_l2_tmp, cl_full_l1, cl_part_l1);
+        cl_full_l2_tmp, cl_part_l2_tmp, posTran);
+      for (int i=0;i < numPos;i++) sampler.add(posTran[i]);
       gld_tran += gld_tran_tmp;
       gst_tran += gst_tran_tmp;
       gld_req += gld_req_tmp;
@@ -1523,9 +1587,11 @@ bool cuttPlan_t::countCycles(hipDeviceProp_t& prop, const int numPosMbarSample)
       int gst_req_ref = 0;
       int cl_full_l2_ref = 0;
       int cl_part_l2_ref = 0;
+      std::vector<int> posMmkInV(posMmkIn, posMmkIn + tensorSplit.volMmk);
+      std::vector<int> posMmkOutV(posMmkOut, posMmkOut + tensorSplit.volMmk);
       for (int i=0;i < numPos;i++) {
         countPackedGlTransactions(prop.warpSize, accWidth, cacheWidth, launchConfig.numthread.x,
-          posMbarIn[i], posMbarOut[i], tensorSplit.volMmk, posMmkIn, posMmkOut,
+          posMbarIn[i], posMbarOut[i], tensorSplit.volMmk, posMmkInV, posMmkOutV,
           gld_tran_ref, gst_tran_ref, gld_req_ref, gst_req_ref,
           cl_full_l2_ref, cl_part_l2_ref, cl_full_l1, cl_part_l1);
       }
@@ -1547,7 +1613,17 @@ bool cuttPlan_t::countCycles(hipDeviceProp_t& prop, const int numPosMbarSample)
 #ifdef ENABLE_NVTOOLS
       gpuRangeStop();
 #endif
+      iposMbar += numPos;
+      if (iposMbar == num_ipos) num_ipos += sampler.nextBlock();
     }
+    numPosMbar = sampler.num();
+    tranErr = sampler.err();
+
+#ifdef ENABLE_CACHE_SIM
+    l2HitRate = simulateL2Packed(prop, sizeofType, tensorSplit.volMbar, 1, 0,
+      cuDimMm, cuDimMk, hostMbar, tensorSplit.sizeMbar,
+      tensorSplit.volMmk, posMmkIn, posMmkOut, 0, NULL, NULL, 0);
+#endif
 
 #ifdef ENABLE_NVTOOLS
     gpuRangeStop();
@@ -1559,7 +1635,7 @@ bool cuttPlan_t::countCycles(hipDeviceProp_t& prop, const int numPosMbarSample)
     sst_tran = 0;
     sld_req = 0;
     sst_req = 0;
-    countPackedShTransactions0(prop.warpSize, prop.warpSize, launchConfig.numthread.x, 
+    memo->countPackedShTransactions0(prop.warpSize, prop.warpSize, launchConfig.numthread.x,
       tensorSplit.volMmk, hostMsh.data(), tensorSplit.sizeMmk,
       sld_tran, sst_tran, sld_req, sst_req);
 #ifdef COUNTCYCLE_CHECK
@@ -1593,6 +1669,8 @@ bool cuttPlan_t::countCycles(hipDeviceProp_t& prop, const int numPosMbarSample)
     gst_tran = gld_tran;
     cl_full_l2 = vol/cacheWidth;
     cl_part_l2 = ((vol % cacheWidth) > 0);
+    numPosMbar = tensorSplit.volMbar;
+    tranErr = 0.0f;
     // Shared memory
     sld_tran = 0;
     sst_tran = 0;
@@ -1606,47 +1684,273 @@ bool cuttPlan_t::countCycles(hipDeviceProp_t& prop, const int numPosMbarSample)
   }
 
 
+  // Deep register storage may spill. Spill size is known only from the compiled kernel,
+  // without it (profile without kernel entries) no spill is assumed
+  spillBytes = 0;
+  if (tensorSplit.method == Packed || tensorSplit.method == PackedSplit) {
+    KernelResource kr;
+    if (cuttKernelResource(tensorSplit.method, sizeofType, launchConfig.numRegStorage, deviceID, kr)) {
+      spillBytes = kr.localSizeBytes;
+    }
+  }
+
+  int numblock = launchConfig.numblock.x*launchConfig.numblock.y*launchConfig.numblock.z;
+  cycles = cyclesNumBlock(prop, numblock);
+
+  return true;
+}
+
+//
+// Returns predicted cycles with numblock blocks in total, from the transactions counted by
+// countCycles()
+//
+double cuttPlan_t::cyclesNumBlock(const hipDeviceProp_t& prop, const int numblock) const {
+
+  if (tensorSplit.method == Trivial) return 0.0;
+
   int numthread = launchConfig.numthread.x*launchConfig.numthread.y*launchConfig.numthread.z;
   // double cl_val = (double)cl_part/(double)std::max(1, cl_full + cl_part);
 
+  // With few blocks, SMs have fewer active blocks than the occupancy allows
+  int numActiveBlockUsed = std::min(numActiveBlock, (numblock - 1)/prop.multiProcessorCount + 1);
+
+  double cyclesIter = 0.0;
   if (tensorSplit.method == Packed || tensorSplit.method == PackedSplit) {
-    cycles = cyclesPacked(tensorSplit.method == PackedSplit, sizeofType, prop, numthread,
-      numActiveBlock, launchConfig.numRegStorage, 
+    cyclesIter = cyclesPacked(tensorSplit.method == PackedSplit, sizeofType, prop, numthread,
+      numActiveBlockUsed, launchConfig.numRegStorage, 
       gld_req, gst_req, gld_tran, gst_tran, sld_req, sst_req, sld_tran, sst_tran,
-      num_iter, cl_full_l2, cl_part_l2);
+      num_iter, cl_full_l2, cl_part_l2, l2HitRate);
+    cyclesIter += cyclesSpill(prop, numthread, spillBytes, num_iter);
   } else if (tensorSplit.method == Tiled || tensorSplit.method == TiledCopy) {
-    cycles = cyclesTiled(tensorSplit.method == TiledCopy, sizeofType, prop, numthread,
-      numActiveBlock, mlp, gld_req, gst_req, gld_tran, gst_tran,
+    cyclesIter = cyclesTiled(tensorSplit.method == TiledCopy, sizeofType, prop, numthread,
+      numActiveBlockUsed, mlp, gld_req, gst_req, gld_tran, gst_tran,
       sld_req, sst_req, sld_tran, sst_tran,
-      num_iter, cl_full_l2, cl_part_l2);
+      num_iter, cl_full_l2, cl_part_l2, l2HitRate);
+  }
+
+  // Launch latency, block dispatch and tail effects
+  return cyclesLaunch(prop, numblock, numActiveBlockUsed, num_iter, cyclesIter);
+}
+
+//
+// Chooses the size of the grid dimension that loops over Mbar with the cost model, and
+// updates cycles. All kernels loop over Mbar with grid strides, so any size in 1...volMbar
+// is valid. Candidates are whole numbers of blocks per SM.
+// NOTE: Expects that countCycles() has been called
+//
+void cuttPlan_t::searchNumBlock(const hipDeviceProp_t& prop) {
+
+  int gridDim;
+  if (tensorSplit.method == Packed) {
+    gridDim = 0;
+  } else if (tensorSplit.method == PackedSplit) {
+    gridDim = 1;
+  } else if (tensorSplit.method == Tiled || tensorSplit.method == TiledCopy) {
+    gridDim = 2;
+  } else {
+    return;
+  }
+  unsigned int* numblockMbar = (gridDim == 0) ? &launchConfig.numblock.x :
+    ((gridDim == 1) ? &launchConfig.numblock.y : &launchConfig.numblock.z);
+
+  // Number of blocks in the other grid dimensions
+  int numblockOther = launchConfig.numblock.x*launchConfig.numblock.y*launchConfig.numblock.z/(*numblockMbar);
+  int maxNumblockMbar = std::min(std::max(1, tensorSplit.volMbar), prop.maxGridSize[gridDim]);
+  maxNumblockMbar = std::min(maxNumblockMbar, std::max(1, (int)(2147483647/numblockOther)));
+
+  int bestNumblockMbar = *numblockMbar;
+  double bestCycles = cyclesNumBlock(prop, numblockOther*bestNumblockMbar);
+  int blockPerSM = 1;
+  while (true) {
+    long long n = ((long long)prop.multiProcessorCount*blockPerSM - 1)/numblockOther + 1;
+    int numblockMbarCand = (int)std::min((long long)maxNumblockMbar, n);
+    double cyclesCand = cyclesNumBlock(prop, numblockOther*numblockMbarCand);
+    if (cyclesCand < bestCycles) {
+      bestCycles = cyclesCand;
+      bestNumblockMbar = numblockMbarCand;
+    }
+    if (numblockMbarCand == maxNumblockMbar) break;
+    blockPerSM = (blockPerSM < 4) ? blockPerSM + 1 : blockPerSM*3/2;
+  }
+
+  *numblockMbar = bestNumblockMbar;
+  cycles = bestCycles;
+}
+
+//
+// Searches the launch configuration of plans with the cost model: the grid size of all plans,
+// and the number of threads and register storage depth of the LAUNCH_SEARCH_NUM_PLAN best
+// Packed and PackedSplit plans.
+// NOTE: Expects that countCycles() has been called for all plans
+//
+bool cuttPlan_t::searchLaunchConfigs(std::list<cuttPlan_t>& plans, hipDeviceProp_t& prop,
+  const int numPosMbarSample, ModelMemo* memo) {
+
+  std::vector< std::list<cuttPlan_t>::iterator > packedPlans;
+  for (auto it=plans.begin();it != plans.end();it++) {
+    it->searchNumBlock(prop);
+    if (it->tensorSplit.method == Packed || it->tensorSplit.method == PackedSplit) packedPlans.push_back(it);
+  }
+
+  int numSearch = std::min((int)packedPlans.size(), LAUNCH_SEARCH_NUM_PLAN);
+  std::partial_sort(packedPlans.begin(), packedPlans.begin() + numSearch, packedPlans.end(),
+    [](const std::list<cuttPlan_t>::iterator& a, const std::list<cuttPlan_t>::iterator& b) {
+      return (a->cycles < b->cycles);
+    });
+
+  for (int i=0;i < numSearch;i++) {
+    cuttPlan_t& plan = *packedPlans[i];
+    std::vector<LaunchConfig> lcs;
+    std::vector<int> numActiveBlocks;
+    cuttKernelLaunchConfigurationsPacked(plan.sizeofType, plan.tensorSplit, plan.deviceID, prop,
+      plan.launchConfig, lcs, numActiveBlocks);
+    for (int j=0;j < (int)lcs.size();j++) {
+      if (lcs[j].numRegStorage == plan.launchConfig.numRegStorage) continue;
+      cuttPlan_t alt = plan;
+      alt.launchConfig = lcs[j];
+      alt.numActiveBlock = numActiveBlocks[j];
+      if (!alt.countCycles(prop, numPosMbarSample, memo)) return false;
+      alt.searchNumBlock(prop);
+      if (alt.cycles < plan.cycles) plan = alt;
+    }
   }
 
   return true;
 }
 
+#ifndef CUTT_PLANNER_ONLY
+//
+// Returns the stream used for descriptor uploads on the current device (deviceID). The stream is
+// non-blocking, so waiting for an upload does not wait for work the user has queued on the plan
+// stream or on the null stream
+//
+static hipStream_t uploadStream(int deviceID) {
+  static std::map<int, hipStream_t> streams;
+  static std::mutex streamsMutex;
+  std::lock_guard<std::mutex> lock(streamsMutex);
+  auto it = streams.find(deviceID);
+  if (it == streams.end()) {
+    hipStream_t stream;
+    hipCheck(hipStreamCreateWithFlags(&stream, hipStreamNonBlocking));
+    it = streams.insert(std::make_pair(deviceID, stream)).first;
+  }
+  return it->second;
+}
+
+//
+// Device buffers of destroyed plans, kept for reuse by new plans, so that destroying a plan does
+// not call hipFree(), which synchronizes the device. Buffers are kept by device and size, sizes
+// are rounded up to a power of two. At most PLAN_BUFFER_POOL_BYTES are kept per device
+//
+const size_t PLAN_BUFFER_POOL_BYTES = 16 << 20;
+
+struct PlanBufferPool {
+  std::mutex mutex;
+  // Free buffers, key is (deviceID, size)
+  std::multimap< std::pair<int, size_t>, void* > buffers;
+  // Total size of free buffers by device
+  std::map<int, size_t> numBytes;
+};
+
+// Never destroyed, plans can be freed during static destruction
+static PlanBufferPool& planBufferPool() {
+  static PlanBufferPool* pool = new PlanBufferPool();
+  return *pool;
+}
+
+static size_t planBufferSize(const size_t bytes) {
+  size_t size = 256;
+  while (size < bytes) size *= 2;
+  return size;
+}
+
+// Returns a buffer of at least bytes on the current device deviceID
+static void* allocatePlanBuffer(const int deviceID, const size_t bytes) {
+  size_t size = planBufferSize(bytes);
+  PlanBufferPool& pool = planBufferPool();
+  {
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    auto it = pool.buffers.find(std::make_pair(deviceID, size));
+    if (it != pool.buffers.end()) {
+      void* ptr = it->second;
+      pool.buffers.erase(it);
+      pool.numBytes[deviceID] -= size;
+      return ptr;
+    }
+  }
+  void* ptr;
+  allocate_device_T(&ptr, size, 1);
+  return ptr;
+}
+
+// Returns buffer of allocatePlanBuffer() on the current device deviceID to the pool
+static void freePlanBuffer(const int deviceID, void* ptr, const size_t bytes) {
+  size_t size = planBufferSize(bytes);
+  PlanBufferPool& pool = planBufferPool();
+  {
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    if (pool.numBytes[deviceID] + size <= PLAN_BUFFER_POOL_BYTES) {
+      pool.buffers.insert(std::make_pair(std::make_pair(deviceID, size), ptr));
+      pool.numBytes[deviceID] += size;
+      return;
+    }
+  }
+  deallocate_device_T(&ptr);
+}
+
+void cuttPlanReleaseBuffers() {
+  PlanBufferPool& pool = planBufferPool();
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  int curDeviceID;
+  hipCheck(hipGetDevice(&curDeviceID));
+  int deviceID = curDeviceID;
+  for (auto it=pool.buffers.begin();it != pool.buffers.end();it++) {
+    if (it->first.first != deviceID) {
+      deviceID = it->first.first;
+      hipCheck(hipSetDevice(deviceID));
+    }
+    deallocate_device_T(&it->second);
+  }
+  if (deviceID != curDeviceID) hipCheck(hipSetDevice(curDeviceID));
+  pool.buffers.clear();
+  pool.numBytes.clear();
+}
+#endif
+
 //
-// Activates the plan: Allocates device memory buffers and copies data to them
+// Activates the plan: Allocates device memory buffers and copies data to them.
+// Returns once the copies are done, so that the plan can be executed on any stream
 //
 void cuttPlan_t::activate() {
 
+#ifndef CUTT_PLANNER_ONLY
+  // Descriptors are uploaded on a separate stream and waited for here, so that the plan can be
+  // executed on any stream once created
+  hipStream_t upload = uploadStream(deviceID);
+  bool copied = false;
   if (tensorSplit.sizeMbar > 0) {
     if (Mbar == NULL) {
-      allocate_device<TensorConvInOut>(&Mbar, tensorSplit.sizeMbar);
-      copy_HtoD<TensorConvInOut>(hostMbar.data(), Mbar, tensorSplit.sizeMbar, stream);
+      Mbar = (TensorConvInOut*)allocatePlanBuffer(deviceID, tensorSplit.sizeMbar*sizeof(TensorConvInOut));
+      copy_HtoD<TensorConvInOut>(hostMbar.data(), Mbar, tensorSplit.sizeMbar, upload);
+      copied = true;
     }
   }
 
   if (tensorSplit.method == Packed || tensorSplit.method == PackedSplit) {
     int MmkSize = (tensorSplit.method == Packed) ? tensorSplit.sizeMmk : tensorSplit.sizeMmk*2;
     if (Mmk == NULL) {
-      allocate_device<TensorConvInOut>(&Mmk, MmkSize);
-      copy_HtoD<TensorConvInOut>(hostMmk.data(), Mmk, MmkSize, stream);
+      Mmk = (TensorConvInOut*)allocatePlanBuffer(deviceID, MmkSize*sizeof(TensorConvInOut));
+      copy_HtoD<TensorConvInOut>(hostMmk.data(), Mmk, MmkSize, upload);
+      copied = true;
     }
     if (Msh == NULL) {
-      allocate_device<TensorConv>(&Msh, MmkSize);
-      copy_HtoD<TensorConv>(hostMsh.data(), Msh, MmkSize, stream);
+      Msh = (TensorConv*)allocatePlanBuffer(deviceID, MmkSize*sizeof(TensorConv));
+      copy_HtoD<TensorConv>(hostMsh.data(), Msh, MmkSize, upload);
+      copied = true;
     }
   }
+  if (copied) hipCheck(hipStreamSynchronize(upload));
+#endif
 
 }
 
@@ -1662,19 +1966,64 @@ void cuttPlan_t::nullDevicePointers() {
 }
 
 cuttPlan_t::cuttPlan_t() {
+#ifndef CUTT_PLANNER_ONLY
   hipCheck(hipGetDevice(&deviceID));
+#else
+  // Planner-only builds plan for a device profile
+  deviceID = 0;
+#endif
   stream = 0;
   numActiveBlock = 0;
+  numPosMbar = 0;
+  tranErr = 0.0f;
+  l2HitRate = DEFAULT_L2_HITRATE;
+  spillBytes = 0;
   nullDevicePointers();
 }
 
 cuttPlan_t::~cuttPlan_t() {
-  // Deallocate device buffers
-  if (Mbar != NULL) deallocate_device<TensorConvInOut>(&Mbar);
-  if (Mmk != NULL) deallocate_device<TensorConvInOut>(&Mmk);
-  if (Msh != NULL) deallocate_device<TensorConv>(&Msh);
+#ifndef CUTT_PLANNER_ONLY
+  // Return descriptor buffers to the pool, sizes as in activate()
+  int MmkSize = (tensorSplit.method == Packed) ? tensorSplit.sizeMmk : tensorSplit.sizeMmk*2;
+  if (Mbar != NULL) freePlanBuffer(deviceID, Mbar, tensorSplit.sizeMbar*sizeof(TensorConvInOut));
+  if (Mmk != NULL) freePlanBuffer(deviceID, Mmk, MmkSize*sizeof(TensorConvInOut));
+  if (Msh != NULL) freePlanBuffer(deviceID, Msh, MmkSize*sizeof(TensorConv));
   if (Mk != NULL) deallocate_device<TensorConv>(&Mk);
   if (Mm != NULL) deallocate_device<TensorConv>(&Mm);
+#endif
+}
+
+#ifndef CUTT_PLANNER_ONLY
+bool ExecEvents::record(hipStream_t stream) {
+  for (int i=0;i < PLAN_NUM_EXEC_STREAM;i++) {
+    hipStream_t cur = streams[i].load(std::memory_order_relaxed);
+    if (cur != stream && (cur != none() || !(streams[i].compare_exchange_strong(cur, stream) || cur == stream))) continue;
+    // Entry i is for stream, the first thread to get here creates its event
+    hipEvent_t event = events[i].load();
+    if (event == NULL) {
+      hipEvent_t newEvent;
+      hipCheck(hipEventCreateWithFlags(&newEvent, hipEventDisableTiming));
+      if (events[i].compare_exchange_strong(event, newEvent)) {
+        event = newEvent;
+      } else {
+        hipCheck(hipEventDestroy(newEvent));
+      }
+    }
+    hipCheck(hipEventRecord(event, stream));
+    return true;
+  }
+  overflow.store(true);
+  return false;
+}
+#endif
+
+ExecEvents::~ExecEvents() {
+#ifndef CUTT_PLANNER_ONLY
+  for (int i=0;i < PLAN_NUM_EXEC_STREAM;i++) {
+    hipEvent_t event = events[i].load();
+    if (event != NULL) hipCheck(hipEventDestroy(event));
+  }
+#endif
 }
 
 void cuttPlan_t::setStream(hipStream_t stream_in) {
@@ -30,17 +30,68 @@ All rights reserved.
 
 #include <list>
 #include <vector>
-#include <hip/hip_runtime.h>
+#include <atomic>
+#include <cstdint>
+#include "cuttHip.h"
 #include "cuttTypes.h"
 
+class ModelMemo;
+
 const int TILEDIM = 64;
 const int TILEROWS = 8;
 
+// Number of best Packed and PackedSplit plans whose register storage depth is searched
+// with the cost model
+const int LAUNCH_SEARCH_NUM_PLAN = 2;
+
 // Transposing methods
 enum {Unknown, Trivial, Packed, PackedSplit,
   Tiled, TiledCopy,
   NumTransposeMethods};
 
+// Number of streams a plan tracks executions on
+const int PLAN_NUM_EXEC_STREAM = 16;
+
+//
+// Completion events of the executions of a plan, one per stream it has been executed on, so that
+// its destruction can be ordered after them without touching the streams, which the caller may
+// have destroyed by then. record() may be called concurrently. A copy starts without events, so
+// that copies of a plan do not share the events of the original
+//
+class ExecEvents {
+private:
+  std::atomic<hipStream_t> streams[PLAN_NUM_EXEC_STREAM];
+  std::atomic<hipEvent_t> events[PLAN_NUM_EXEC_STREAM];
+  std::atomic<bool> overflow;
+  // Value of unused entries
+  static hipStream_t none() {return reinterpret_cast<hipStream_t>(~(uintptr_t)0);}
+  void init() {
+    for (int i=0;i < PLAN_NUM_EXEC_STREAM;i++) {
+      streams[i].store(none());
+      events[i].store(NULL);
+    }
+    overflow.store(false);
+  }
+public:
+  ExecEvents() {init();}
+  ExecEvents(const ExecEvents&) {init();}
+  ExecEvents& operator=(const ExecEvents&) {return *this;}
+  ~ExecEvents();
+
+  // Records an event on stream after the work queued on it so far, on the current device.
+  // Returns false if the plan was executed on more streams than are tracked
+  bool record(hipStream_t stream);
+
+  // Returns events recorded by record(). Returns false if some executions are not covered
+  bool get(std::vector<hipEvent_t>& list) const {
+    for (int i=0;i < PLAN_NUM_EXEC_STREAM;i++) {
+      hipEvent_t event = events[i].load();
+      if (event != NULL) list.push_back(event);
+    }
+    return !overflow.load();
+  }
+};
+
 // Tells how tensor is split into Mm and Mk and what method is used
 // NOTE: sizeMm and sizeMk fully define the split
 class TensorSplit {
@@ -117,6 +168,11 @@ public:
 
  };
 
+#ifndef CUTT_PLANNER_ONLY
+// Frees the device buffers of destroyed plans kept for reuse by new plans
+void cuttPlanReleaseBuffers();
+#endif
+
 // Class that stores the plan data
 class cuttPlan_t {
 public:
@@ -126,6 +182,9 @@ public:
   // CUDA stream associated with the plan
   hipStream_t stream;
 
+  // Completion of the executions of the plan, on stream and on streams given to cuttExecuteAsync()
+  ExecEvents execEvents;
+
   // Kernel launch configuration
   LaunchConfig launchConfig;
   
@@ -153,12 +212,26 @@ public:
   int cl_full_l2, cl_part_l2;
   int cl_full_l1, cl_part_l1;
   int sld_req, sst_req, sld_tran, sst_tran;
+  // Number of Mbar positions sampled by the model
+  int numPosMbar;
+  // Relative error (95% confidence) of the sampled global memory transaction count
+  float tranErr;
+  // L2 cache hit rate of global memory reads
+  float l2HitRate;
+  // Local memory per thread of registers the kernel spills
+  int spillBytes;
   double cycles;
 
+  // Dimensions and permutation the plan was requested for, used to replan it for another device
+  std::vector<int> requestDim;
+  std::vector<int> requestPermutation;
+
   //--------------
   // Host buffers
   //--------------
   std::vector<TensorConvInOut> hostMbar;
+  // hostMbar with precomputed reciprocals for the host model
+  std::vector<TensorConvInOutFast> hostMbarFast;
   std::vector<TensorConvInOut> hostMmk;
   std::vector<TensorConv> hostMsh;
 
@@ -184,7 +257,8 @@ public:
   ~cuttPlan_t();
   void print();
   void setStream(hipStream_t stream_in);
-  bool countCycles(hipDeviceProp_t& prop, const int numPosMbarSample=0);
+  bool countCycles(hipDeviceProp_t& prop, const int numPosMbarSample=0, ModelMemo* memo=NULL);
+  void searchNumBlock(const hipDeviceProp_t& prop);
   void activate();
   void nullDevicePointers();
 
@@ -192,7 +266,12 @@ public:
     const int redRank, const int* redDim, const int* redPermutation,
     const size_t sizeofType, const int deviceID, const hipDeviceProp_t& prop, std::list<cuttPlan_t>& plans);
 
+  static bool searchLaunchConfigs(std::list<cuttPlan_t>& plans, hipDeviceProp_t& prop,
+    const int numPosMbarSample=0, ModelMemo* memo=NULL);
+
 private:
+  double cyclesNumBlock(const hipDeviceProp_t& prop, const int numblock) const;
+
   static bool createTrivialPlans(const int rank, const int* dim, const int* permutation,
     const size_t sizeofType, const int deviceID, const hipDeviceProp_t& prop, std::list<cuttPlan_t>& plans);
 
@@ -216,6 +295,9 @@ private:
 
 void printMatlab(hipDeviceProp_t& prop, std::list<cuttPlan_t>& plans, std::vector<double>& times);
 
+void printModelEval(const int rank, const int* dim, const int* permutation, const size_t sizeofType,
+  std::list<cuttPlan_t>& plans, std::vector<double>& times);
+
 void reduceRanks(const int rank, const int* dim, const int* permutation,
   std::vector<int>& redDim, std::vector<int>& redPermutation);
 
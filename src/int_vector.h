@@ -8,7 +8,13 @@
 // Intel x86
 #include <x86intrin.h>
 
-#if defined(__AVX__)
+#if defined(__AVX512F__)
+// AVX-512: comparisons go through the k mask registers
+#define USE_AVX512
+const int INT_VECTOR_LEN = 16;
+const char INT_VECTOR_TYPE[] = "AVX512";
+
+#elif defined(__AVX__)
 #define USE_AVX
 const int INT_VECTOR_LEN = 8;
 
@@ -33,6 +39,14 @@ const char INT_VECTOR_TYPE[] = "SSE2";
 const int INT_VECTOR_LEN = 4;
 const char INT_VECTOR_TYPE[] = "ALTIVEC";
 
+#elif defined(__ARM_NEON) && defined(__aarch64__)  // #if defined(__SSE2__)
+// ARM AArch64. Also used on SVE hosts: SVE vector types are sizeless and cannot be
+// class members, and every SVE implementation also provides NEON
+#define USE_NEON
+#include <arm_neon.h>
+const int INT_VECTOR_LEN = 4;
+const char INT_VECTOR_TYPE[] = "NEON";
+
 #else // #if defined(__SSE2__)
 // Nothing
 const int INT_VECTOR_LEN = 1;
@@ -40,17 +54,21 @@ const char INT_VECTOR_TYPE[] = "SCALAR";
 #endif
 
 //
-// Integer vector class for Intel and IBM CPU platforms
+// Integer vector class for Intel, IBM and ARM CPU platforms
 //
 class int_vector {
 private:
 
-#if defined(USE_AVX)
+#if defined(USE_AVX512)
+  __m512i x;
+#elif defined(USE_AVX)
   __m256i x;
 #elif defined(USE_SSE)
   __m128i x;
 #elif defined(USE_ALTIVEC)
   vector signed int x;
+#elif defined(USE_NEON)
+  int32x4_t x;
 #else
   int x;
 #endif
@@ -61,30 +79,42 @@ public:
   }
 
   inline int_vector(const int a) {
-#if defined(USE_AVX)
+#if defined(USE_AVX512)
+    x = _mm512_set1_epi32(a);
+#elif defined(USE_AVX)
     x = _mm256_set1_epi32(a);
 #elif defined(USE_SSE)
     x = _mm_set1_epi32(a);
 #elif defined(USE_ALTIVEC)
     x = (vector signed int){a, a, a, a};
+#elif defined(USE_NEON)
+    x = vdupq_n_s32(a);
 #else
     x = a;
 #endif    
   }
 
   inline int_vector(const int a[]) {
-#if defined(USE_AVX)
+#if defined(USE_AVX512)
+    x = _mm512_loadu_si512(a);
+#elif defined(USE_AVX)
     x = _mm256_set_epi32(a[7], a[6], a[5], a[4], a[3], a[2], a[1], a[0]);
 #elif defined(USE_SSE)
     x = _mm_set_epi32(a[3], a[2], a[1], a[0]);
 #elif defined(USE_ALTIVEC)
     x = vec_ld(0, a);
+#elif defined(USE_NEON)
+    x = vld1q_s32(a);
 #else
     x = a[0];
 #endif    
   }
 
-#if defined(USE_AVX)
+#if defined(USE_AVX512)
+  inline int_vector(const __m512i ax) {
+    x = ax;
+  }
+#elif defined(USE_AVX)
   inline int_vector(const __m256i ax) {
     x = ax;
   }
@@ -96,6 +126,10 @@ public:
   inline int_vector(const vector signed int ax) {
     x = ax;
   }
+#elif defined(USE_NEON)
+  inline int_vector(const int32x4_t ax) {
+    x = ax;
+  }
 #endif
 
   // 
@@ -103,12 +137,16 @@ public:
   //
 
   inline int_vector operator+=(const int_vector a) {
-#if defined(USE_AVX)
+#if defined(USE_AVX512)
+    x = _mm512_add_epi32(x, a.x);
+#elif defined(USE_AVX)
     x = _mm256_add_epi32(x, a.x);
 #elif defined(USE_SSE)
     x = _mm_add_epi32(x, a.x);
 #elif defined(USE_ALTIVEC)
     x += a.x;
+#elif defined(USE_NEON)
+    x = vaddq_s32(x, a.x);
 #else
     x += a.x;
 #endif
@@ -116,12 +154,16 @@ public:
   }
 
   inline int_vector operator-=(const int_vector a) {
-#if defined(USE_AVX)
+#if defined(USE_AVX512)
+    x = _mm512_sub_epi32(x, a.x);
+#elif defined(USE_AVX)
     x = _mm256_sub_epi32(x, a.x);
 #elif defined(USE_SSE)
     x = _mm_sub_epi32(x, a.x);
 #elif defined(USE_ALTIVEC)
     x -= a.x;
+#elif defined(USE_NEON)
+    x = vsubq_s32(x, a.x);
 #else
     x -= a.x;
 #endif
@@ -129,12 +171,16 @@ public:
   }
 
   inline int_vector operator&=(const int_vector a) {
-#if defined(USE_AVX)
+#if defined(USE_AVX512)
+    x = _mm512_and_si512(x, a.x);
+#elif defined(USE_AVX)
     x = _mm256_and_si256(x, a.x);
 #elif defined(USE_SSE)
     x = _mm_and_si128(x, a.x);
 #elif defined(USE_ALTIVEC)
     x &= a.x;
+#elif defined(USE_NEON)
+    x = vandq_s32(x, a.x);
 #else
     x &= a.x;
 #endif
@@ -142,12 +188,16 @@ public:
   }
 
   inline int_vector operator|=(const int_vector a) {
-#if defined(USE_AVX)
+#if defined(USE_AVX512)
+    x = _mm512_or_si512(x, a.x);
+#elif defined(USE_AVX)
     x = _mm256_or_si256(x, a.x);
 #elif defined(USE_SSE)
     x = _mm_or_si128(x, a.x);
 #elif defined(USE_ALTIVEC)
     x |= a.x;
+#elif defined(USE_NEON)
+    x = vorrq_s32(x, a.x);
 #else
     x |= a.x;
 #endif
@@ -155,7 +205,9 @@ public:
   }
 
   inline int_vector operator~() {
-#if defined(USE_AVX)
+#if defined(USE_AVX512)
+    return int_vector( _mm512_ternarylogic_epi32(x, x, x, 0x55) );
+#elif defined(USE_AVX)
     int_vector fullmask = int_vector(-1);
     return int_vector( _mm256_andnot_si256(x, fullmask.x) );
 #elif defined(USE_SSE)
@@ -163,6 +215,8 @@ public:
     return int_vector( _mm_andnot_si128(x, fullmask.x) );
 #elif defined(USE_ALTIVEC)
     return int_vector( ~x );
+#elif defined(USE_NEON)
+    return int_vector( vmvnq_s32(x) );
 #else
     return ~x;
 #endif
@@ -171,12 +225,16 @@ public:
   // Sign extended shift by a constant.
   // Note: 0 <= n <= 31. Otherwise results are unpredictable
   inline int_vector operator>>=(const int n) {
-#if defined(USE_AVX)
+#if defined(USE_AVX512)
+    x = _mm512_sra_epi32(x, _mm_cvtsi32_si128(n));
+#elif defined(USE_AVX)
     x = _mm256_srai_epi32(x, n);
 #elif defined(USE_SSE)
     x = _mm_srai_epi32(x, n);
 #elif defined(USE_ALTIVEC)
     x >>= n;
+#elif defined(USE_NEON)
+    x = vshlq_s32(x, vdupq_n_s32(-n));
 #else
     x >>= n;
 #endif
@@ -186,12 +244,16 @@ public:
   // Sign extended shift by a constant
   // Note: 0 <= n <= 31. Otherwise results are unpredictable
   inline int_vector operator<<=(const int n) {
-#if defined(USE_AVX)
+#if defined(USE_AVX512)
+    x = _mm512_sll_epi32(x, _mm_cvtsi32_si128(n));
+#elif defined(USE_AVX)
     x = _mm256_slli_epi32(x, n);
 #elif defined(USE_SSE)
     x = _mm_slli_epi32(x, n);
 #elif defined(USE_ALTIVEC)
     x <<= n;
+#elif defined(USE_NEON)
+    x = vshlq_s32(x, vdupq_n_s32(n));
 #else
     x <<= n;
 #endif
@@ -200,13 +262,17 @@ public:
 
   // Copy contest to int array
   void copy(int* a) const {
-#if defined(USE_AVX)
+#if defined(USE_AVX512)
+    _mm512_storeu_si512(a, x);
+#elif defined(USE_AVX)
     _mm256_storeu_si256((__m256i *)a, x);
 #elif defined(USE_SSE)
     _mm_storeu_si128((__m128i *)a, x);
 #elif defined(USE_ALTIVEC)
      // void vec_stl (vector signed int, int, int *);
     vec_stl(x, 0, a);
+#elif defined(USE_NEON)
+    vst1q_s32(a, x);
 #else
     a[0] = x;
 #endif
@@ -248,50 +314,75 @@ public:
 
   // Returns 0xffffffff = -1 on the vector elements that are equal
   inline friend int_vector eq_mask(const int_vector a, const int_vector b) {
-#if defined(USE_AVX)
+#if defined(USE_AVX512)
+    return int_vector(_mm512_maskz_set1_epi32(_mm512_cmpeq_epi32_mask(a.x, b.x), -1));
+#elif defined(USE_AVX)
     return int_vector(_mm256_cmpeq_epi32(a.x, b.x));
 #elif defined(USE_SSE)
     return int_vector(_mm_cmpeq_epi32(a.x, b.x));
 #elif defined(USE_ALTIVEC)
     return int_vector(a.x == b.x);
+#elif defined(USE_NEON)
+    return int_vector(vreinterpretq_s32_u32(vceqq_s32(a.x, b.x)));
 #else
     return int_vector((a.x == b.x)*(-1));
 #endif
   }
 
   inline friend int_vector neq_mask(const int_vector a, const int_vector b) {
+#if defined(USE_AVX512)
+    return int_vector(_mm512_maskz_set1_epi32(_mm512_cmpneq_epi32_mask(a.x, b.x), -1));
+#else
     return ~eq_mask(a, b);
+#endif
   }
 
   // 0xffffffff => 1
   inline friend int_vector mask_to_bool(const int_vector a) {
-#if defined(USE_AVX)
+#if defined(USE_AVX512)
+    return int_vector(_mm512_srli_epi32(a.x, 31));
+#elif defined(USE_AVX)
     return int_vector(_mm256_srli_epi32(a.x, 31));
 #elif defined(USE_SSE)
     return int_vector(_mm_srli_epi32(a.x, 31));
 #elif defined(USE_ALTIVEC)
     return int_vector((vector signed int)((vector unsigned int)a.x >> 31));
+#elif defined(USE_NEON)
+    return int_vector(vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_s32(a.x), 31)));
 #else
     return ((unsigned int)a.x >> 31);
 #endif
   }
 
+  // On AVX-512 the comparison mask selects the 1s directly, without the 0xffffffff detour
   inline friend int_vector operator==(const int_vector a, const int_vector b) {
+#if defined(USE_AVX512)
+    return int_vector(_mm512_maskz_set1_epi32(_mm512_cmpeq_epi32_mask(a.x, b.x), 1));
+#else
     return mask_to_bool(eq_mask(a, b));
+#endif
   }
 
   inline friend int_vector operator!=(const int_vector a, const int_vector b) {
+#if defined(USE_AVX512)
+    return int_vector(_mm512_maskz_set1_epi32(_mm512_cmpneq_epi32_mask(a.x, b.x), 1));
+#else
     return mask_to_bool(neq_mask(a, b));
+#endif
   }
 
   // 1 => 0xffffffff
   inline friend int_vector bool_to_mask(const int_vector a) {
-#if defined(USE_AVX)
+#if defined(USE_AVX512)
+    return neq_mask(a, int_vector(0));
+#elif defined(USE_AVX)
     return neq_mask(a, int_vector(0));
 #elif defined(USE_SSE)
     return neq_mask(a, int_vector(0));
 #elif defined(USE_ALTIVEC)
     return neq_mask(a, int_vector(0));
+#elif defined(USE_NEON)
+    return neq_mask(a, int_vector(0));
 #else
     return (a ? -1 : 0);
 #endif
@@ -300,7 +391,9 @@ public:
   // Implicit type conversion
   // Returns true if any of the elements are != 0
   operator bool() const {
-#if defined(USE_AVX)
+#if defined(USE_AVX512)
+    return (_mm512_test_epi32_mask(x, x) != 0);
+#elif defined(USE_AVX)
     int_vector a = neq_mask(*this, int_vector(0));
     return (_mm256_movemask_epi8(a.x) != 0);
 #elif defined(USE_SSE)
@@ -308,6 +401,8 @@ public:
     return (_mm_movemask_epi8(a.x) != 0);
 #elif defined(USE_ALTIVEC)
     return vec_any_ne(x, ((const vector signed int){0, 0, 0, 0}));
+#elif defined(USE_NEON)
+    return (vmaxvq_u32(vreinterpretq_u32_s32(x)) != 0);
 #else
     return x;
 #endif